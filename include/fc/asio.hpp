@@ -66,14 +66,75 @@ namespace asio {
         };
         #endif 
     }
+    /**
+     *  How the io_services behind default_io_service() are set up, see
+     *  configure_default_io_service().
+     */
+    struct io_service_config
+    {
+       uint32_t threads     = 8;     ///< threads running io_services, 0 for one per CPU (of numa_node if given)
+       bool     per_thread  = false; ///< one io_service per thread instead of a single one shared by all of them
+       bool     pin_threads = false; ///< pin each thread to one CPU, round robin over the CPUs allowed
+       int32_t  numa_node   = -1;    ///< keep the threads on the CPUs of this NUMA node, -1 for any CPU
+    };
+
+    /**
+     *  Sets up the io_services behind default_io_service().  Must be called before the first
+     *  call to default_io_service(), directly or by creating a socket; throws otherwise.
+     */
+    void configure_default_io_service( const io_service_config& config );
+
     /**
      * @return the default boost::asio::io_service for use with fc::asio
      * 
-     * This IO service is automatically running in its own thread to service asynchronous
-     * requests without blocking any other threads.
+     * This IO service is automatically running in its own threads to service asynchronous
+     * requests without blocking any other threads.  It is the same io_service on every call;
+     * with io_service_config::per_thread it is the first of them and runs on one thread only.
      */
     boost::asio::io_service& default_io_service(bool cleanup = false);
 
+    /**
+     * @return default_io_service(), or with io_service_config::per_thread the next of the
+     * io_services round robin.  fc creates its sockets on this one, so with per_thread they
+     * are spread over the threads; a websocket server or client keeps all of its connections
+     * on the io_service it got, each connection behind its own websocketpp strand.
+     */
+    boost::asio::io_service& next_io_service();
+
+    /** counters of one of the io_services behind default_io_service() */
+    struct io_service_stats
+    {
+       uint32_t         threads         = 0; ///< threads running the io_service
+       uint64_t         assigned        = 0; ///< times next_io_service() returned it, e.g. for a new socket
+       uint64_t         handlers        = 0; ///< completion handlers run
+       uint64_t         queue_depth     = 0; ///< handlers that were ready at once when a thread last woke up
+       uint64_t         max_queue_depth = 0; ///< the largest queue_depth seen
+       fc::microseconds busy_time;           ///< CPU time used by its threads, 0 where not supported
+    };
+
+    /** @return the stats of each io_service behind default_io_service(), none before it is first used */
+    std::vector<io_service_stats> get_default_io_service_stats();
+
+    /**
+     *  Gives the current fc::thread its own io_service, which the thread runs itself whenever
+     *  it has nothing else to do instead of sleeping, and polls every so often while it is
+     *  busy.  Operations on sockets of this io_service complete on the thread, so a fiber
+     *  waiting on one is resumed without any hand off between threads.
+     *
+     *  Call it on the thread before creating its sockets.  The io_service lives as long as the
+     *  thread, sockets using it must be closed before the thread quits, and the handlers run
+     *  on it must not block.
+     *
+     *  @return the current thread's io_service
+     */
+    boost::asio::io_service& enable_thread_io_service();
+
+    /**
+     *  @return the io_service of the current thread if enable_thread_io_service() was called on
+     *  it, otherwise next_io_service().  fc's sockets are created on this one.
+     */
+    boost::asio::io_service& current_io_service();
+
     /** 
      *  @brief wraps boost::asio::async_read
      *  @pre s.non_blocking() == true
@@ -5,6 +5,10 @@
 namespace fc 
 {
 
+  class path;
+
   string zlib_compress(const string& in);
+  /** writes zlib_compress() of the contents of in to out, without reading all of in into memory */
+  void   zlib_compress_file(const path& in, const path& out);
 
 } // namespace fc
@@ -0,0 +1,58 @@
+#pragma once
+#include <fc/variant_object.hpp>
+#include <string.h>
+
+namespace fc
+{
+   namespace detail { class format_cache; }
+
+   /**
+    *  @brief A "${key}" format string parsed once into literal text and argument slots.
+    *
+    *  Produces exactly what format_string() produces, but formatting is a walk over
+    *  the precompiled segments with one hashed lookup per slot.  Templates for
+    *  format string literals (e.g. the FORMAT of the logging and exception macros)
+    *  are compiled on first use and then shared through for_literal().
+    */
+   class format_template
+   {
+      public:
+         explicit format_template( string format );
+
+         /**
+          *  @return the template for a format string literal, keyed by its text and
+          *  kept for the rest of the process, or nullptr if the cache is full
+          */
+         template<size_t N>
+         static const format_template* for_literal( const char (&format)[N] )
+         {
+            return for_literal( format, strnlen( format, N ) );
+         }
+         static const format_template* for_literal( const char* format, size_t len );
+
+         /** appends the formatted text to out */
+         void   format( const variant_object& args, string& out )const;
+         string format( const variant_object& args )const;
+
+         const string& get_format()const { return _format; }
+
+      private:
+         friend class detail::format_cache;
+         format_template( string format, bool intern_keys );
+
+         struct segment
+         {
+            uint32_t    begin;  ///< offset of the literal text or key in _format
+            uint32_t    size;
+            bool        is_key;
+            variant_key key;
+         };
+
+         string               _format;
+         std::vector<segment> _segments;
+   };
+
+   /** appends format_string( string( format, len ), args ) to out */
+   void format_string( const char* format, size_t len, const variant_object& args, string& out );
+
+} // fc
@@ -1,6 +1,8 @@
 #pragma once
 #include <fc/variant.hpp>
 #include <fc/filesystem.hpp>
+#include <functional>
+#include <iterator>
 
 namespace fc
 {
@@ -28,6 +30,50 @@ namespace fc
             legacy_generator = 1
          };
 
+         /** layouts of many values in one text that parallel_parse() can split */
+         enum sequence_format
+         {
+            newline_delimited = 0, ///< one value per line (NDJSON)
+            top_level_array   = 1  ///< the elements of one big array
+         };
+
+         /**
+          *  Bounds on untrusted input, checked by a scan that allocates nothing before
+          *  the parser builds any variant.  A limit of 0 means unlimited.  Input that is not
+          *  strict JSON is checked by a coarser scan that may reject it a little early.
+          *
+          *  The parsers recurse once per level of nesting, so the default depth keeps to
+          *  the bound the parsers have always had.
+          */
+         struct limits
+         {
+            /** nesting is never allowed to reach this, also when max_depth is 0 */
+            static const uint32_t max_depth_cap = 4096;
+
+            uint32_t max_depth          = 100; ///< nested objects plus arrays must stay below this
+            size_t   max_string_length  = 0;   ///< bytes between the quotes of any string or key, as written
+            size_t   max_elements       = 0;   ///< total number of values, keys not counted
+            size_t   max_bytes          = 0;   ///< size of the whole text
+
+            /** the bound on nesting these limits set, shared by every parser and indexer */
+            uint32_t effective_max_depth()const
+            {
+               return ( max_depth != 0 && max_depth < max_depth_cap ) ? max_depth : max_depth_cap;
+            }
+         };
+
+         /** limits used by the overloads that do not take any; not synchronized, set them at startup */
+         static const limits& default_limits();
+         static void          set_default_limits( const limits& l );
+
+         /**
+          *  Checks json_str against l in one pass without allocating.
+          *
+          *  @throws fc::parse_error_exception if a limit is exceeded
+          *  @return false if json_str is not strict JSON (the limits could not be fully checked)
+          */
+         static bool     check_limits( const std::string& json_str, const limits& l = default_limits() );
+
          static ostream& to_stream( ostream& out, const fc::string&);
          static ostream& to_stream( ostream& out, const variant& v, output_formatting format = stringify_large_ints_and_doubles );
          static ostream& to_stream( ostream& out, const variants& v, output_formatting format = stringify_large_ints_and_doubles );
@@ -36,11 +82,63 @@ namespace fc
          static variant  from_stream( buffered_istream& in, parse_type ptype = legacy_parser );
 
          static variant  from_string( const string& utf8_str, parse_type ptype = legacy_parser );
+         static variant  from_string( const string& utf8_str, parse_type ptype, const limits& l );
          static variants variants_from_string( const string& utf8_str, parse_type ptype = legacy_parser );
+         static variants variants_from_string( const string& utf8_str, parse_type ptype, const limits& l );
+
+         /** receives the values of one chunk on a worker thread; chunks are numbered in input order */
+         typedef std::function<void( size_t chunk, variants&& values )> chunk_handler;
+
+         /**
+          *  Splits utf8_str at value boundaries into chunks and parses them concurrently on
+          *  thread_pool::default_pool() and the calling thread.  threads sets how many ways
+          *  the work is split, 0 for the size of the pool.  on_split is called once with the
+          *  number of chunks before any on_chunk call.  Small inputs are parsed on the
+          *  calling thread.
+          *
+          *  With newline_delimited no value may contain a raw newline, which holds for JSON.
+          */
+         static void     parallel_parse( const string& utf8_str, sequence_format fmt,
+                                         const std::function<void( size_t chunk_count )>& on_split,
+                                         const chunk_handler& on_chunk,
+                                         parse_type ptype = legacy_parser, uint32_t threads = 0 );
+
+         /** the values of utf8_str in input order, see parallel_parse() */
+         static variants parallel_variants_from_string( const string& utf8_str, sequence_format fmt,
+                                                        parse_type ptype = legacy_parser, uint32_t threads = 0 );
+
+         /** like parallel_variants_from_string(), converting every value to T on the worker threads */
+         template<typename T>
+         static std::vector<T> parallel_from_string( const string& utf8_str, sequence_format fmt,
+                                                     parse_type ptype = legacy_parser, uint32_t threads = 0 )
+         {
+            std::vector< std::vector<T> > chunks;
+            parallel_parse( utf8_str, fmt,
+                            [&]( size_t n ) { chunks.resize( n ); },
+                            [&]( size_t i, variants&& values ) {
+                               chunks[i].reserve( values.size() );
+                               for( const auto& v : values )
+                                  chunks[i].push_back( v.as<T>() );
+                            },
+                            ptype, threads );
+            std::vector<T> result;
+            size_t total = 0;
+            for( const auto& c : chunks ) total += c.size();
+            result.reserve( total );
+            for( auto& c : chunks )
+               std::move( c.begin(), c.end(), std::back_inserter( result ) );
+            return result;
+         }
          static string   to_string( const variant& v, output_formatting format = stringify_large_ints_and_doubles );
          static string   to_pretty_string( const variant& v, output_formatting format = stringify_large_ints_and_doubles );
 
+         /**
+          *  Strict JSON is validated without building any variant; input that is not strict
+          *  JSON is still accepted if the lenient parsers (anything but strict_parser) accept it.
+          *  Input exceeding the limits is never valid.
+          */
          static bool     is_valid( const std::string& json_str, parse_type ptype = legacy_parser );
+         static bool     is_valid( const std::string& json_str, parse_type ptype, const limits& l );
 
          template<typename T>
          static void     save_to_file( const T& v, const fc::path& fi, bool pretty = true, output_formatting format = stringify_large_ints_and_doubles )
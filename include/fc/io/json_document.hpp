@@ -0,0 +1,125 @@
+#pragma once
+#include <fc/io/json.hpp>
+#include <vector>
+
+namespace fc
+{
+   class json_document;
+
+   /**
+    *  A read-only view of one value inside a json_document.  Nothing is decoded
+    *  until it is asked for: strings are unescaped by as_string() and a value is
+    *  only turned into an fc::variant by as_variant() / as<T>().
+    *
+    *  A json_value is only valid while the json_document it came from is alive.
+    *  It can also view an already decoded variant, so code taking a json_value
+    *  works on either without going through JSON text; it is then only valid
+    *  while that variant is alive.
+    */
+   class json_value
+   {
+      public:
+         enum value_type
+         {
+            null_value   = 0,
+            bool_value   = 1,
+            number_value = 2,
+            string_value = 3,
+            array_value  = 4,
+            object_value = 5
+         };
+
+         json_value():_doc(nullptr),_var(nullptr),_index(0){}
+         explicit json_value( const variant& v ):_doc(nullptr),_var(&v),_index(0){}
+
+         value_type get_type()const;
+
+         bool is_null()const   { return _is_missing() || get_type() == null_value; }
+         bool is_string()const { return !_is_missing() && get_type() == string_value; }
+         bool is_array()const  { return !_is_missing() && get_type() == array_value; }
+         bool is_object()const { return !_is_missing() && get_type() == object_value; }
+
+         /** number of elements of an array or members of an object, 0 otherwise */
+         size_t     size()const;
+
+         /** @throws fc::assert_exception if this is not an array or pos is out of range */
+         json_value operator[]( size_t pos )const;
+
+         /** @return a null json_value if this is not an object or key is not a member */
+         json_value find( const string& key )const;
+         bool       contains( const string& key )const { return !find( key )._is_missing(); }
+         /** @throws fc::key_not_found_exception if key is not a member */
+         json_value operator[]( const string& key )const;
+
+         /** the text of this value exactly as it appears in the document, or a variant's JSON */
+         string     raw()const;
+
+         string     as_string()const;
+         uint64_t   as_uint64()const;
+         int64_t    as_int64()const;
+
+         /** decodes this value (and everything below it) with the legacy parser */
+         variant    as_variant()const;
+         /** the elements of an array, each decoded with as_variant() */
+         variants   as_variants()const;
+
+         template<typename T>
+         T as()const { return as_variant().as<T>(); }
+
+      private:
+         friend class json_document;
+         json_value( const json_document* doc, uint32_t index ):_doc(doc),_var(nullptr),_index(index){}
+
+         bool _is_missing()const { return _doc == nullptr && _var == nullptr; }
+
+         const json_document* _doc;
+         const variant*       _var;
+         uint32_t             _index;
+   };
+
+   /**
+    *  Structural index ("tape") over a JSON text.  Building the index only
+    *  records where every value starts and ends; values are decoded on access
+    *  through json_value.  This allows a dispatcher to look at a few fields of a
+    *  large message (e.g. the method name of an RPC request) without paying for
+    *  a full variant tree.
+    */
+   class json_document
+   {
+      public:
+         /**
+          *  Indexes utf8_str.  Input the structural scanner does not accept (the legacy
+          *  parser is more lenient than strict JSON) is first normalized through
+          *  json::from_string, so everything json::from_string accepts is accepted here.
+          *
+          *  @throws fc::parse_error_exception or whatever json::from_string throws
+          */
+         static json_document from_string( string utf8_str );
+
+         json_value root()const { return json_value( this, 0 ); }
+
+         json_document( json_document&& ) = default;
+         json_document& operator=( json_document&& ) = default;
+
+      private:
+         friend class json_value;
+
+         struct tape_entry
+         {
+            uint8_t  type;
+            uint32_t begin;  ///< offset of the first character of the value
+            uint32_t end;    ///< offset one past the last character of the value
+            uint32_t next;   ///< tape index of the next sibling
+            uint32_t count;  ///< members / elements of containers
+         };
+
+         json_document() = default;
+         bool build_tape();
+
+         string                  _json;
+         std::vector<tape_entry> _tape;
+   };
+
+   void to_variant( const json_value& v, variant& var );
+
+} // fc
@@ -39,5 +39,16 @@ namespace fc {
          static bool          register_appender( const fc::string& type, const appender_factory::ptr& f );
 
          virtual void log( const log_message& m ) = 0;
+         /** writes out anything buffered by log(); the async log writer calls it after every batch */
+         virtual void flush(){}
+         /** writes out everything buffered, also what flush() leaves for later; flush_logging() and the exit hooks call it */
+         virtual void force_flush(){ flush(); }
+
+      protected:
+         /** true while the async log writer is delivering a batch that it will follow with flush() */
+         static bool in_batch();
+
+         /** m.format_message() into an emptied buffer owned by the calling thread */
+         static const string& format_message( const log_message& m );
    };
 }
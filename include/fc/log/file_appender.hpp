@@ -14,14 +14,23 @@ class file_appender : public appender {
 
             fc::string                         format;
             fc::path                           filename;
+            /// write out every message; when false, messages are buffered as below
             bool                               flush = true;
+            /// write out once this many bytes are buffered...
+            uint32_t                           flush_size = 64 * 1024;
+            /// ...and at least this often; error messages are always written at once
+            microseconds                       flush_interval = seconds( 1 );
             bool                               rotate = false;
             microseconds                       rotation_interval;
             microseconds                       rotation_limit;
+            /// zlib-compress rotated files into <file>.zlib in the background
+            bool                               compress = false;
          };
          file_appender( const variant& args );
          ~file_appender();
          virtual void log( const log_message& m )override;
+         virtual void flush()override;
+         virtual void force_flush()override;
 
       private:
          class impl;
@@ -31,4 +40,4 @@ class file_appender : public appender {
 
 #include <fc/reflect/reflect.hpp>
 FC_REFLECT( fc::file_appender::config,
-            (format)(filename)(flush)(rotate)(rotation_interval)(rotation_limit) )
+            (format)(filename)(flush)(flush_size)(flush_interval)(rotate)(rotation_interval)(rotation_limit)(compress) )
@@ -5,6 +5,7 @@
  */
 #include <fc/time.hpp>
 #include <fc/variant_object.hpp>
+#include <fc/format_template.hpp>
 #include <fc/shared_ptr.hpp>
 #include <memory>
 
@@ -60,6 +61,9 @@ namespace fc
                     const char* file, 
                     uint64_t line, 
                     const char* method );
+        /** for a context captured earlier, e.g. by a log_record; file is taken as is */
+        log_context( log_level ll, string file, uint64_t line, const char* method,
+                     time_point timestamp, string thread_name, string task_name );
         ~log_context();
         explicit log_context( const variant& v );
         variant to_variant()const;
@@ -110,18 +114,32 @@ namespace fc
           *  @param ctx - generally provided using the FC_LOG_CONTEXT(LEVEL) macro 
           */
          log_message( log_context ctx, std::string format, variant_object args = variant_object() );
+         /** a format string literal is compiled once and its template reused by every message */
+         template<size_t N>
+         log_message( log_context ctx, const char (&format)[N], variant_object args = variant_object() )
+         :log_message( std::move(ctx), format_template::for_literal( format ), format, std::move(args) ){}
          ~log_message();
 
+         log_message( const log_message& ) = default;
+         log_message( log_message&& ) = default;
+         log_message& operator=( const log_message& ) = default;
+         log_message& operator=( log_message&& ) = default;
+
          log_message( const variant& v );
          variant        to_variant()const;
                               
          string         get_message()const;
+         /** appends get_message() to out, so callers can reuse one buffer */
+         void           format_message( string& out )const;
                               
          log_context    get_context()const;
          string         get_format()const;
          variant_object get_data()const;
 
       private:
+         friend class log_record;
+         log_message( log_context ctx, const format_template* tpl, const char* format, variant_object args );
+
          std::shared_ptr<detail::log_message_impl> my;
    };
 
@@ -0,0 +1,155 @@
+#pragma once
+#include <fc/log/log_message.hpp>
+#include <string.h>
+#include <type_traits>
+
+namespace fc
+{
+   /**
+    *  @brief The part of a log_context that is fixed for a log statement.
+    *
+    *  The logging macros keep one log_site per call site in a function-local static that
+    *  is never destroyed, so the file name is shortened once instead of on every call and
+    *  records still queued at exit can refer to it.
+    */
+   class log_site
+   {
+      public:
+         log_site( log_level level, const char* file, uint64_t line, const char* method );
+
+         log_level   level;
+         string      file;
+         uint64_t    line;
+         const char* method; ///< __func__ of the call site
+   };
+
+   /**
+    *  @brief A log statement captured as compact binary data, formatted only when written.
+    *
+    *  Instead of a log_context with string copies and a variant_object of arguments, a
+    *  record holds its log_site, the timestamp, the compiled format and the arguments
+    *  serialized into an inline buffer: scalars and strings as raw bytes, anything else
+    *  as a raw packed variant.  to_log_message() turns it into the equivalent log_message,
+    *  which the async log writer does off the calling thread.
+    *
+    *  Arguments are added with the same ("key",value) syntax as mutable_variant_object.
+    */
+   class log_record
+   {
+      public:
+         log_record():_site(nullptr),_tpl(nullptr),_size(0){}
+         template<size_t N>
+         log_record( const log_site& site, const char (&format)[N] )
+         :_site(&site),_tpl( format_template::for_literal( format ) ),_size(0)
+         {
+            capture( _tpl ? nullptr : format, _tpl ? 0 : strnlen( format, N ) );
+         }
+         log_record( const log_site& site, const std::string& format )
+         :_site(&site),_tpl(nullptr),_size(0)
+         {
+            capture( format.data(), format.size() );
+         }
+
+         log_record( const log_record& r );
+         log_record& operator=( const log_record& r );
+
+         log_record& operator()( const char* key, bool v )        { put_key( key, strlen(key), bool_tag );   put( &v, 1 ); return *this; }
+         log_record& operator()( const char* key, double v )      { put_key( key, strlen(key), double_tag ); put( &v, sizeof(v) ); return *this; }
+         log_record& operator()( const char* key, float v )       { return (*this)( key, double(v) ); }
+         log_record& operator()( const char* key, const char* v ) { put_key( key, strlen(key), string_tag ); put_string( v, strlen(v) ); return *this; }
+         log_record& operator()( const char* key, const std::string& v ) { put_key( key, strlen(key), string_tag ); put_string( v.data(), v.size() ); return *this; }
+
+         template<typename T>
+         typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, log_record&>::type
+         operator()( const char* key, T v )
+         {
+            const int64_t i = v;
+            put_key( key, strlen(key), int64_tag );
+            put( &i, sizeof(i) );
+            return *this;
+         }
+         template<typename T>
+         typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, log_record&>::type
+         operator()( const char* key, T v )
+         {
+            const uint64_t u = v;
+            put_key( key, strlen(key), uint64_tag );
+            put( &u, sizeof(u) );
+            return *this;
+         }
+         template<typename T>
+         typename std::enable_if<!std::is_arithmetic<typename std::decay<T>::type>::value, log_record&>::type
+         operator()( const char* key, const T& v )
+         {
+            put_variant( key, strlen(key), variant(v) );
+            return *this;
+         }
+         log_record& operator()( const char* key, const variant& v )
+         {
+            put_variant( key, strlen(key), v );
+            return *this;
+         }
+         template<typename T>
+         log_record& operator()( const std::string& key, const T& v )
+         {
+            return (*this)( key.c_str(), v );
+         }
+         log_record& operator()( const variant_object& args );
+
+         bool        valid()const { return _site != nullptr; }
+         log_level   get_log_level()const { return _site->level; }
+         log_message to_log_message()const;
+
+      private:
+         enum tag : char { int64_tag, uint64_tag, double_tag, bool_tag, string_tag, variant_tag };
+
+         static const size_t inline_capacity = 192;
+
+         /** records the timestamp, thread and task name, and a format that has no template */
+         void  capture( const char* format, size_t len );
+         char* grow( size_t n );
+         void  put( const void* d, size_t n )
+         {
+            char* p = _size + n <= inline_capacity && _heap.empty() ? _inline + _size : grow( n );
+            memcpy( p, d, n );
+            _size += n;
+         }
+         void  put_string( const char* s, size_t len )
+         {
+            const uint32_t l = len;
+            put( &l, sizeof(l) );
+            if( len )
+               put( s, len );
+         }
+         void  put_key( const char* key, size_t len, tag t )
+         {
+            put_string( key, len );
+            put( &t, 1 );
+         }
+         void  put_variant( const char* key, size_t len, const variant& v );
+
+         const char* data()const { return _heap.empty() ? _inline : _heap.data(); }
+
+         const log_site*        _site;
+         const format_template* _tpl;
+         time_point             _timestamp;
+         uint32_t               _size;
+         char                   _inline[inline_capacity];
+         std::vector<char>      _heap;   ///< used instead of _inline once that is too small
+   };
+
+} // namespace fc
+
+/**
+ * @def FC_LOG_SITE(LOG_LEVEL)
+ * @brief Declares the static log_site that FC_LOG_RECORD refers to.
+ */
+#define FC_LOG_SITE(LOG_LEVEL) \
+   static const fc::log_site& fc_log_site = *new fc::log_site( fc::log_level::LOG_LEVEL, __FILE__, __LINE__, __func__ )
+
+/**
+ * @def FC_LOG_RECORD(FORMAT,...)
+ * @brief Like FC_LOG_MESSAGE, but builds a log_record for the FC_LOG_SITE in scope.
+ */
+#define FC_LOG_RECORD( FORMAT, ... ) \
+   fc::log_record( fc_log_site, FORMAT )__VA_ARGS__
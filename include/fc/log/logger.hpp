@@ -3,11 +3,14 @@
 #include <fc/time.hpp>
 #include <fc/shared_ptr.hpp>
 #include <fc/log/log_message.hpp>
+#include <fc/log/log_record.hpp>
+#include <atomic>
 
 namespace fc  
 {
 
    class appender;
+   namespace detail { class async_log_writer; }
 
    /**
     *
@@ -48,13 +51,127 @@ namespace fc
          void remove_appender( const fc::shared_ptr<appender>& a );
 
          bool is_enabled( log_level e )const;
+         /** hands m to the async log writer when async logging is configured, else to the appenders */
          void log( log_message m );
+         /** like log( r.to_log_message() ), but with async logging r is only formatted by the writer */
+         void log( const log_record& r );
 
       private:
+         friend class detail::async_log_writer;
+         void dispatch( log_message& m );
+
          class impl;
          fc::shared_ptr<impl> my;
    };
 
+   namespace detail
+   {
+      /** bumped by configure_logging() whenever it replaces the loggers */
+      extern std::atomic<uint32_t> logging_generation;
+      /** advanced once a second while there are log_limiters */
+      extern std::atomic<uint32_t> log_limiter_tick;
+      /** advances log_limiter_tick and has every log_limiter report what it suppressed */
+      void tick_log_limiters();
+   }
+
+   /**
+    *  @brief The logger::get() of one logging macro call site.
+    *
+    *  Kept in a function-local static, never destroyed, so the macros do not look the logger up by name
+    *  on every call; looked up again once configure_logging() has replaced the loggers.
+    *
+    *  The handle is published through an atomic pointer, so checking the level and copying the
+    *  logger take no lock.  A replaced handle is only deleted by the refresh after the one that
+    *  replaced it, as a caller on another thread may still be reading it.
+    */
+   class cached_logger
+   {
+      public:
+         explicit cached_logger( string name = "default" )
+         :_name( fc::move(name) ),_generation(0),_current(nullptr),_retired(nullptr){}
+
+         /** a copy, which stays valid however often configure_logging() replaces the cached handle */
+         logger get()
+         {
+            return *current();
+         }
+
+         /** checks the level without copying the handle, the fast path of a disabled statement */
+         bool is_enabled( log_level e )
+         {
+            return current()->is_enabled( e );
+         }
+
+      private:
+         const logger* current()
+         {
+            if( _generation.load( std::memory_order_acquire ) != detail::logging_generation.load( std::memory_order_relaxed ) )
+               refresh();
+            return _current.load( std::memory_order_acquire );
+         }
+         void refresh();
+
+         const string                _name;
+         std::atomic<uint32_t>       _generation;
+         std::atomic<const logger*>  _current;
+         const logger*               _retired; ///< the handle _current replaced, only used by refresh()
+   };
+
+   /**
+    *  @brief Per call site state of the rate limited logging macros, e.g. wlog_rate().
+    *
+    *  A statement held back by every_n() or rate() costs a couple of relaxed atomic
+    *  increments.  Once a second the log maintenance thread logs, for every site whose
+    *  rate() held statements back, how many there were.
+    */
+   class log_limiter
+   {
+      public:
+         log_limiter( cached_logger& lgr, const log_site& site, string format );
+
+         /** true for the first of every n calls */
+         bool every_n( uint64_t n )
+         {
+            return _calls.fetch_add( 1, std::memory_order_relaxed ) % ( n ? n : 1 ) == 0;
+         }
+
+         /** true for at most per_second calls in every second */
+         bool rate( uint32_t per_second )
+         {
+            const uint32_t tick = detail::log_limiter_tick.load( std::memory_order_relaxed );
+            if( _tick.load( std::memory_order_relaxed ) != tick )
+            {
+               // racing resets at most let a few extra statements through
+               _tick.store( tick, std::memory_order_relaxed );
+               _in_tick.store( 0, std::memory_order_relaxed );
+            }
+            if( _in_tick.fetch_add( 1, std::memory_order_relaxed ) < per_second )
+               return true;
+            _suppressed.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+         }
+
+         /** logs how many statements rate() held back since the last call */
+         void report_suppressed();
+
+      private:
+         cached_logger&        _logger;
+         const log_site&       _site;
+         const string          _format;
+         std::atomic<uint64_t> _calls;
+         std::atomic<uint32_t> _tick;
+         std::atomic<uint32_t> _in_tick;
+         std::atomic<uint64_t> _suppressed;
+   };
+
+   /**
+    *  Waits until every message queued by async logging so far has been written
+    *  and the appenders have been flushed, running other tasks of the calling
+    *  thread meanwhile.  Appenders that buffer are made to write out everything,
+    *  whether or not logging is asynchronous.
+    */
+   void flush_logging();
+
 } // namespace fc
 
 #ifndef DEFAULT_LOGGER
@@ -76,32 +193,44 @@ namespace fc
 
 #define fc_dlog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::debug ) ) \
-      (LOGGER).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
+   if( (LOGGER).is_enabled( fc::log_level::debug ) ) { \
+      FC_LOG_SITE( debug ); \
+      (LOGGER).log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 #define fc_ilog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::info ) ) \
-      (LOGGER).log( FC_LOG_MESSAGE( info, FORMAT, __VA_ARGS__ ) ); \
+   if( (LOGGER).is_enabled( fc::log_level::info ) ) { \
+      FC_LOG_SITE( info ); \
+      (LOGGER).log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 #define fc_wlog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::warn ) ) \
-      (LOGGER).log( FC_LOG_MESSAGE( warn, FORMAT, __VA_ARGS__ ) ); \
+   if( (LOGGER).is_enabled( fc::log_level::warn ) ) { \
+      FC_LOG_SITE( warn ); \
+      (LOGGER).log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 #define fc_elog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::error ) ) \
-      (LOGGER).log( FC_LOG_MESSAGE( error, FORMAT, __VA_ARGS__ ) ); \
+   if( (LOGGER).is_enabled( fc::log_level::error ) ) { \
+      FC_LOG_SITE( error ); \
+      (LOGGER).log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 #define dlog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::debug ) ) \
-      (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
+   static fc::cached_logger& fc_cached_logger = *new fc::cached_logger{ DEFAULT_LOGGER }; \
+   if( fc_cached_logger.is_enabled( fc::log_level::debug ) ) { \
+      fc::logger fc_logger = fc_cached_logger.get(); \
+      FC_LOG_SITE( debug ); \
+      fc_logger.log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 /**
@@ -110,29 +239,82 @@ namespace fc
  */
 #define ulog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get("user")).is_enabled( fc::log_level::debug ) ) \
-      (fc::logger::get("user")).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
+   static fc::cached_logger& fc_cached_logger = *new fc::cached_logger{ "user" }; \
+   if( fc_cached_logger.is_enabled( fc::log_level::debug ) ) { \
+      fc::logger fc_logger = fc_cached_logger.get(); \
+      FC_LOG_SITE( debug ); \
+      fc_logger.log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 
 #define ilog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::info ) ) \
-      (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( info, FORMAT, __VA_ARGS__ ) ); \
+   static fc::cached_logger& fc_cached_logger = *new fc::cached_logger{ DEFAULT_LOGGER }; \
+   if( fc_cached_logger.is_enabled( fc::log_level::info ) ) { \
+      fc::logger fc_logger = fc_cached_logger.get(); \
+      FC_LOG_SITE( info ); \
+      fc_logger.log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 #define wlog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::warn ) ) \
-      (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( warn, FORMAT, __VA_ARGS__ ) ); \
+   static fc::cached_logger& fc_cached_logger = *new fc::cached_logger{ DEFAULT_LOGGER }; \
+   if( fc_cached_logger.is_enabled( fc::log_level::warn ) ) { \
+      fc::logger fc_logger = fc_cached_logger.get(); \
+      FC_LOG_SITE( warn ); \
+      fc_logger.log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
 #define elog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::error ) ) \
-      (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( error, FORMAT, __VA_ARGS__ ) ); \
+   static fc::cached_logger& fc_cached_logger = *new fc::cached_logger{ DEFAULT_LOGGER }; \
+   if( fc_cached_logger.is_enabled( fc::log_level::error ) ) { \
+      fc::logger fc_logger = fc_cached_logger.get(); \
+      FC_LOG_SITE( error ); \
+      fc_logger.log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
+  FC_MULTILINE_MACRO_END
+
+/**
+ * @def FC_LOG_LIMITED(LOG_LEVEL,CHECK,FORMAT,...)
+ * @brief Logs to the default logger only if the call site's log_limiter agrees, e.g.
+ *        wlog_rate( 10, "..." ) logs at most ten times a second and then reports how
+ *        many statements it suppressed, wlog_every_n( 100, "..." ) logs every 100th time.
+ */
+#define FC_LOG_LIMITED( LOG_LEVEL, CHECK, FORMAT, ... ) \
+  FC_MULTILINE_MACRO_BEGIN \
+   static fc::cached_logger& fc_cached_logger = *new fc::cached_logger{ DEFAULT_LOGGER }; \
+   if( fc_cached_logger.is_enabled( fc::log_level::LOG_LEVEL ) ) { \
+      FC_LOG_SITE( LOG_LEVEL ); \
+      static fc::log_limiter& fc_log_limiter = *new fc::log_limiter( fc_cached_logger, fc_log_site, FORMAT ); \
+      if( fc_log_limiter.CHECK ) \
+         fc_cached_logger.get().log( FC_LOG_RECORD( FORMAT, __VA_ARGS__ ) ); \
+   } \
   FC_MULTILINE_MACRO_END
 
+#define dlog_every_n( N, FORMAT, ... ) \
+   FC_LOG_LIMITED( debug, every_n( N ), FORMAT, __VA_ARGS__ )
+#define dlog_rate( PER_SECOND, FORMAT, ... ) \
+   FC_LOG_LIMITED( debug, rate( PER_SECOND ), FORMAT, __VA_ARGS__ )
+
+#define ilog_every_n( N, FORMAT, ... ) \
+   FC_LOG_LIMITED( info, every_n( N ), FORMAT, __VA_ARGS__ )
+#define ilog_rate( PER_SECOND, FORMAT, ... ) \
+   FC_LOG_LIMITED( info, rate( PER_SECOND ), FORMAT, __VA_ARGS__ )
+
+#define wlog_every_n( N, FORMAT, ... ) \
+   FC_LOG_LIMITED( warn, every_n( N ), FORMAT, __VA_ARGS__ )
+#define wlog_rate( PER_SECOND, FORMAT, ... ) \
+   FC_LOG_LIMITED( warn, rate( PER_SECOND ), FORMAT, __VA_ARGS__ )
+
+#define elog_every_n( N, FORMAT, ... ) \
+   FC_LOG_LIMITED( error, every_n( N ), FORMAT, __VA_ARGS__ )
+#define elog_rate( PER_SECOND, FORMAT, ... ) \
+   FC_LOG_LIMITED( error, rate( PER_SECOND ), FORMAT, __VA_ARGS__ )
+
 #include <boost/preprocessor/seq/for_each.hpp>
 #include <boost/preprocessor/seq/enum.hpp>
 #include <boost/preprocessor/seq/size.hpp>
@@ -162,10 +344,84 @@ namespace fc
 #define edump( SEQ ) \
     elog( FC_FORMAT(SEQ), FC_FORMAT_ARG_PARAMS(SEQ) )  
 
+/**
+ * FC_LOG_MIN_LEVEL removes the logging statements below the given level at compile time,
+ * e.g. -DFC_LOG_MIN_LEVEL=FC_LOG_LEVEL_WARN leaves only wlog and elog.
+ */
+#define FC_LOG_LEVEL_ALL    0
+#define FC_LOG_LEVEL_DEBUG  1
+#define FC_LOG_LEVEL_INFO   2
+#define FC_LOG_LEVEL_WARN   3
+#define FC_LOG_LEVEL_ERROR  4
+#define FC_LOG_LEVEL_OFF    5
+
+#ifndef FC_LOG_MIN_LEVEL
+# define FC_LOG_MIN_LEVEL FC_LOG_LEVEL_ALL
+#endif
+
+#if FC_LOG_MIN_LEVEL > FC_LOG_LEVEL_DEBUG
+# undef dlog_every_n
+# define dlog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef dlog_rate
+# define dlog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef ulog
+# define ulog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef dlog
+# define dlog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef fc_dlog
+# define fc_dlog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+#endif
+#if FC_LOG_MIN_LEVEL > FC_LOG_LEVEL_INFO
+# undef ilog_every_n
+# define ilog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef ilog_rate
+# define ilog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef ilog
+# define ilog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef fc_ilog
+# define fc_ilog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+#endif
+#if FC_LOG_MIN_LEVEL > FC_LOG_LEVEL_WARN
+# undef wlog_every_n
+# define wlog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef wlog_rate
+# define wlog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef wlog
+# define wlog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef fc_wlog
+# define fc_wlog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+#endif
+#if FC_LOG_MIN_LEVEL > FC_LOG_LEVEL_ERROR
+# undef elog_every_n
+# define elog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef elog_rate
+# define elog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef elog
+# define elog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef fc_elog
+# define fc_elog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+#endif
+
 // this disables all normal logging statements -- not something you'd normally want to do,
 // but it's useful if you're benchmarking something and suspect logging is causing
 // a slowdown.
 #ifdef FC_DISABLE_LOGGING
+# undef elog_every_n
+# define elog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef elog_rate
+# define elog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef wlog_every_n
+# define wlog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef wlog_rate
+# define wlog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef ilog_every_n
+# define ilog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef ilog_rate
+# define ilog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef dlog_every_n
+# define dlog_every_n(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef dlog_rate
+# define dlog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
 # undef ulog
 # define ulog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
 # undef elog
@@ -32,11 +32,31 @@ namespace fc {
       logger_config& add_appender( const string& s );
    };
 
+   /**
+    *  When enabled, logger::log() only copies the message into a bounded queue and a
+    *  dedicated writer thread formats it and drives the appenders in batches.
+    */
+   struct async_logging_config {
+      struct overflow_policy { enum type {
+         block,            ///< wait for the writer to make room
+         drop,             ///< discard the message
+         drop_and_report   ///< discard the message and have the writer log how many were lost
+      }; };
+
+      bool                        enabled    = false;
+      /// rounded up to a power of two
+      uint32_t                    queue_size = 8192;
+      overflow_policy::type       overflow   = overflow_policy::block;
+      /// error messages wait up to 100ms for the writer to write them, so they are likely to survive a crash
+      bool                        flush_on_error = false;
+   };
+
    struct logging_config {
       static logging_config default_config();
       std::vector<string>          includes;
       std::vector<appender_config> appenders;
       std::vector<logger_config>   loggers;
+      async_logging_config         async;
    };
 
    void configure_logging( const fc::path& log_config );
@@ -46,4 +66,6 @@ namespace fc {
 #include <fc/reflect/reflect.hpp>
 FC_REFLECT( fc::appender_config, (name)(type)(args)(enabled) )
 FC_REFLECT( fc::logger_config, (name)(parent)(level)(enabled)(additivity)(appenders) )
-FC_REFLECT( fc::logging_config, (includes)(appenders)(loggers) )
+FC_REFLECT_ENUM( fc::async_logging_config::overflow_policy::type, (block)(drop)(drop_and_report) )
+FC_REFLECT( fc::async_logging_config, (enabled)(queue_size)(overflow)(flush_on_error) )
+FC_REFLECT( fc::logging_config, (includes)(appenders)(loggers)(async) )
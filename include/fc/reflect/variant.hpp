@@ -20,41 +20,62 @@ namespace fc
          template<typename Member, class Class, Member (Class::*member)>
          void operator()( const char* name )const
          {
-            this->add(vo,name,(val.*member));
+            static const variant_key key = variant_key::intern( name );
+            this->add(vo,key,(val.*member));
          }
 
       private:
          template<typename M>
-         void add( mutable_variant_object& vo, const char* name, const optional<M>& v )const
+         void add( mutable_variant_object& vo, const variant_key& key, const optional<M>& v )const
          { 
             if( v.valid() )
-               vo(name,*v);
+               vo(key,*v);
          }
          template<typename M>
-         void add( mutable_variant_object& vo, const char* name, const M& v )const
-         { vo(name,v); }
+         void add( mutable_variant_object& vo, const variant_key& key, const M& v )const
+         { vo(key,v); }
 
          mutable_variant_object& vo;
          const T& val;
    };
 
+   /**
+    *  Objects are usually produced by to_variant_visitor, so while the entries seen
+    *  so far were exactly the preceding members, the next member is first expected
+    *  in the next entry.  Otherwise the key is looked up, which keeps the first of
+    *  duplicate keys winning.
+    */
    template<typename T>
    class from_variant_visitor
    {
       public:
          from_variant_visitor( const variant_object& _vo, T& v )
-         :vo(_vo),val(v){}
+         :vo(_vo),val(v),next(_vo.begin()),in_order(true){}
 
          template<typename Member, class Class, Member (Class::*member)>
          void operator()( const char* name )const
          {
-            auto itr = vo.find(name);
+            static const variant_key key = variant_key::intern( name );
+            auto itr = vo.end();
+            if( in_order && next != vo.end() && next->shared_key() == key )
+               itr = next;
+            else
+            {
+               itr = vo.find(key);
+               if( itr != vo.end() && itr != next )
+                  in_order = false;
+            }
             if( itr != vo.end() )
+            {
                from_variant( itr->value(), val.*member );
+               next = itr + 1;
+            }
          }
 
          const variant_object& vo;
          T& val;
+         mutable variant_object::iterator next;
+         mutable bool                     in_order;
    };
 
    template<typename IsReflected=fc::false_type>
@@ -64,6 +85,7 @@ namespace fc
      static inline void to_variant( const T& v, fc::variant& vo ) 
      { 
          mutable_variant_object mvo;
+         mvo.reserve( fc::reflector<T>::total_member_count );
          fc::reflector<T>::visit( to_variant_visitor<T>( mvo, v ) );
          vo = fc::move(mvo);
      }
@@ -87,7 +109,7 @@ namespace fc
        static inline void from_variant( const fc::variant& v, T& o ) 
        { 
            if( v.is_string() )
-              o = fc::reflector<T>::from_string( v.get_string().c_str() );
+              o = fc::reflector<T>::from_string( v.as_string().c_str() );
            else
               o = fc::reflector<T>::from_int( v.as_int64() );
        }
@@ -1,5 +1,6 @@
 #pragma once
 #include <fc/variant.hpp>
+#include <fc/io/json_document.hpp>
 #include <fc/optional.hpp>
 #include <fc/api.hpp>
 #include <fc/any.hpp>
@@ -110,6 +111,14 @@ namespace fc {
             return call( itr->second, args );
          }
 
+         /** looks the method up before decoding args */
+         variant call( const string& name, const json_value& args )
+         {
+            auto itr = _by_name.find(name);
+            FC_ASSERT( itr != _by_name.end(), "no method with name '${name}'", ("name",name)("api",_by_name) );
+            return call( itr->second, args.as_variants() );
+         }
+
          variant call( uint32_t method_id, const variants& args )
          {
             FC_ASSERT( method_id < _methods.size() );
@@ -229,6 +238,11 @@ namespace fc {
             FC_ASSERT( _local_apis.size() > api_id );
             return _local_apis[api_id]->call( method_name, args );
          }
+         variant receive_call( api_id_type api_id, const string& method_name, const json_value& args )const
+         {
+            FC_ASSERT( _local_apis.size() > api_id );
+            return _local_apis[api_id]->call( method_name, args );
+         }
          variant receive_callback( uint64_t callback_id,  const variants& args = variants() )const
          {
             FC_ASSERT( _local_callbacks.size() > callback_id );
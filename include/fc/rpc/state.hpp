@@ -1,5 +1,6 @@
 #pragma once
 #include <fc/variant.hpp>
+#include <fc/io/json_document.hpp>
 #include <functional>
 #include <fc/thread/future.hpp>
 #include <fstream>
@@ -24,7 +25,7 @@ namespace fc { namespace rpc {
    struct response
    {
       response(){}
-      response( int64_t i, fc::variant r ):id(i),result(r){}
+      response( int64_t i, fc::variant r ):id(i),result(std::move(r)){}
       response( int64_t i, error_object r ):id(i),error(r){}
       int64_t                id = 0;
       optional<fc::variant>  result;
@@ -35,12 +36,20 @@ namespace fc { namespace rpc {
    {
       public:
          typedef std::function<variant(const variants&)>       method;
+         /** a method that inspects its arguments in place instead of receiving decoded variants */
+         typedef std::function<variant(const json_value&)>     lazy_method;
          ~state();
 
          void add_method( const fc::string& name, method m );
+         void add_lazy_method( const fc::string& name, lazy_method m );
          void remove_method( const fc::string& name );
 
          variant local_call( const string& method_name, const variants& args );
+         /**
+          *  Dispatches without decoding args unless the target needs variants, so calls
+          *  to unknown methods are rejected before their arguments are parsed.
+          */
+         variant local_call( const string& method_name, const json_value& args );
          void    handle_reply( const response& response );
 
          request start_remote_call( const string& method_name, variants args );
@@ -54,6 +63,7 @@ namespace fc { namespace rpc {
          uint64_t                                                   _next_id = 1;
          std::unordered_map<uint64_t, fc::promise<variant>::ptr>    _awaiting;
          std::unordered_map<std::string, method>                    _methods;
+         std::unordered_map<std::string, lazy_method>               _lazy_methods;
          std::function<variant(const string&,const variants&)>                    _unhandled;
    };
 
@@ -12,6 +12,10 @@ namespace fc
   int64_t  to_int64( const fc::string& );
   uint64_t to_uint64( const fc::string& );
   double   to_double( const fc::string& );
+  /** the same, from len characters at s that need not be null terminated */
+  int64_t  to_int64( const char* s, size_t len );
+  uint64_t to_uint64( const char* s, size_t len );
+  double   to_double( const char* s, size_t len );
   fc::string to_string( double );
   fc::string to_string( uint64_t );
   fc::string to_string( int64_t );
@@ -141,6 +145,10 @@ namespace fc {
   int64_t  to_int64( const fc::string& );
   uint64_t to_uint64( const fc::string& );
   double   to_double( const fc::string& );
+  /** the same, from len characters at s that need not be null terminated */
+  int64_t  to_int64( const char* s, size_t len );
+  uint64_t to_uint64( const char* s, size_t len );
+  double   to_double( const char* s, size_t len );
   fc::string to_string( double );
   fc::string to_string( uint64_t );
   fc::string to_string( int64_t );
@@ -0,0 +1,368 @@
+#pragma once
+#include <fc/thread/future.hpp>
+#include <fc/thread/spin_lock.hpp>
+#include <fc/exception/exception.hpp>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace fc
+{
+   namespace detail { class channel_base; }
+   int select_until( const std::vector<detail::channel_base*>& channels, const time_point& deadline );
+
+   namespace detail
+   {
+      /** one fiber waiting on one or more channels, woken at most once */
+      class channel_waiter
+      {
+         public:
+            channel_waiter():_prom( new fc::promise<void>( "fc::channel wait" ) ),_woken(false){}
+
+            /** @return false if the waiter had been woken already */
+            bool wake()
+            {
+               if( _woken.exchange( true ) )
+                  return false;
+               _prom->set_value();
+               return true;
+            }
+
+            /** waits until woken or deadline, @return false on timeout */
+            bool wait_until( const time_point& deadline );
+
+         private:
+            fc::promise<void>::ptr _prom;
+            std::atomic<bool>      _woken;
+      };
+      typedef std::shared_ptr<channel_waiter> channel_waiter_ptr;
+
+      /**
+       *  A bounded lock free multi-producer/multi-consumer ring of cells with sequence numbers
+       *  (Vyukov).  The capacity is rounded up to a power of two.  T's move constructor and
+       *  move assignment must not throw.
+       */
+      template<typename T>
+      class mpmc_ring
+      {
+         public:
+            explicit mpmc_ring( size_t capacity )
+            {
+               size_t size = 2;
+               while( size < capacity )
+                  size <<= 1;
+               _mask = size - 1;
+               _cells.reset( new cell[size] );
+               for( size_t i = 0; i < size; ++i )
+                  _cells[i].seq.store( i, std::memory_order_relaxed );
+               _enqueue_pos.store( 0, std::memory_order_relaxed );
+               _dequeue_pos.store( 0, std::memory_order_relaxed );
+            }
+
+            ~mpmc_ring()
+            {
+               T item;
+               while( try_pop( item ) );
+            }
+
+            size_t capacity()const { return _mask + 1; }
+
+            size_t size()const
+            {
+               const size_t head = _dequeue_pos.load( std::memory_order_acquire );
+               const size_t tail = _enqueue_pos.load( std::memory_order_acquire );
+               return tail > head ? tail - head : 0;
+            }
+
+            /** moves from v only if it succeeds */
+            bool try_push( T& v )
+            {
+               size_t pos = _enqueue_pos.load( std::memory_order_relaxed );
+               cell*  c;
+               for( ;; )
+               {
+                  c = &_cells[pos & _mask];
+                  const size_t   seq  = c->seq.load( std::memory_order_acquire );
+                  const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+                  if( diff == 0 )
+                  {
+                     if( _enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                        break;
+                  }
+                  else if( diff < 0 )
+                     return false; // full
+                  else
+                     pos = _enqueue_pos.load( std::memory_order_relaxed );
+               }
+               new (&c->storage) T( std::move(v) );
+               c->seq.store( pos + 1, std::memory_order_release );
+               return true;
+            }
+
+            bool try_pop( T& out )
+            {
+               size_t pos = _dequeue_pos.load( std::memory_order_relaxed );
+               cell*  c;
+               for( ;; )
+               {
+                  c = &_cells[pos & _mask];
+                  const size_t   seq  = c->seq.load( std::memory_order_acquire );
+                  const intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+                  if( diff == 0 )
+                  {
+                     if( _dequeue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                        break;
+                  }
+                  else if( diff < 0 )
+                     return false; // empty
+                  else
+                     pos = _dequeue_pos.load( std::memory_order_relaxed );
+               }
+               T* item = reinterpret_cast<T*>( &c->storage );
+               out = std::move( *item );
+               item->~T();
+               c->seq.store( pos + _mask + 1, std::memory_order_release );
+               return true;
+            }
+
+         private:
+            struct cell
+            {
+               std::atomic<size_t>                                         seq;
+               typename std::aligned_storage<sizeof(T),alignof(T)>::type  storage;
+            };
+
+            std::unique_ptr<cell[]> _cells;
+            size_t                  _mask;
+            char                    _pad0[64];
+            std::atomic<size_t>     _enqueue_pos;
+            char                    _pad1[64];
+            std::atomic<size_t>     _dequeue_pos;
+            char                    _pad2[64];
+      };
+
+      /** the waiting, waking and closing of a channel, independent of its element type */
+      class channel_base
+      {
+         public:
+            channel_base();
+            virtual ~channel_base(){}
+
+            /** wakes all waiters; sends fail from now on, receives drain what was sent before */
+            void close();
+            bool closed()const { return _closed.load( std::memory_order_acquire ); }
+
+            /** true if a receive would not wait: there is an item or the channel is closed */
+            virtual bool receivable()const = 0;
+            /** true if a send would not wait: there is room or the channel is closed */
+            virtual bool sendable()const = 0;
+
+         protected:
+            /** wait for receivable() / sendable(), @return false on timeout */
+            bool wait_receivable( const time_point& deadline ) { return wait( _receivers, &channel_base::receivable, deadline ); }
+            bool wait_sendable( const time_point& deadline )   { return wait( _senders, &channel_base::sendable, deadline ); }
+
+            /** after items were sent: wakes receivers for them and, if there is still room, a sender */
+            void sent( size_t items )
+            {
+               // the fence orders the sends before the reads of the waiter counts, as waiters
+               // register before checking for items (see wait())
+               std::atomic_thread_fence( std::memory_order_seq_cst );
+               if( _waiting_receivers.load( std::memory_order_relaxed ) )
+                  wake( _receivers, items );
+               if( _waiting_senders.load( std::memory_order_relaxed ) && sendable() )
+                  wake( _senders, 1 );
+            }
+
+            /** after items were received: wakes senders for the room and, if there are items left, a receiver */
+            void received( size_t items )
+            {
+               std::atomic_thread_fence( std::memory_order_seq_cst );
+               if( _waiting_senders.load( std::memory_order_relaxed ) )
+                  wake( _senders, items );
+               if( _waiting_receivers.load( std::memory_order_relaxed ) && receivable() )
+                  wake( _receivers, 1 );
+            }
+
+         private:
+            friend int fc::select_until( const std::vector<channel_base*>& channels, const time_point& deadline );
+
+            struct waiter_list
+            {
+               std::deque<channel_waiter_ptr> waiters;
+               std::atomic<uint32_t>*         count;
+            };
+
+            bool wait( waiter_list& list, bool (channel_base::*ready)()const, const time_point& deadline );
+            void add( waiter_list& list, const channel_waiter_ptr& w );
+            void remove( waiter_list& list, const channel_waiter_ptr& w );
+            void wake( waiter_list& list, size_t n );
+
+            spin_lock              _lock;
+            waiter_list            _receivers;
+            waiter_list            _senders;
+            std::atomic<uint32_t>  _waiting_receivers;
+            std::atomic<uint32_t>  _waiting_senders;
+            std::atomic<bool>      _closed;
+      };
+   } // namespace detail
+
+   /**
+    *  @brief a bounded multi-producer/multi-consumer queue between fibers on any threads
+    *
+    *  Sends and receives that need not wait are lock free.  A fiber sending to a full
+    *  channel, or receiving from an empty one, yields until it can go on, so producers are
+    *  held back by slow consumers.  After close() sends throw and receives return what is
+    *  left, then report the end.  select() waits on several channels at once.
+    *
+    *  T's move constructor and move assignment must not throw, and T must be default
+    *  constructible.
+    */
+   template<typename T>
+   class channel : public detail::channel_base
+   {
+      public:
+         /** capacity is rounded up to a power of two */
+         explicit channel( size_t capacity ):_ring( capacity ){}
+
+         size_t capacity()const { return _ring.capacity(); }
+         /** the number of items in the channel, only a snapshot when others use it too */
+         size_t size()const     { return _ring.size(); }
+         bool   empty()const    { return size() == 0; }
+
+         virtual bool receivable()const override { return !empty() || closed(); }
+         virtual bool sendable()const override   { return size() < capacity() || closed(); }
+
+         /** @return false if the channel is full, @throws eof_exception if it is closed */
+         bool try_send( T&& v )
+         {
+            if( closed() )
+               FC_THROW_EXCEPTION( eof_exception, "send on a closed channel" );
+            if( !_ring.try_push( v ) )
+               return false;
+            sent( 1 );
+            return true;
+         }
+         bool try_send( const T& v ) { T copy(v); return try_send( std::move(copy) ); }
+
+         /**
+          *  Waits for room if the channel is full.
+          *  @return false on timeout
+          *  @throws eof_exception if the channel is closed
+          */
+         bool send( T&& v, const microseconds& timeout = microseconds::maximum() )
+         {
+            const time_point deadline = timeout == microseconds::maximum() ? time_point::maximum() : time_point::now() + timeout;
+            while( !try_send( std::move(v) ) )
+               if( !wait_sendable( deadline ) )
+                  return false;
+            return true;
+         }
+         bool send( const T& v, const microseconds& timeout = microseconds::maximum() ) { T copy(v); return send( std::move(copy), timeout ); }
+
+         /**
+          *  Sends all of [begin, end), waiting for room as needed; receivers are woken once
+          *  per batch that fits rather than once per item.
+          *  @throws eof_exception if the channel is closed before all were sent
+          */
+         template<typename Iterator>
+         void send( Iterator begin, Iterator end )
+         {
+            while( begin != end )
+            {
+               if( closed() )
+                  FC_THROW_EXCEPTION( eof_exception, "send on a closed channel" );
+               size_t batch = 0;
+               for( ; begin != end; ++begin, ++batch )
+               {
+                  T v( *begin );
+                  if( !_ring.try_push( v ) )
+                     break;
+               }
+               if( batch )
+                  sent( batch );
+               if( begin != end )
+                  wait_sendable( time_point::maximum() );
+            }
+         }
+
+         /** @return false if the channel is empty */
+         bool try_receive( T& out )
+         {
+            if( !_ring.try_pop( out ) )
+               return false;
+            received( 1 );
+            return true;
+         }
+
+         /**
+          *  Waits for an item if the channel is empty.
+          *  @return false if the channel is closed and drained, or on timeout
+          */
+         bool receive( T& out, const microseconds& timeout = microseconds::maximum() )
+         {
+            const time_point deadline = timeout == microseconds::maximum() ? time_point::maximum() : time_point::now() + timeout;
+            for( ;; )
+            {
+               if( try_receive( out ) )
+                  return true;
+               if( closed() )
+                  return try_receive( out ); // items may have been sent just before the close
+               if( !wait_receivable( deadline ) )
+                  return false;
+            }
+         }
+
+         /**
+          *  Waits for at least one item, then appends up to max_items that are there to out.
+          *  @return the number of items received, 0 once the channel is closed and drained
+          *  @pre max_items > 0
+          */
+         size_t receive( std::vector<T>& out, size_t max_items )
+         {
+            FC_ASSERT( max_items > 0, "a batch receive takes at least one item" );
+            for( ;; )
+            {
+               size_t n = 0;
+               T      v;
+               while( n < max_items && _ring.try_pop( v ) )
+               {
+                  out.push_back( std::move(v) );
+                  ++n;
+               }
+               if( n )
+               {
+                  received( n );
+                  return n;
+               }
+               if( closed() )
+               {
+                  if( !try_receive( v ) )
+                     return 0;
+                  out.push_back( std::move(v) );
+                  return 1;
+               }
+               wait_receivable( time_point::maximum() );
+            }
+         }
+
+      private:
+         detail::mpmc_ring<T> _ring;
+   };
+
+   /**
+    *  Waits until one of the channels is receivable(), i.e. has an item or is closed.
+    *  Others may still take the item before the caller does, so try_receive() from the
+    *  channel and select again if it comes back empty.
+    *
+    *  @return the index of that channel, -1 on timeout
+    */
+   int select_until( const std::vector<detail::channel_base*>& channels, const time_point& deadline );
+   inline int select( const std::vector<detail::channel_base*>& channels, const microseconds& timeout = microseconds::maximum() )
+   {
+      return select_until( channels, timeout == microseconds::maximum() ? time_point::maximum() : time_point::now() + timeout );
+   }
+
+} // namespace fc
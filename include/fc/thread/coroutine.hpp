@@ -0,0 +1,320 @@
+#pragma once
+/**
+ *  @file fc/thread/coroutine.hpp
+ *  @brief C++20 coroutines on fc threads
+ *
+ *  Makes fc::future<T> and fc::promise<T>::ptr awaitable and adds fc::task_co<T>, a
+ *  coroutine scheduled on the ready queue of the fc::thread that created it.  A suspended
+ *  coroutine keeps only its frame, not a fiber stack, and is resumed by a task posted to
+ *  its thread, so coroutines and fibers on a thread interleave like any other tasks.
+ *
+ *  fc itself builds without coroutines; this header is empty unless the code including it
+ *  is compiled with coroutine support (e.g. -std=c++20).
+ */
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/thread/spin_lock.hpp>
+#include <fc/thread/scoped_lock.hpp>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+# if __has_include(<coroutine>)
+#  define FC_HAS_COROUTINES 1
+# endif
+#endif
+
+#ifdef FC_HAS_COROUTINES
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace fc {
+
+  template<typename T = void>
+  class task_co;
+
+  namespace detail
+  {
+     /**
+      *  Suspends the awaiting coroutine until the future is ready, then resumes it on the
+      *  fc::thread it was suspended on.  This uses the promise's completion handler, so a
+      *  promise can only be awaited by one coroutine and not also have an on_complete().
+      */
+     template<typename T>
+     class future_awaiter
+     {
+        public:
+           explicit future_awaiter( const fc::future<T>& f ):_fut(f){}
+
+           bool await_ready()const { return _fut.ready(); }
+
+           void await_suspend( std::coroutine_handle<> h )
+           {
+              thread* t = &thread::current();
+              // the handler misses a promise that is set while it is being installed, so
+              // check again afterwards and let whoever comes first resume the coroutine
+              auto claimed = std::make_shared< std::atomic<bool> >( false );
+              _resume = [t,h,claimed]()
+              {
+                 if( !claimed->exchange( true ) )
+                    t->post( [h](){ h.resume(); }, "fc::co_await resume" );
+              };
+              auto resume = _resume;
+              _fut.on_complete( [resume]( const auto&... ){ resume(); } );
+              if( _fut.ready() )
+                 resume();
+           }
+
+           /** returns the value or throws the promise's exception */
+           T await_resume() { return _fut.wait(); }
+
+           /**
+            *  Resumes the suspended coroutine before the future is ready, the completion
+            *  handler then finds it claimed.  Only valid after await_suspend().
+            */
+           const std::function<void()>& resumer()const { return _resume; }
+
+        private:
+           fc::future<T>         _fut;
+           std::function<void()> _resume;
+     };
+
+     /**
+      *  The promise behind a task_co.  cancel() also resumes the coroutine if it is suspended
+      *  on a future, so a task_co waiting for something that never completes still ends.
+      */
+     template<typename T>
+     class task_co_result : public fc::promise<T>
+     {
+        public:
+           typedef fc::shared_ptr< task_co_result<T> > ptr;
+           task_co_result():fc::promise<T>( "fc::task_co" ){}
+
+           virtual void cancel( const char* reason FC_CANCELATION_REASON_DEFAULT_ARG ) override
+           {
+              fc::promise<T>::cancel( reason );
+              wake();
+           }
+
+           /** wakes the coroutine on cancel(), or right away if it is canceled already */
+           void set_waker( const std::function<void()>& w )
+           {
+              {
+                 fc::scoped_lock<fc::spin_lock> lock( _lock );
+                 _waker = w;
+              }
+              if( this->canceled() )
+                 wake();
+           }
+
+           void clear_waker()
+           {
+              fc::scoped_lock<fc::spin_lock> lock( _lock );
+              _waker = nullptr;
+           }
+
+        private:
+           void wake()
+           {
+              std::function<void()> w;
+              {
+                 fc::scoped_lock<fc::spin_lock> lock( _lock );
+                 std::swap( w, _waker );
+              }
+              if( w )
+                 w();
+           }
+
+           fc::spin_lock         _lock;
+           std::function<void()> _waker;
+     };
+
+     /**
+      *  Wraps the awaiter of anything a task_co awaits to throw once the task is canceled.
+      *  An fc::future is also woken by cancel(), anything else is noticed once it resumes.
+      */
+     template<typename Awaiter, typename T>
+     class cancelable_awaiter
+     {
+        public:
+           cancelable_awaiter( Awaiter&& a, task_co_result<T>& task )
+           :_inner( std::forward<Awaiter>(a) ),_task(task){}
+
+           bool await_ready() { return _inner.await_ready(); }
+
+           template<typename Promise>
+           decltype(auto) await_suspend( std::coroutine_handle<Promise> h )
+           {
+              if constexpr( requires { _inner.resumer(); } )
+              {
+                 // the resume is posted to this thread, so the coroutine is still suspended here
+                 _inner.await_suspend( h );
+                 _task.set_waker( _inner.resumer() );
+              }
+              else
+                 return _inner.await_suspend( h );
+           }
+
+           decltype(auto) await_resume()
+           {
+              if constexpr( requires { _inner.resumer(); } )
+                 _task.clear_waker();
+              if( _task.canceled() )
+                 FC_THROW_EXCEPTION( canceled_exception, "task_co ${desc} canceled", ("desc", _task.get_desc()) );
+              return _inner.await_resume();
+           }
+
+        private:
+           Awaiter            _inner;
+           task_co_result<T>& _task;
+     };
+
+     template<typename Awaitable>
+     decltype(auto) get_awaiter( Awaitable&& a )
+     {
+        if constexpr( requires { std::forward<Awaitable>(a).operator co_await(); } )
+           return std::forward<Awaitable>(a).operator co_await();
+        else if constexpr( requires { operator co_await( std::forward<Awaitable>(a) ); } )
+           return operator co_await( std::forward<Awaitable>(a) );
+        else
+           return std::forward<Awaitable>(a);
+     }
+
+     /** what task_co<T>::promise_type has in common for T and void */
+     template<typename T>
+     class task_co_promise_base
+     {
+        public:
+           task_co_promise_base()
+           :_result( new task_co_result<T>() ),_thread( &thread::current() ){}
+
+           /** the coroutine starts from a task posted to its thread, not in the caller */
+           class start_awaiter
+           {
+              public:
+                 bool await_ready()const noexcept { return false; }
+
+                 template<typename Promise>
+                 void await_suspend( std::coroutine_handle<Promise> h )
+                 {
+                    h.promise()._thread->post( [h]()
+                    {
+                       typename task_co_result<T>::ptr result = h.promise()._result;
+                       if( result->canceled() )
+                       {
+                          h.destroy();
+                          result->set_exception( std::make_shared<canceled_exception>(
+                                FC_LOG_MESSAGE( error, "task_co ${desc} canceled before it started", ("desc", result->get_desc()) ) ) );
+                          return;
+                       }
+                       h.resume();
+                    }, "fc::task_co start" );
+                 }
+
+                 void await_resume()const noexcept {}
+           };
+
+           start_awaiter initial_suspend() { return start_awaiter(); }
+
+           std::suspend_never final_suspend()noexcept { return {}; }
+
+           void unhandled_exception()
+           {
+              try
+              {
+                 throw;
+              }
+              catch( const exception& e )
+              {
+                 _result->set_exception( e.dynamic_copy_exception() );
+              }
+              catch( ... )
+              {
+                 _result->set_exception( std::make_shared<fc::unhandled_exception>(
+                       FC_LOG_MESSAGE( warn, "unhandled exception: ${diagnostic}", ("diagnostic", fc::except_str()) ) ) );
+              }
+           }
+
+           /** every co_await in a task_co throws canceled_exception once the task is canceled */
+           template<typename Awaitable>
+           auto await_transform( Awaitable&& a )
+           {
+              typedef decltype( get_awaiter( std::forward<Awaitable>(a) ) ) awaiter_type;
+              return cancelable_awaiter<awaiter_type, T>( get_awaiter( std::forward<Awaitable>(a) ), *_result );
+           }
+
+        protected:
+           typename task_co_result<T>::ptr _result;
+           thread*                         _thread;
+     };
+  } // namespace detail
+
+  template<typename T>
+  auto operator co_await( const fc::future<T>& f )
+  {
+     return detail::future_awaiter<T>( f );
+  }
+
+  template<typename T>
+  auto operator co_await( const fc::shared_ptr< fc::promise<T> >& p )
+  {
+     return detail::future_awaiter<T>( fc::future<T>( p ) );
+  }
+
+  /**
+   *  @brief a coroutine running on an fc::thread, whose result is an fc::future
+   *
+   *  The coroutine is started by a task posted to the thread that calls it, and each
+   *  co_await resumes it there.  Fiber code waits for it with wait() or through
+   *  get_future(), coroutines co_await it.  cancel() makes the coroutine throw
+   *  canceled_exception from its next co_await, or keeps it from starting.  A coroutine
+   *  suspended on an fc::future or another task_co is woken by cancel() and throws right
+   *  away; one suspended on any other awaitable throws once that awaitable resumes it.
+   *
+   *  @code
+   *  fc::task_co<size_t> read_header( boost::asio::ip::tcp::socket& s, char* buf )
+   *  {
+   *     co_return co_await fc::asio::read_some( s, buf, 16 );
+   *  }
+   *  @endcode
+   */
+  template<typename T>
+  class task_co
+  {
+     public:
+        class promise_type : public detail::task_co_promise_base<T>
+        {
+           public:
+              task_co get_return_object() { return task_co( this->_result ); }
+              void return_value( const T& v ) { this->_result->set_value( v ); }
+              void return_value( T&& v )      { this->_result->set_value( std::move(v) ); }
+        };
+
+        fc::future<T> get_future()const { return fc::future<T>( _result ); }
+        operator fc::future<T>()const   { return get_future(); }
+
+        /** blocks the current fiber until the coroutine finishes */
+        decltype(auto) wait()const { return _result->wait(); }
+        bool ready()const          { return _result->ready(); }
+        /** see the class comment for when a started coroutine notices */
+        void cancel( const char* reason FC_CANCELATION_REASON_DEFAULT_ARG )const { _result->cancel( reason ); }
+
+        friend auto operator co_await( const task_co& t ) { return detail::future_awaiter<T>( t.get_future() ); }
+
+     private:
+        explicit task_co( const typename fc::promise<T>::ptr& r ):_result(r){}
+
+        typename fc::promise<T>::ptr _result;
+  };
+
+  template<>
+  class task_co<void>::promise_type : public detail::task_co_promise_base<void>
+  {
+     public:
+        task_co get_return_object() { return task_co( this->_result ); }
+        void return_void() { this->_result->set_value(); }
+  };
+
+} // namespace fc
+#endif // FC_HAS_COROUTINES
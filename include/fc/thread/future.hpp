@@ -58,6 +58,14 @@ namespace fc {
      };
   }
 
+  /** what the calling thread keeps on its free lists of promise and task blocks */
+  struct promise_freelist_stats
+  {
+     uint64_t cached_blocks = 0;
+     uint64_t cached_bytes  = 0;
+  };
+  promise_freelist_stats get_promise_freelist_stats();
+
   class promise_base : public virtual retainable{
     public:
       typedef fc::shared_ptr<promise_base> ptr;
@@ -72,6 +80,10 @@ namespace fc {
 
       void set_exception( const fc::exception_ptr& e );
 
+      /** promises and tasks come from per-thread free lists, one per size class */
+      static void* operator new( size_t size );
+      static void  operator delete( void* p, size_t size );
+
     protected:
       void _wait( const microseconds& timeout_us );
       void _wait_until( const time_point& timeout_us );
@@ -0,0 +1,87 @@
+#pragma once
+#include <fc/time.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/thread/spin_yield_lock.hpp>
+#include <deque>
+#include <stdint.h>
+
+namespace fc {
+
+  /** counts of durations in power of two buckets: [0,1us), [1,2us), [2,4us) ... [2^30us,inf) */
+  struct lock_time_histogram
+  {
+     static const uint32_t buckets = 32;
+     uint64_t              counts[buckets] = {};
+
+     void add( const microseconds& d );
+  };
+
+  struct shared_mutex_stats
+  {
+     lock_time_histogram exclusive_wait;
+     lock_time_histogram shared_wait;
+     lock_time_histogram exclusive_hold;
+     lock_time_histogram shared_hold;  ///< from the first reader in until the last one out
+  };
+
+  /**
+   *  @brief a reader/writer lock for fibers on one or more threads
+   *
+   *  Like fc::mutex a fiber that has to wait yields to the other fibers of its thread
+   *  instead of blocking it, and waiters are queued in arrival order.  The lock is handed
+   *  off: unlocking grants it to the next waiter, or to all waiting readers at once, before
+   *  waking them, so nobody can barge in and only fibers that got the lock are woken.
+   *
+   *  A waiting fiber that is canceled leaves the queue and throws canceled_exception.
+   *
+   *  Writers are preferred: while a writer waits new readers queue behind it, and when the
+   *  lock becomes free a waiting writer gets it before any waiting reader.  Use it where reads
+   *  greatly outnumber writes, continuous writes starve readers.
+   *
+   *  Not recursive.  Works with std::unique_lock / std::shared_lock (or the boost ones).
+   */
+  class shared_mutex {
+    public:
+      shared_mutex();
+      ~shared_mutex();
+
+      void lock();
+      bool try_lock();
+      void unlock();
+
+      void lock_shared();
+      bool try_lock_shared();
+      void unlock_shared();
+
+      /**
+       *  Lock wait and hold time histograms.  They are only recorded if fc itself was built
+       *  with FC_LOCK_STATS=1, the default for debug builds, and are all zero otherwise.
+       */
+      shared_mutex_stats stats()const;
+
+    private:
+      struct waiter
+      {
+        fc::promise<void>::ptr prom;
+        bool                   exclusive;
+        bool                   granted;
+      };
+
+      void wait( bool exclusive );
+      void grant_waiters();
+      void grant( waiter* w );
+      void release_exclusive();
+      void release_shared();
+
+      mutable fc::spin_yield_lock m_lock;
+      std::deque<waiter*>         m_waiters;
+      uint32_t                    m_readers;
+      uint32_t                    m_waiting_writers;
+      bool                        m_writer;
+      // the same in every build, only shared_mutex.cpp looks at FC_LOCK_STATS
+      time_point                  m_exclusive_since;
+      time_point                  m_shared_since;
+      shared_mutex_stats          m_stats;
+  };
+
+} // namespace fc
@@ -1,5 +1,6 @@
 #pragma once
 #include <fc/thread/future.hpp>
+#include <fc/thread/timer_wheel.hpp>
 #include <fc/thread/priority.hpp>
 #include <fc/aligned.hpp>
 #include <fc/fwd.hpp>
@@ -38,6 +39,10 @@ namespace fc {
       uint64_t    _posted_num;
       priority    _prio;
       time_point  _when;
+      size_t      _stack_size; ///< for a new fiber started to run this task, 0 for the default
+      bool        _posted;     ///< nobody holds a future for this task, see thread::post()
+      thread*     _scheduled_on; ///< the thread a task with a future _when waits on
+      timer_wheel::node _timer;  ///< links the task into its thread's task_timers until _when
       void        _set_active_context(context*);
       context*    _active_context;
       task_base*  _next;
@@ -2,6 +2,21 @@
 
 #define FC_CONTEXT_STACK_SIZE (2048*1024)
 
+/** the smallest fiber stack, requested stack sizes are rounded up to a power of two of at least this */
+#ifndef FC_CONTEXT_MIN_STACK_SIZE
+#define FC_CONTEXT_MIN_STACK_SIZE (64*1024)
+#endif
+
+/** released fiber stacks a thread keeps for reuse, per size class */
+#ifndef FC_MAX_POOLED_STACKS
+#define FC_MAX_POOLED_STACKS 64
+#endif
+
+/** fibers a thread keeps parked for new tasks, further idle fibers exit and release their stacks */
+#ifndef FC_MAX_IDLE_CONTEXTS
+#define FC_MAX_IDLE_CONTEXTS 64
+#endif
+
 #include <fc/thread/task.hpp>
 #include <fc/vector.hpp>
 #include <fc/string.hpp>
@@ -64,17 +79,34 @@ namespace fc {
        *
        *  @param f the operation to perform
        *  @param prio the priority relative to other tasks
+       *  @param stack_size the stack the task needs if it is started on a new fiber,
+       *         0 for FC_CONTEXT_STACK_SIZE
        */
       template<typename Functor>
-      auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
+      auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(), size_t stack_size = 0 ) -> fc::future<decltype(f())> {
          typedef decltype(f()) Result;
          typedef typename fc::deduce<Functor>::type FunctorType;
          fc::task<Result,sizeof(FunctorType)>* tsk = 
               new fc::task<Result,sizeof(FunctorType)>( fc::forward<Functor>(f), desc );
          fc::future<Result> r(fc::shared_ptr< fc::promise<Result> >(tsk,true) );
+         tsk->_stack_size = stack_size;
          async_task(tsk,prio);
          return r;
       }
+
+      /**
+       *  Calls function <code>f</code> in this thread without creating a future: use it
+       *  when nobody waits for the result.  Exceptions thrown by f are logged.
+       */
+      template<typename Functor>
+      void post( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(), size_t stack_size = 0 ) {
+         typedef typename fc::deduce<Functor>::type FunctorType;
+         fc::task<void,sizeof(FunctorType)>* tsk = 
+              new fc::task<void,sizeof(FunctorType)>( fc::forward<Functor>(f), desc );
+         tsk->_stack_size = stack_size;
+         tsk->_posted = true;
+         async_task(tsk,prio);
+      }
       void poke();
      
      
@@ -86,14 +118,16 @@ namespace fc {
        *  @param prio the priority of this method relative to others
        *  @param when determines when this call will happen, as soon as 
        *        possible after <code>when</code>
+       *  @param stack_size as for async()
        */
       template<typename Functor>
       auto schedule( Functor&& f, const fc::time_point& when, 
-                     const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
+                     const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(), size_t stack_size = 0 ) -> fc::future<decltype(f())> {
          typedef decltype(f()) Result;
          fc::task<Result,sizeof(Functor)>* tsk = 
               new fc::task<Result,sizeof(Functor)>( fc::forward<Functor>(f), desc );
          fc::future<Result> r(fc::shared_ptr< fc::promise<Result> >(tsk,true) );
+         tsk->_stack_size = stack_size;
          async_task(tsk,prio,when);
          return r;
       }
@@ -159,7 +193,7 @@ namespace fc {
       void async_task( task_base* t, const priority& p );
       void async_task( task_base* t, const priority& p, const time_point& tp );
 
-      void notify_task_has_been_canceled();
+      void notify_task_has_been_canceled( task_base* t );
       void unblock(fc::context* c);
 
       class thread_d* my;
@@ -198,13 +232,27 @@ namespace fc {
    int wait_any_until( std::vector<promise_base::ptr>&& v, const time_point& tp );
 
    template<typename Functor>
-   auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
-      return fc::thread::current().async( fc::forward<Functor>(f), desc, prio );
+   auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(), size_t stack_size = 0 ) -> fc::future<decltype(f())> {
+      return fc::thread::current().async( fc::forward<Functor>(f), desc, prio, stack_size );
    }
    template<typename Functor>
-   auto schedule( Functor&& f, const fc::time_point& t, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
-      return fc::thread::current().schedule( fc::forward<Functor>(f), t, desc, prio );
+   void post( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(), size_t stack_size = 0 ) {
+      fc::thread::current().post( fc::forward<Functor>(f), desc, prio, stack_size );
    }
+   template<typename Functor>
+   auto schedule( Functor&& f, const fc::time_point& t, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(), size_t stack_size = 0 ) -> fc::future<decltype(f())> {
+      return fc::thread::current().schedule( fc::forward<Functor>(f), t, desc, prio, stack_size );
+   }
+
+   /** process wide counts of fiber stacks */
+   struct fiber_stack_stats
+   {
+      uint64_t live_stacks   = 0; ///< in use by a fiber, running or parked
+      uint64_t pooled_stacks = 0; ///< released by a fiber and kept for reuse
+      uint64_t live_bytes    = 0;
+      uint64_t pooled_bytes  = 0;
+   };
+   fiber_stack_stats get_fiber_stack_stats();
 
   /**
    * Call f() in thread t and block the current thread until it returns.
@@ -0,0 +1,147 @@
+#pragma once
+#include <fc/thread/future.hpp>
+#include <fc/exception/exception.hpp>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace fc
+{
+   namespace detail
+   {
+      class thread_pool_impl;
+
+      class pool_task
+      {
+         public:
+            virtual ~pool_task(){}
+            virtual void run() = 0;
+
+         protected:
+            static void set_exception( promise_base& p );
+      };
+
+      template<typename Functor, typename Result>
+      class pool_task_impl : public pool_task
+      {
+         public:
+            template<typename F>
+            pool_task_impl( F&& f, const typename promise<Result>::ptr& p ):_functor( fc::forward<F>(f) ),_promise(p){}
+
+            virtual void run()override
+            {
+               try
+               {
+                  _promise->set_value( _functor() );
+               }
+               catch( ... )
+               {
+                  set_exception( *_promise );
+               }
+            }
+
+         private:
+            Functor                        _functor;
+            typename promise<Result>::ptr  _promise;
+      };
+
+      template<typename Functor>
+      class pool_task_impl<Functor,void> : public pool_task
+      {
+         public:
+            template<typename F>
+            pool_task_impl( F&& f, const promise<void>::ptr& p ):_functor( fc::forward<F>(f) ),_promise(p){}
+
+            virtual void run()override
+            {
+               try
+               {
+                  _functor();
+                  _promise->set_value();
+               }
+               catch( ... )
+               {
+                  set_exception( *_promise );
+               }
+            }
+
+         private:
+            Functor             _functor;
+            promise<void>::ptr  _promise;
+      };
+   }
+
+   /**
+    *  @brief Runs CPU-bound work on a fixed set of fc::threads.
+    *
+    *  Every worker owns a deque of tasks: it takes its own work newest first and, when
+    *  that runs dry, steals the oldest task of another worker.  Tasks posted from a
+    *  worker go to that worker's deque, tasks from any other thread are spread round
+    *  robin.  The futures returned by async() are ordinary fc::futures, so waiting on
+    *  one from a fiber yields to the other fibers of its thread.
+    *
+    *  Workers are fc::threads, so tasks may use fibers, fc::async() and futures.  A task
+    *  that waits on another pool task blocks its worker until the other task, which is
+    *  left for the remaining workers to steal, has finished.
+    */
+   class thread_pool
+   {
+      public:
+         /** @param threads the number of workers, 0 for one per core */
+         explicit thread_pool( uint32_t threads = 0, const string& name = "pool" );
+         /** runs the tasks still queued, then stops the workers */
+         ~thread_pool();
+
+         thread_pool( const thread_pool& ) = delete;
+         thread_pool& operator=( const thread_pool& ) = delete;
+
+         /** a pool with one worker per core, created on first use */
+         static thread_pool& default_pool();
+
+         uint32_t size()const;
+
+         template<typename Functor>
+         auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG ) -> fc::future<decltype(f())>
+         {
+            typedef decltype(f()) Result;
+            typedef typename std::decay<Functor>::type FunctorType;
+            typename promise<Result>::ptr p( new promise<Result>( desc ) );
+            post( new detail::pool_task_impl<FunctorType,Result>( fc::forward<Functor>(f), p ) );
+            return fc::future<Result>( fc::move(p) );
+         }
+
+         /**
+          *  Calls f(i) for every i in [begin, end), in chunks of at least grain indices
+          *  spread over the workers.  The calling fiber takes chunks as well and returns
+          *  once all of them are done, rethrowing the first exception thrown by f.
+          */
+         template<typename Functor>
+         void parallel_for( size_t begin, size_t end, Functor&& f, size_t grain = 1 )
+         {
+            if( begin >= end )
+               return;
+            parallel_chunks( end - begin, grain, [begin,&f]( size_t first, size_t last ) {
+               for( size_t i = first; i < last; ++i )
+                  f( begin + i );
+            });
+         }
+
+         /** @return f(e) for every element e of in, computed with parallel_for() */
+         template<typename T, typename Functor>
+         auto parallel_map( const std::vector<T>& in, Functor&& f, size_t grain = 1 )
+            -> std::vector<typename std::decay<decltype(f(in[0]))>::type>
+         {
+            std::vector<typename std::decay<decltype(f(in[0]))>::type> out( in.size() );
+            parallel_for( 0, in.size(), [&]( size_t i ) { out[i] = f( in[i] ); }, grain );
+            return out;
+         }
+
+      private:
+         void post( detail::pool_task* t );
+         void parallel_chunks( size_t count, size_t grain, const std::function<void(size_t,size_t)>& run );
+
+         std::unique_ptr<detail::thread_pool_impl> my;
+   };
+
+} // namespace fc
@@ -0,0 +1,111 @@
+#pragma once
+#include <fc/time.hpp>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace fc
+{
+   /**
+    *  @brief A hierarchical timing wheel of intrusive timer nodes.
+    *
+    *  Four levels of 256 slots cover 2^32 ticks of the resolution (about 49 days for the
+    *  default millisecond), later deadlines wait in the last level.  schedule() and
+    *  cancel() are O(1); expire() hands out everything due in slot order, moving each
+    *  higher level slot down once per rotation of the level below.  Deadlines are rounded
+    *  up to the next tick, so a timer never expires early and at most one tick late.
+    *
+    *  Not thread safe: each fc::thread keeps its own wheels.
+    */
+   class timer_wheel
+   {
+      public:
+         class node
+         {
+            public:
+               node():prev(nullptr),next(nullptr),tick(0),slot(unscheduled),data(nullptr){}
+
+               bool is_scheduled()const { return slot != unscheduled; }
+
+            private:
+               friend class timer_wheel;
+               node*    prev;
+               node*    next;
+               uint64_t tick;
+               uint16_t slot;
+
+            public:
+               void*    data; ///< for the owner of the node, e.g. the object it is embedded in
+         };
+
+         explicit timer_wheel( const microseconds& resolution = milliseconds(1) );
+         timer_wheel( const timer_wheel& ) = delete;
+         timer_wheel& operator=( const timer_wheel& ) = delete;
+
+         /** schedules n to expire at when, first cancelling it if it is scheduled already */
+         void schedule( node& n, const time_point& when );
+         /** does nothing unless n is scheduled */
+         void cancel( node& n );
+
+         bool   empty()const { return _size == 0; }
+         size_t size()const  { return _size; }
+
+         /** @return a time at or before which the next timer is due, or time_point::maximum() */
+         time_point next_expiry()const;
+
+         /**
+          *  Unschedules every node due at now and calls cb(node&) for each of them.  The
+          *  callback may schedule or cancel any node, including ones not called yet.
+          */
+         template<typename Callback>
+         void expire( const time_point& now, Callback&& cb )
+         {
+            advance( tick_at( now, false ) );
+            while( node* n = _expiring )
+            {
+               unlink( *n );
+               cb( *n );
+            }
+         }
+
+         /** unschedules every node and calls cb(node&) for each of them */
+         template<typename Callback>
+         void clear( Callback&& cb )
+         {
+            for( uint32_t s = 0; s < levels * slots; ++s )
+            {
+               while( node* n = _heads[s] )
+               {
+                  unlink( *n );
+                  cb( *n );
+               }
+            }
+            while( node* n = _expiring )
+            {
+               unlink( *n );
+               cb( *n );
+            }
+         }
+
+      private:
+         static const uint32_t slot_bits   = 8;
+         static const uint32_t slots       = 1 << slot_bits;
+         static const uint32_t levels      = 4;
+         static const uint16_t unscheduled = 0xffff;
+         static const uint16_t expiring    = 0xfffe;
+
+         uint64_t tick_at( const time_point& t, bool round_up )const;
+         void     insert( node& n );
+         void     unlink( node& n );
+         void     advance( uint64_t now_tick );
+         void     cascade( uint32_t level );
+         int      next_slot( uint32_t level, uint32_t from )const;
+
+         int64_t  _resolution;  ///< microseconds per tick
+         uint64_t _current;     ///< the next tick to be processed
+         size_t   _size;
+         node*    _heads[levels * slots];
+         uint64_t _occupied[levels][slots / 64];
+         node*    _expiring;    ///< due nodes that expire() has not handed out yet
+   };
+
+} // namespace fc
@@ -272,8 +272,24 @@ namespace fc
 
         /// @pre  get_type() == string_type
         const string&               get_string()const;
+        /**
+         *  Strings short enough to fit in the variant itself are stored inline, and
+         *  the first get_string() on one has to allocate the string it refers to.
+         *  string_data() / string_size() read the characters without that.
+         *
+         *  @pre  get_type() == string_type, valid until this variant is modified
+         */
+        const char*                 string_data()const;
+        /// @pre  get_type() == string_type
+        size_t                      string_size()const;
                                     
-        /// @throw if get_type() != array_type | null_type
+        /**
+         *  Arrays are shared between copies of a variant; if this one is shared it
+         *  is copied first.  The reference is only valid until this variant is
+         *  copied, assigned or modified.
+         *
+         *  @throw if get_type() != array_type | null_type
+         */
         variants&                   get_array();
 
         /// @throw if get_type() != array_type 
@@ -341,6 +357,11 @@ namespace fc
         void    clear();
       private:
         void    init();
+        /**
+         *  The last byte holds the type_id.  Strings of up to sizeof(variant) - 2 bytes
+         *  are stored in place, everything else is a pointer to a heap allocated value.
+         *  Arrays and longer strings are reference counted and shared by copies.
+         */
         double  _data;                ///< Alligned according to double requirements
         char    _type[sizeof(void*)]; ///< pad to void* size
    };
@@ -0,0 +1,109 @@
+#pragma once
+#include <fc/utility.hpp>
+#include <stddef.h>
+#include <new>
+
+namespace fc
+{
+   class variant;
+
+   namespace detail
+   {
+      struct arena_state;
+
+      /**
+       *  Allocates memory for variant internals: from the current thread's
+       *  variant_arena if there is one, otherwise from the heap.  The result is
+       *  aligned for any fundamental type and must be freed with variant_free().
+       */
+      void* variant_alloc( size_t size );
+      void  variant_free( void* p );
+
+      template<typename T, typename... Args>
+      T* variant_new( Args&&... args )
+      {
+         void* mem = variant_alloc( sizeof(T) );
+         try
+         {
+            return new (mem) T( fc::forward<Args>(args)... );
+         }
+         catch( ... )
+         {
+            variant_free( mem );
+            throw;
+         }
+      }
+
+      template<typename T>
+      void variant_delete( const T* p )
+      {
+         p->~T();
+         variant_free( const_cast<T*>(p) );
+      }
+
+      /** std allocator over variant_alloc(), e.g. for the control blocks of std::allocate_shared */
+      template<typename T>
+      struct variant_allocator
+      {
+         typedef T value_type;
+
+         variant_allocator(){}
+         template<typename U>
+         variant_allocator( const variant_allocator<U>& ){}
+
+         T*   allocate( size_t n )       { return static_cast<T*>( variant_alloc( n * sizeof(T) ) ); }
+         void deallocate( T* p, size_t ) { variant_free( p ); }
+
+         template<typename U>
+         bool operator==( const variant_allocator<U>& )const { return true; }
+         template<typename U>
+         bool operator!=( const variant_allocator<U>& )const { return false; }
+      };
+   }
+
+   /**
+    *  @brief Bump allocator for the internals of variant trees built on this thread.
+    *
+    *  While a variant_arena is in scope, string and array payloads, objects, their
+    *  entry tables and non-interned keys created on this thread by json::from_string,
+    *  to_variant, raw::unpack or any other means are carved out of large blocks
+    *  instead of being allocated one by one, and freeing them is only a counter
+    *  decrement.  The buffers of std::vector and std::string members still come from
+    *  the heap.
+    *
+    *  The blocks are returned when the arena has gone out of scope and the last
+    *  value allocated from it has been destroyed, so a variant that outlives the
+    *  arena stays valid but keeps all of the arena's memory alive.  Use copy_out()
+    *  for values that must be kept.
+    *
+    *  Blocks come from an address range reserved for all arenas, which is how
+    *  freeing tells arena memory from heap memory without a per-allocation header.
+    *  Block sizes are rounded up to 64 KB, and arenas allocate from the heap
+    *  once the range is used up.
+    *
+    *  Arenas nest and are strictly scoped: one must not be kept alive across a
+    *  context switch to another fc task on the same thread.
+    */
+   class variant_arena
+   {
+      public:
+         static const size_t default_block_size = 64 * 1024;
+
+         explicit variant_arena( size_t block_size = default_block_size );
+         ~variant_arena();
+
+         variant_arena( const variant_arena& ) = delete;
+         variant_arena& operator=( const variant_arena& ) = delete;
+
+         /** bytes handed out by this arena so far */
+         size_t used()const;
+
+         /** deep copy of v that is allocated on the heap and does not reference any arena */
+         static variant copy_out( const variant& v );
+
+      private:
+         detail::arena_state* _state;
+         detail::arena_state* _prev;
+   };
+
+} // fc
@@ -2,11 +2,74 @@
 #include <fc/variant.hpp>
 #include <fc/shared_ptr.hpp>
 #include <fc/unique_ptr.hpp>
+#include <atomic>
 
 namespace fc
 {
    using std::map;
    class mutable_variant_object;
+
+   namespace detail
+   {
+      /** the shared representation of a variant_key */
+      struct key_atom
+      {
+         key_atom( string s, uint64_t h, bool is_immortal )
+         :str(std::move(s)),hash(h),refs(1),immortal(is_immortal){}
+
+         const string                  str;
+         const uint64_t                hash;
+         mutable std::atomic<uint32_t> refs;
+         const bool                    immortal; ///< interned atoms are never freed and not counted
+      };
+
+      uint64_t hash_key( const char* key, size_t len );
+
+      /** maps keys to the position of their first entry, used for objects with many entries */
+      class key_index;
+   }
+
+   /**
+    *  @brief An immutable object key that is shared instead of copied.
+    *
+    *  Keys passed to intern() (e.g. reflected member names) live for the rest of the
+    *  process and every object using them points at the same atom.  Constructing a key
+    *  from a string reuses an interned atom when one exists and otherwise allocates a
+    *  reference counted one, so copying entries never copies key strings.
+    */
+   class variant_key
+   {
+      public:
+         variant_key();
+         explicit variant_key( string key );
+         explicit variant_key( const char* key );
+         variant_key( const variant_key& k );
+         variant_key( variant_key&& k );
+         ~variant_key();
+
+         variant_key& operator=( const variant_key& k );
+         variant_key& operator=( variant_key&& k );
+
+         /** @return the process wide atom for key, creating it if this is the first use */
+         static variant_key intern( const char* key );
+
+         const string& str()const  { return _atom->str; }
+         uint64_t      hash()const { return _atom->hash; }
+
+         bool equals( const char* key, size_t len, uint64_t key_hash )const
+         {
+            return _atom->hash == key_hash && _atom->str.size() == len
+                   && _atom->str.compare( 0, len, key, len ) == 0;
+         }
+         bool operator==( const variant_key& k )const
+         {
+            return _atom == k._atom || equals( k.str().data(), k.str().size(), k.hash() );
+         }
+
+      private:
+         explicit variant_key( const detail::key_atom* a ):_atom(a){}
+         const detail::key_atom* _atom;
+   };
    
    /**
     *  @ingroup Serializable
@@ -16,8 +79,8 @@ namespace fc
     *  Keys are kept in the order they are inserted.
     *  This dictionary implements copy-on-write
     *
-    *  @note This class is not optimized for random-access on large
-    *        sets of key-value pairs.
+    *  @note Lookups scan the entries comparing key hashes; objects with more
+    *        than a few entries also get a hash index.
     */
    class variant_object
    {
@@ -28,20 +91,22 @@ namespace fc
       public:
          entry();
          entry( string k, variant v );
+         entry( variant_key k, variant v );
          entry( entry&& e );
          entry( const entry& e);
          entry& operator=(const entry&);
          entry& operator=(entry&&);
                 
-         const string&        key()const;
+         const string&        key()const { return _key.str(); }
+         const variant_key&   shared_key()const { return _key; }
          const variant& value()const;
          void  set( variant v );
 
          variant&       value();
              
       private:
-         string  _key;
-         variant _value;
+         variant_key _key;
+         variant     _value;
       };
 
       typedef std::vector< entry >::const_iterator iterator;
@@ -57,6 +122,7 @@ namespace fc
       iterator end()const;
       iterator find( const string& key )const;
       iterator find( const char* key )const;
+      iterator find( const variant_key& key )const;
       const variant& operator[]( const string& key )const;
       const variant& operator[]( const char* key )const;
       size_t size()const;
@@ -75,14 +141,12 @@ namespace fc
          for( const auto& item : values ) {
             _key_value->emplace_back( entry( item.first, fc::variant(item.second) ) );
          }
+         build_index();
       }
        
       template<typename T>
       variant_object( string key, T&& val )
-      :_key_value( std::make_shared<std::vector<entry> >() )
-      {
-         *this = variant_object( std::move(key), variant(forward<T>(val)) );
-      }
+      :variant_object( std::move(key), variant(forward<T>(val)) ){}
       variant_object( const variant_object& );
       variant_object( variant_object&& );
 
@@ -96,7 +160,12 @@ namespace fc
       variant_object& operator=( const mutable_variant_object& );
 
    private:
+      iterator find( const char* key, size_t len, uint64_t hash )const;
+      void     build_index();
+
       std::shared_ptr< std::vector< entry > > _key_value;
+      /** built once the entries are final, only for objects with more than a few entries */
+      std::shared_ptr< const detail::key_index > _index;
       friend class mutable_variant_object;
    };
    /** @ingroup Serializable */
@@ -113,8 +182,8 @@ namespace fc
    *  Keys are kept in the order they are inserted.
    *  This dictionary implements copy-on-write
    *
-   *  @note This class is not optimized for random-access on large
-   *        sets of key-value pairs.
+   *  @note Lookups scan the entries comparing key hashes; objects with more
+   *        than a few entries also get a hash index.
    */
    class mutable_variant_object
    {
@@ -136,6 +205,7 @@ namespace fc
       iterator end()const;
       iterator find( const string& key )const;
       iterator find( const char* key )const;
+      iterator find( const variant_key& key )const;
       const variant& operator[]( const string& key )const;
       const variant& operator[]( const char* key )const;
       size_t size()const;
@@ -164,6 +234,7 @@ namespace fc
 
       /** replaces the value at \a key with \a var or insert's \a key if not found */
       mutable_variant_object& set( string key, variant var );
+      mutable_variant_object& set( variant_key key, variant var );
       /** Appends \a key and \a var without checking for duplicates, designed to
          *  simplify construction of dictionaries using (key,val)(key2,val2) syntax 
          */
@@ -186,6 +257,13 @@ namespace fc
          set(std::move(key), variant( fc::forward<T>(var) ) );
          return *this;
       }
+      /** like operator()( string, T&& ), for interned keys */
+      template<typename T>
+      mutable_variant_object& operator()( const variant_key& key, T&& var )
+      {
+         set( key, variant( fc::forward<T>(var) ) );
+         return *this;
+      }
       /**
        * Copy a variant_object into this mutable_variant_object.
        */
@@ -213,6 +291,7 @@ namespace fc
          for( const auto& item : values ) {
             _key_value->emplace_back( variant_object::entry( item.first, fc::variant(item.second) ) );
          }
+         build_index();
       }
 
       /** initializes the first key/value pair in the object */
@@ -227,6 +306,7 @@ namespace fc
       mutable_variant_object( mutable_variant_object&& );
       mutable_variant_object( const mutable_variant_object& );
       mutable_variant_object( const variant_object& );
+      ~mutable_variant_object();
 
       mutable_variant_object& operator=( mutable_variant_object&& );
       mutable_variant_object& operator=( const mutable_variant_object& );
@@ -234,7 +314,13 @@ namespace fc
 
 
    private:
+      iterator find( const char* key, size_t len, uint64_t hash )const;
+      void     append( entry e );
+      void     build_index();
+
       std::unique_ptr< std::vector< entry > > _key_value;
+      /** kept current by every mutation so that const lookups never write, only for objects with more than a few entries */
+      std::shared_ptr< detail::key_index > _index;
       friend class variant_object;
    };
    /** @ingroup Serializable */
@@ -4,6 +4,21 @@
 #include <fc/log/logger.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <stdio.h>
+#include <string>
+
+#if defined(_WIN32)
+# include <windows.h>
+#elif !defined(__APPLE__)
+# include <pthread.h>
+# include <sched.h>
+# include <time.h>
+#endif
+
 namespace fc {
   namespace asio {
     namespace detail {
@@ -90,53 +105,216 @@ namespace fc {
         }
     }
 
+    namespace
+    {
+       /** @return the CPUs of numa_node, or all CPUs if it is negative or unknown */
+       std::vector<uint32_t> allowed_cpus( int32_t numa_node )
+       {
+          std::vector<uint32_t> cpus;
+#if defined(__linux__)
+          if( numa_node >= 0 )
+          {
+             // cpulist is a comma separated list of CPUs and ranges, e.g. "0-3,8-11"
+             std::ifstream in( "/sys/devices/system/node/node" + std::to_string( numa_node ) + "/cpulist" );
+             std::string range;
+             while( std::getline( in, range, ',' ) )
+             {
+                uint32_t first = 0, last = 0;
+                const int n = sscanf( range.c_str(), "%u-%u", &first, &last );
+                if( n < 1 )
+                   continue;
+                if( n == 1 )
+                   last = first;
+                for( uint32_t cpu = first; cpu <= last; ++cpu )
+                   cpus.push_back( cpu );
+             }
+             if( cpus.empty() )
+                wlog( "unknown NUMA node ${n}, io_service threads may run on any CPU", ("n", numa_node) );
+          }
+#elif defined(_WIN32)
+          ULONGLONG mask = 0;
+          if( numa_node >= 0 && GetNumaNodeProcessorMask( UCHAR(numa_node), &mask ) )
+          {
+             for( uint32_t cpu = 0; cpu < 64; ++cpu )
+                if( mask & (ULONGLONG(1) << cpu) )
+                   cpus.push_back( cpu );
+          }
+#else
+          if( numa_node >= 0 )
+             wlog( "NUMA placement of io_service threads is not supported on this platform" );
+#endif
+          if( cpus.empty() )
+          {
+             const uint32_t count = std::max( 1u, boost::thread::hardware_concurrency() );
+             for( uint32_t cpu = 0; cpu < count; ++cpu )
+                cpus.push_back( cpu );
+          }
+          return cpus;
+       }
+
+       void set_current_thread_affinity( const std::vector<uint32_t>& cpus )
+       {
+#if defined(__linux__)
+          cpu_set_t set;
+          CPU_ZERO( &set );
+          for( uint32_t cpu : cpus )
+             CPU_SET( cpu, &set );
+          if( pthread_setaffinity_np( pthread_self(), sizeof(set), &set ) != 0 )
+             wlog( "unable to set the CPU affinity of io_service thread ${t}", ("t", fc::thread::current().name()) );
+#elif defined(_WIN32)
+          DWORD_PTR mask = 0;
+          for( uint32_t cpu : cpus )
+             if( cpu < sizeof(mask) * 8 )
+                mask |= DWORD_PTR(1) << cpu;
+          if( !SetThreadAffinityMask( GetCurrentThread(), mask ) )
+             wlog( "unable to set the CPU affinity of io_service thread ${t}", ("t", fc::thread::current().name()) );
+#else
+          wlog( "pinning io_service threads to CPUs is not supported on this platform" );
+#endif
+       }
+
+       /** @return the CPU time t has used so far, in microseconds, or 0 where not supported */
+       int64_t cpu_time( boost::thread& t )
+       {
+#if defined(_WIN32)
+          FILETIME creation, exit, kernel, user;
+          if( !GetThreadTimes( t.native_handle(), &creation, &exit, &kernel, &user ) )
+             return 0;
+          const uint64_t k = (uint64_t(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+          const uint64_t u = (uint64_t(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+          return int64_t( (k + u) / 10 ); // 100ns units
+#elif defined(__APPLE__)
+          return 0;
+#else
+          clockid_t clock;
+          timespec  ts;
+          if( pthread_getcpuclockid( t.native_handle(), &clock ) != 0 || clock_gettime( clock, &ts ) != 0 )
+             return 0;
+          return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+       }
+    }
+
     struct default_io_service_scope
     {
-       boost::asio::io_service*          io;
-       std::vector<boost::thread*>       asio_threads;
-       boost::asio::io_service::work*    the_work;
+       struct service
+       {
+          boost::asio::io_service*          io;
+          boost::asio::io_service::work*    the_work;
+          std::vector<boost::thread*>       asio_threads;
+          std::atomic<uint64_t>             assigned{0};
+          std::atomic<uint64_t>             handlers{0};
+          std::atomic<uint64_t>             queue_depth{0};
+          std::atomic<uint64_t>             max_queue_depth{0};
+       };
+
+       std::vector<std::unique_ptr<service>> services;
+       std::atomic<uint64_t>                 next_service{0};
 
-       default_io_service_scope()
+       default_io_service_scope( const io_service_config& config )
        {
-            io           = new boost::asio::io_service();
-            the_work     = new boost::asio::io_service::work(*io);
-            for( int i = 0; i < 8; ++i ) {
-               asio_threads.push_back( new boost::thread( [=]()
+            const std::vector<uint32_t> cpus = allowed_cpus( config.numa_node );
+            const uint32_t threads = config.threads ? config.threads : uint32_t(cpus.size());
+            const uint32_t count   = config.per_thread ? threads : 1;
+
+            for( uint32_t i = 0; i < count; ++i )
+            {
+               services.emplace_back( new service );
+               services.back()->io       = config.per_thread ? new boost::asio::io_service(1) : new boost::asio::io_service();
+               services.back()->the_work = new boost::asio::io_service::work(*services.back()->io);
+            }
+
+            for( uint32_t i = 0; i < threads; ++i )
+            {
+               service* svc = services[ i % count ].get();
+               std::vector<uint32_t> affinity;
+               if( config.pin_threads )
+                  affinity.push_back( cpus[ i % cpus.size() ] );
+               else if( config.numa_node >= 0 )
+                  affinity = cpus;
+               const std::string name = config.per_thread ? "asio_" + std::to_string( i ) : std::string( "asio" );
+
+               svc->asio_threads.push_back( new boost::thread( [svc,affinity,name]()
                {
-                 fc::thread::current().set_name("asio");
+                 fc::thread::current().set_name(name);
+                 if( !affinity.empty() )
+                   set_current_thread_affinity( affinity );
+                 boost::asio::io_service* io = svc->io;
                  while (!io->stopped())
                  {
                    try
                    {
-                     io->run();
+                     // run one handler, waiting for it if need be, then whatever else is ready
+                     if( io->run_one() )
+                     {
+                       const uint64_t depth = 1 + io->poll();
+                       svc->handlers.fetch_add( depth, std::memory_order_relaxed );
+                       svc->queue_depth.store( depth, std::memory_order_relaxed );
+                       uint64_t max_depth = svc->max_queue_depth.load( std::memory_order_relaxed );
+                       while( depth > max_depth && !svc->max_queue_depth.compare_exchange_weak( max_depth, depth, std::memory_order_relaxed ) );
+                     }
                    }
                    catch (const fc::exception& e)
                    {
-                     elog("Caught unhandled exception in asio service loop: ${e}", ("e", e));
+                     elog_rate(10, "Caught unhandled exception in asio service loop: ${e}", ("e", e));
                    }
                    catch (const std::exception& e)
                    {
-                     elog("Caught unhandled exception in asio service loop: ${e}", ("e", e.what()));
+                     elog_rate(10, "Caught unhandled exception in asio service loop: ${e}", ("e", e.what()));
                    }
                    catch (...)
                    {
-                     elog("Caught unhandled exception in asio service loop");
+                     elog_rate(10, "Caught unhandled exception in asio service loop");
                    }
                  }
                }) );
             }
        }
 
+       boost::asio::io_service& next()
+       {
+          service& svc = *services[ next_service.fetch_add( 1, std::memory_order_relaxed ) % services.size() ];
+          svc.assigned.fetch_add( 1, std::memory_order_relaxed );
+          return *svc.io;
+       }
+
+       std::vector<io_service_stats> stats()
+       {
+          std::vector<io_service_stats> result;
+          for( const auto& svc : services )
+          {
+             io_service_stats s;
+             s.threads         = uint32_t(svc->asio_threads.size());
+             s.assigned        = svc->assigned.load( std::memory_order_relaxed );
+             s.handlers        = svc->handlers.load( std::memory_order_relaxed );
+             s.queue_depth     = svc->queue_depth.load( std::memory_order_relaxed );
+             s.max_queue_depth = svc->max_queue_depth.load( std::memory_order_relaxed );
+             int64_t busy = 0;
+             if( svc->io )
+                for( auto asio_thread : svc->asio_threads )
+                   busy += cpu_time( *asio_thread );
+             s.busy_time = fc::microseconds( busy );
+             result.push_back( s );
+          }
+          return result;
+       }
+
        void cleanup()
        {
-          delete the_work;
-          io->stop();
-          for( auto asio_thread : asio_threads ) {
-             asio_thread->join();
+          for( auto& svc : services )
+          {
+             delete svc->the_work;
+             svc->io->stop();
           }
-          delete io;
-          for( auto asio_thread : asio_threads ) {
-             delete asio_thread;
+          for( auto& svc : services )
+          {
+             for( auto asio_thread : svc->asio_threads )
+                asio_thread->join();
+             delete svc->io;
+             svc->io = nullptr;
+             for( auto asio_thread : svc->asio_threads )
+                delete asio_thread;
+             svc->asio_threads.clear();
           }
        }
 
@@ -144,14 +322,68 @@ namespace fc {
        {}
     };
 
+    namespace
+    {
+       boost::mutex& io_scope_mutex()
+       {
+          static boost::mutex m;
+          return m;
+       }
+       io_service_config& configured_io()
+       {
+          static io_service_config config;
+          return config;
+       }
+       std::atomic<default_io_service_scope*>& io_scope()
+       {
+          static std::atomic<default_io_service_scope*> scope(nullptr);
+          return scope;
+       }
+    }
+
+    void configure_default_io_service( const io_service_config& config )
+    {
+        boost::unique_lock<boost::mutex> lock( io_scope_mutex() );
+        FC_ASSERT( io_scope().load() == nullptr, "the default io_service must be configured before it is first used" );
+        configured_io() = config;
+    }
+
+    namespace
+    {
+       default_io_service_scope& started_io_scope()
+       {
+          default_io_service_scope* scope = io_scope().load( std::memory_order_acquire );
+          if( !scope )
+          {
+             boost::unique_lock<boost::mutex> lock( io_scope_mutex() );
+             scope = io_scope().load( std::memory_order_relaxed );
+             if( !scope )
+             {
+                scope = new default_io_service_scope( configured_io() );
+                io_scope().store( scope, std::memory_order_release );
+             }
+          }
+          return *scope;
+       }
+    }
+
     /// If cleanup is true, do not use the return value; it is a null reference
     boost::asio::io_service& default_io_service(bool cleanup) {
-        static default_io_service_scope fc_asio_service[1];
-        if (cleanup) {
-           for( int i = 0; i < 1; ++i )
-              fc_asio_service[i].cleanup();
-        }
-        return *fc_asio_service[0].io;
+        default_io_service_scope& scope = started_io_scope();
+        if (cleanup)
+           scope.cleanup();
+        return *scope.services[0]->io;
+    }
+
+    boost::asio::io_service& next_io_service() {
+        return started_io_scope().next();
+    }
+
+    std::vector<io_service_stats> get_default_io_service_stats()
+    {
+        if( default_io_service_scope* scope = io_scope().load( std::memory_order_acquire ) )
+           return scope->stats();
+        return std::vector<io_service_stats>();
     }
 
     namespace tcp {
@@ -1,4 +1,9 @@
 #include <fc/compress/zlib.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fstream>
+#include <memory>
+#include <vector>
 
 #include "miniz.c"
 
@@ -12,4 +17,31 @@ namespace fc
     free(compressed_message);
     return result;
   }
+
+  static mz_bool write_compressed(const void* buf, int len, void* user)
+  {
+    std::ofstream& out = *static_cast<std::ofstream*>(user);
+    out.write(static_cast<const char*>(buf), len);
+    return out.good();
+  }
+
+  void zlib_compress_file(const path& in, const path& out)
+  {
+    std::ifstream input(in.string(), std::ios::binary);
+    FC_ASSERT( input.is_open(), "unable to open ${file}", ("file", in) );
+    std::ofstream output(out.string(), std::ios::binary | std::ios::trunc);
+    FC_ASSERT( output.is_open(), "unable to create ${file}", ("file", out) );
+
+    std::unique_ptr<tdefl_compressor, void(*)(void*)> compressor((tdefl_compressor*)malloc(sizeof(tdefl_compressor)), &free);
+    FC_ASSERT( compressor );
+    tdefl_init(compressor.get(), &write_compressed, &output, TDEFL_WRITE_ZLIB_HEADER | TDEFL_DEFAULT_MAX_PROBES);
+
+    std::vector<char> buf(1024 * 1024);
+    tdefl_status status = TDEFL_STATUS_OKAY;
+    while( status == TDEFL_STATUS_OKAY && input.read(buf.data(), buf.size()).gcount() > 0 )
+      status = tdefl_compress_buffer(compressor.get(), buf.data(), input.gcount(), TDEFL_NO_FLUSH);
+    if( status == TDEFL_STATUS_OKAY )
+      status = tdefl_compress_buffer(compressor.get(), nullptr, 0, TDEFL_FINISH);
+    FC_ASSERT( status == TDEFL_STATUS_DONE && output.flush(), "unable to compress ${file}", ("file", in) );
+  }
 }
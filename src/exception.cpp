@@ -180,7 +180,7 @@ namespace fc
       ss << what() << " (" << variant(my->_code).as_string() <<")\n";
       for( auto itr = my->_elog.begin(); itr != my->_elog.end(); ++itr )
       {
-         ss << fc::format_string( itr->get_format(), itr->get_data() ) <<"\n";
+         ss << itr->get_message() <<"\n";
    //      ss << "    " << itr->get_context().to_string() <<"\n";
       }
       return ss.str();
@@ -0,0 +1,193 @@
+#include <fc/format_template.hpp>
+#include <fc/io/json.hpp>
+#include <atomic>
+
+namespace fc
+{
+   namespace detail
+   {
+      /**
+       *  Splits a format string into literal text and ${key} references.  '$' followed
+       *  by anything but '{' is dropped and the next character kept, an unterminated
+       *  "${" keeps the rest of the string without the '$'.
+       */
+      template<typename Literal, typename Key>
+      void parse_format( const char* s, size_t n, Literal&& on_literal, Key&& on_key )
+      {
+         size_t prev = 0;
+         while( prev < n )
+         {
+            const char* dollar = static_cast<const char*>( memchr( s + prev, '$', n - prev ) );
+            const size_t next = dollar ? size_t( dollar - s ) : n;
+            if( next > prev )
+               on_literal( prev, next - prev );
+            if( next == n )
+               return;
+
+            prev = next + 1;
+            if( prev == n )
+               return;
+            if( s[prev] != '{' )
+            {
+               on_literal( prev, 1 );
+               ++prev;
+               continue;
+            }
+            const char* close = static_cast<const char*>( memchr( s + prev, '}', n - prev ) );
+            if( close == nullptr )
+            {
+               on_literal( prev, n - prev );
+               return;
+            }
+            on_key( prev + 1, size_t( close - s ) - prev - 1 );
+            prev = size_t( close - s ) + 1;
+         }
+      }
+
+      void append_value( const variant& v, string& out )
+      {
+         if( v.is_object() || v.is_array() )
+            out += json::to_string( v );
+         else if( v.is_string() )
+            out.append( v.string_data(), v.string_size() );
+         else
+            out += v.as_string();
+      }
+
+      void append_missing_key( const char* key, size_t len, string& out )
+      {
+         out.append( "${", 2 );
+         out.append( key, len );
+         out.push_back( '}' );
+      }
+
+      /**
+       *  Insert-only cache of templates keyed by the format text, readers never lock.
+       *  Keying by address would let a char array that is not a literal, e.g. a stack
+       *  buffer, take a new slot for every address it shows up at; by content each
+       *  distinct text takes one slot, and once the table is full the remaining formats
+       *  are parsed on every use.
+       */
+      class format_cache
+      {
+         public:
+            const format_template* get( const char* format, size_t len )
+            {
+               const uint64_t h = hash_key( format, len );
+               for( size_t i = 0; i < max_probe; ++i )
+               {
+                  auto& slot = _slots[ (h + i) & mask ];
+                  const cached* c = slot.load( std::memory_order_acquire );
+                  if( c == nullptr )
+                  {
+                     cached* created = new cached{ h, new format_template( string( format, len ), true ) };
+                     if( slot.compare_exchange_strong( c, created, std::memory_order_acq_rel ) )
+                        return created->tpl;
+                     // another thread filled the slot first, c now holds its entry
+                     delete created->tpl;
+                     delete created;
+                  }
+                  if( c->hash == h && matches( c->tpl, format, len ) )
+                     return c->tpl;
+               }
+               return nullptr;
+            }
+
+         private:
+            struct cached
+            {
+               uint64_t               hash;
+               const format_template* tpl;
+            };
+
+            static bool matches( const format_template* t, const char* format, size_t len )
+            {
+               return t->get_format().size() == len && memcmp( t->get_format().data(), format, len ) == 0;
+            }
+
+            static const size_t capacity  = 1 << 12;
+            static const size_t mask      = capacity - 1;
+            static const size_t max_probe = 32;
+
+            std::atomic<const cached*> _slots[capacity] = {};
+      };
+   }
+
+   format_template::format_template( string format )
+   :format_template( std::move(format), false ){}
+
+   format_template::format_template( string format, bool intern_keys )
+   :_format( std::move(format) )
+   {
+      const char* s = _format.data();
+      detail::parse_format( s, _format.size(),
+         [&]( size_t begin, size_t size ) {
+            if( !_segments.empty() && !_segments.back().is_key
+                && _segments.back().begin + _segments.back().size == begin )
+               _segments.back().size += uint32_t(size);
+            else
+               _segments.push_back( segment{ uint32_t(begin), uint32_t(size), false, variant_key() } );
+         },
+         [&]( size_t begin, size_t size ) {
+            string key( s + begin, size );
+            _segments.push_back( segment{ uint32_t(begin), uint32_t(size), true,
+                                          intern_keys ? variant_key::intern( key.c_str() ) : variant_key( std::move(key) ) } );
+         } );
+   }
+
+   const format_template* format_template::for_literal( const char* format, size_t len )
+   {
+      static detail::format_cache* cache = new detail::format_cache(); // never destroyed, logging may outlive static objects
+      return cache->get( format, len );
+   }
+
+   void format_template::format( const variant_object& args, string& out )const
+   {
+      const char* s = _format.data();
+      for( const segment& seg : _segments )
+      {
+         if( !seg.is_key )
+         {
+            out.append( s + seg.begin, seg.size );
+            continue;
+         }
+         auto itr = args.find( seg.key );
+         if( itr != args.end() )
+            detail::append_value( itr->value(), out );
+         else
+            detail::append_missing_key( s + seg.begin, seg.size, out );
+      }
+   }
+
+   string format_template::format( const variant_object& args )const
+   {
+      string out;
+      out.reserve( _format.size() );
+      format( args, out );
+      return out;
+   }
+
+   void format_string( const char* format, size_t len, const variant_object& args, string& out )
+   {
+      string key;
+      detail::parse_format( format, len,
+         [&]( size_t begin, size_t size ) { out.append( format + begin, size ); },
+         [&]( size_t begin, size_t size ) {
+            key.assign( format + begin, size );
+            auto itr = args.find( key );
+            if( itr != args.end() )
+               detail::append_value( itr->value(), out );
+            else
+               detail::append_missing_key( format + begin, size, out );
+         } );
+   }
+
+   string format_string( const string& format, const variant_object& args )
+   {
+      string out;
+      out.reserve( format.size() );
+      format_string( format.data(), format.size(), args, out );
+      return out;
+   }
+
+} // fc
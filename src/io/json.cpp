@@ -5,13 +5,19 @@
 #include <fc/io/fstream.hpp>
 #include <fc/io/sstream.hpp>
 #include <fc/log/logger.hpp>
+#include <fc/thread/thread_pool.hpp>
 //#include <utfcpp/utf8.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstring>
 
 #include <boost/filesystem/fstream.hpp>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace fc
 {
     // forward declarations of provided functions
@@ -25,10 +31,13 @@ namespace fc
     template<typename T, json::parse_type parser_type> variant number_from_stream( T& in );
     template<typename T> variant token_from_stream( T& in );
     void escape_string( const string& str, ostream& os );
+    void escape_string( const char* str, size_t len, ostream& os );
+    namespace detail { enum class scan_result; }
+    detail::scan_result scan_json( const string& str, const json::limits& l, bool sequence );
     template<typename T> void to_stream( T& os, const variants& a, json::output_formatting format );
     template<typename T> void to_stream( T& os, const variant_object& o, json::output_formatting format );
     template<typename T> void to_stream( T& os, const variant& v, json::output_formatting format );
-    fc::string pretty_print( const fc::string& v, uint8_t indent );
+    template<typename T> void to_pretty_stream( T& os, const variant& v, json::output_formatting format, uint8_t indent );
 }
 
 #include <fc/io/json_relaxed.hpp>
@@ -437,28 +446,200 @@ namespace fc
    }
 
 
-   /** the purpose of this check is to verify that we will not get a stack overflow in the recursive descent parser */
-   void check_string_depth( const string& utf8_str  )
+   namespace detail
    {
-      int32_t open_object = 0;
-      int32_t open_array  = 0;
-      for( auto c : utf8_str )
+      enum class scan_result
+      {
+         valid,
+         invalid,
+         too_large,
+         too_deep,
+         string_too_long,
+         too_many_elements
+      };
+
+      void throw_if_limit_exceeded( scan_result r, const string& utf8_str, const json::limits& l )
       {
+         switch( r )
+         {
+            case scan_result::too_large:
+               FC_THROW_EXCEPTION( parse_error_exception, "JSON text of ${n} bytes exceeds the limit of ${max}",
+                                   ("n",utf8_str.size())("max",l.max_bytes) );
+            case scan_result::too_deep:
+               FC_THROW_EXCEPTION( parse_error_exception, "object graph too deep, limit is ${max}",
+                                   ("max",l.effective_max_depth()) );
+            case scan_result::string_too_long:
+               FC_THROW_EXCEPTION( parse_error_exception, "JSON string exceeds the limit of ${max} bytes",
+                                   ("max",l.max_string_length) );
+            case scan_result::too_many_elements:
+               FC_THROW_EXCEPTION( parse_error_exception, "JSON text exceeds the limit of ${max} elements",
+                                   ("max",l.max_elements) );
+            default:
+               break;
+         }
+      }
+
+      json::limits& default_limits()
+      {
+         static json::limits l;
+         return l;
+      }
+   }
+
+   /**
+    *  Checks input that scan_json() could not validate against l before it is handed to the
+    *  recursive descent parsers, so they neither overflow the stack nor build oversized values.
+    *  Those accept more than JSON (unquoted, single and triple quoted strings among others), so
+    *  this errs on the strict side: every '{' and '[' counts towards the depth, even inside a
+    *  string, every quoted or unquoted token counts as a string, and every token or container
+    *  counts as an element unless a ':' follows it.
+    */
+   detail::scan_result scan_lenient( const string& str, const json::limits& l )
+   {
+      using detail::scan_result;
+      const uint32_t max_depth   = l.effective_max_depth();
+      uint32_t       depth       = 0;
+      size_t         elements    = 0;
+      bool           after_token = false; // a token or container ended, only white space since
+
+      const char* itr = str.data();
+      const char* end = itr + str.size();
+
+      auto too_deep = [&]( char c ) { return ( c == '{' || c == '[' ) && ++depth >= max_depth; };
+      auto is_delimiter = []( char c ) {
          switch( c )
          {
-            case '{': open_object++; break;
-            case '}': open_object--; break;
-            case '[': open_array++; break;
-            case ']': open_array--; break;
-            default: break;
+            case '{': case '}': case '[': case ']': case ',': case ':': case '"': case '\'':
+            case ' ': case '\t': case '\n': case '\r':
+               return true;
+            default:
+               return false;
          }
-         FC_ASSERT( open_object < 100 && open_array < 100, "object graph too deep", ("object depth",open_object)("array depth", open_array) );
+      };
+
+      while( itr != end )
+      {
+         const char c = *itr;
+         switch( c )
+         {
+            case '{':
+            case '[':
+               if( too_deep( c ) )
+                  return scan_result::too_deep;
+               ++elements;
+               after_token = false;
+               ++itr;
+               break;
+            case '}':
+            case ']':
+               if( depth > 0 )
+                  --depth;
+               after_token = true;
+               ++itr;
+               break;
+            case ':':
+               if( after_token && elements > 0 )
+                  --elements; // the key of a member
+               after_token = false;
+               ++itr;
+               break;
+            case ',':
+               after_token = false;
+               ++itr;
+               break;
+            case ' ': case '\t': case '\n': case '\r':
+               ++itr;
+               break;
+            default:
+            {
+               size_t length = 0;
+               if( ( c == '"' || c == '\'' ) && end - itr >= 3 && itr[1] == c && itr[2] == c )
+               {
+                  // triple quoted, no escapes
+                  for( itr += 3; itr != end && !( end - itr >= 3 && itr[0] == c && itr[1] == c && itr[2] == c ); ++itr, ++length )
+                     if( too_deep( *itr ) )
+                        return scan_result::too_deep;
+                  itr = itr == end ? end : itr + 3;
+               }
+               else if( c == '"' || c == '\'' )
+               {
+                  for( ++itr; itr != end && *itr != c; ++itr, ++length )
+                  {
+                     if( too_deep( *itr ) )
+                        return scan_result::too_deep;
+                     if( *itr == '\\' && itr + 1 != end )
+                     {
+                        ++itr;
+                        ++length;
+                     }
+                  }
+                  if( itr != end )
+                     ++itr;
+               }
+               else
+               {
+                  for( ; itr != end && !is_delimiter( *itr ); ++itr, ++length )
+                  {
+                     if( *itr == '\\' && itr + 1 != end )
+                     {
+                        ++itr;
+                        ++length;
+                     }
+                  }
+               }
+               if( l.max_string_length != 0 && length > l.max_string_length )
+                  return scan_result::string_too_long;
+               ++elements;
+               after_token = true;
+            }
+         }
+         // the last token may still turn out to be a key
+         if( l.max_elements != 0 && elements > l.max_elements + ( after_token ? 1 : 0 ) )
+            return scan_result::too_many_elements;
       }
+      if( l.max_elements != 0 && elements > l.max_elements )
+         return scan_result::too_many_elements;
+      return scan_result::valid;
+   }
+
+   /** checks limits for input the strict scanner rejects, before it is handed to the lenient parsers */
+   void check_lenient_limits( detail::scan_result r, const string& utf8_str, const json::limits& l )
+   {
+      detail::throw_if_limit_exceeded( r, utf8_str, l );
+      if( r != detail::scan_result::valid )
+         detail::throw_if_limit_exceeded( scan_lenient( utf8_str, l ), utf8_str, l );
+   }
+
+   const json::limits& json::default_limits()
+   {
+      return detail::default_limits();
+   }
+
+   void json::set_default_limits( const limits& l )
+   {
+      detail::default_limits() = l;
+   }
+
+   bool json::check_limits( const std::string& utf8_str, const limits& l )
+   {
+      auto r = scan_json( utf8_str, l, false );
+      detail::throw_if_limit_exceeded( r, utf8_str, l );
+      return r == detail::scan_result::valid;
    }
-   
+
    variant json::from_string( const std::string& utf8_str, parse_type ptype )
+   {
+      return from_string( utf8_str, ptype, default_limits() );
+   }
+
+   variants json::variants_from_string( const std::string& utf8_str, parse_type ptype )
+   {
+      return variants_from_string( utf8_str, ptype, default_limits() );
+   }
+
+   variant json::from_string( const std::string& utf8_str, parse_type ptype, const limits& l )
    { try {
-      check_string_depth( utf8_str );
+      check_lenient_limits( scan_json( utf8_str, l, false ), utf8_str, l );
 
       fc::stringstream in( utf8_str );
       //in.exceptions( std::ifstream::eofbit );
@@ -477,9 +658,9 @@ namespace fc
       }
    } FC_RETHROW_EXCEPTIONS( warn, "", ("str",utf8_str) ) }
 
-   variants json::variants_from_string( const std::string& utf8_str, parse_type ptype )
+   variants json::variants_from_string( const std::string& utf8_str, parse_type ptype, const limits& l )
    { try {
-      check_string_depth( utf8_str );
+      check_lenient_limits( scan_json( utf8_str, l, true ), utf8_str, l );
       variants result;
       fc::stringstream in( utf8_str );
       //in.exceptions( std::ifstream::eofbit );
@@ -492,6 +673,163 @@ namespace fc
       } catch ( const fc::eof_exception& ){}
       return result;
    } FC_RETHROW_EXCEPTIONS( warn, "", ("str",utf8_str) ) }
+   namespace detail
+   {
+      /** inputs smaller than this are not worth handing to other threads */
+      const size_t min_parallel_parse_size = 1024*1024;
+
+      /** splits a newline delimited text into about `pieces` ranges that end at a newline */
+      std::vector< std::pair<size_t,size_t> > split_lines( const string& str, size_t pieces )
+      {
+         std::vector< std::pair<size_t,size_t> > ranges;
+         const size_t target = std::max<size_t>( str.size() / pieces, 1 );
+         size_t begin = 0;
+         while( begin < str.size() )
+         {
+            size_t end = std::min( begin + target, str.size() );
+            if( end < str.size() )
+            {
+               const char* nl = static_cast<const char*>( memchr( str.data() + end, '\n', str.size() - end ) );
+               end = nl ? size_t( nl - str.data() ) + 1 : str.size();
+            }
+            ranges.emplace_back( begin, end );
+            begin = end;
+         }
+         return ranges;
+      }
+
+      /**
+       *  splits the elements of a top level array into about `pieces` ranges, each holding
+       *  complete elements without the separating commas
+       */
+      std::vector< std::pair<size_t,size_t> > split_array( const string& str, size_t pieces )
+      {
+         std::vector< std::pair<size_t,size_t> > ranges;
+         const char* s = str.data();
+         const size_t n = str.size();
+         size_t pos = 0;
+         while( pos < n && isspace( static_cast<unsigned char>(s[pos]) ) ) ++pos;
+         FC_ASSERT( pos < n && s[pos] == '[', "Expected a top level array" );
+
+         const size_t target = std::max<size_t>( n / pieces, 1 );
+         size_t begin    = ++pos;
+         size_t next_cut = begin + target;
+         int32_t depth   = 0;
+         for( ; pos < n; ++pos )
+         {
+            switch( s[pos] )
+            {
+               case '"':
+                  for( ++pos; pos < n && s[pos] != '"'; ++pos )
+                     if( s[pos] == '\\' ) ++pos;
+                  break;
+               case '{':
+               case '[':
+                  ++depth;
+                  break;
+               case '}':
+                  --depth;
+                  break;
+               case ']':
+                  if( depth-- == 0 )
+                  {
+                     ranges.emplace_back( begin, pos );
+                     for( ++pos; pos < n && isspace( static_cast<unsigned char>(s[pos]) ); ++pos );
+                     if( pos != n )
+                        FC_THROW_EXCEPTION( parse_error_exception, "Unexpected content after the top level array at offset ${pos}",
+                                            ("pos",pos) );
+                     return ranges;
+                  }
+                  break;
+               case ',':
+                  if( depth == 0 && pos >= next_cut )
+                  {
+                     ranges.emplace_back( begin, pos );
+                     begin    = pos + 1;
+                     next_cut = begin + target;
+                  }
+                  break;
+               default:
+                  break;
+            }
+         }
+         FC_THROW_EXCEPTION( parse_error_exception, "Expected ']' at the end of the top level array" );
+      }
+
+      variants parse_chunk( const string& str, const std::pair<size_t,size_t>& range,
+                            json::sequence_format fmt, json::parse_type ptype )
+      {
+         if( fmt == json::newline_delimited )
+         {
+            // line by line, so every value goes through the parser ptype asks for
+            variants result;
+            size_t begin = range.first;
+            while( begin < range.second )
+            {
+               const char* nl = static_cast<const char*>( memchr( str.data() + begin, '\n', range.second - begin ) );
+               const size_t end = nl ? size_t( nl - str.data() ) : range.second;
+               string line = str.substr( begin, end - begin );
+               if( line.find_first_not_of( " \t\r" ) != string::npos )
+                  result.push_back( json::from_string( line, ptype, json::default_limits() ) );
+               begin = end + 1;
+            }
+            return result;
+         }
+         string chunk;
+         chunk.reserve( range.second - range.first + 2 );
+         chunk += '[';
+         chunk.append( str, range.first, range.second - range.first );
+         chunk += ']';
+         return std::move( json::from_string( chunk, ptype ).get_array() );
+      }
+   }
+
+   void json::parallel_parse( const string& utf8_str, sequence_format fmt,
+                              const std::function<void( size_t chunk_count )>& on_split,
+                              const chunk_handler& on_chunk, parse_type ptype, uint32_t threads )
+   { try {
+      thread_pool& pool = thread_pool::default_pool();
+      if( threads == 0 )
+         threads = pool.size();
+      if( utf8_str.size() < detail::min_parallel_parse_size )
+         threads = 1;
+
+      // a few chunks per thread keep the threads busy when chunks parse at different speeds
+      const size_t pieces = threads == 1 ? 1 : threads * 4;
+      auto ranges = fmt == newline_delimited ? detail::split_lines( utf8_str, pieces )
+                                             : detail::split_array( utf8_str, pieces );
+      on_split( ranges.size() );
+
+      if( threads == 1 )
+      {
+         for( size_t i = 0; i < ranges.size(); ++i )
+            on_chunk( i, detail::parse_chunk( utf8_str, ranges[i], fmt, ptype ) );
+         return;
+      }
+
+      // parallel_for returns only once every chunk is done, so no worker still references our arguments
+      pool.parallel_for( 0, ranges.size(), [&]( size_t i ) {
+         on_chunk( i, detail::parse_chunk( utf8_str, ranges[i], fmt, ptype ) );
+      });
+   } FC_CAPTURE_AND_RETHROW( (fmt)(ptype)(threads) ) }
+
+   variants json::parallel_variants_from_string( const string& utf8_str, sequence_format fmt,
+                                                 parse_type ptype, uint32_t threads )
+   {
+      std::vector<variants> chunks;
+      parallel_parse( utf8_str, fmt,
+                      [&]( size_t n ) { chunks.resize( n ); },
+                      [&]( size_t i, variants&& values ) { chunks[i] = std::move( values ); },
+                      ptype, threads );
+      size_t total = 0;
+      for( const auto& c : chunks ) total += c.size();
+      variants result;
+      result.reserve( total );
+      for( auto& c : chunks )
+         std::move( c.begin(), c.end(), std::back_inserter( result ) );
+      return result;
+   }
+
    /*
    void toUTF8( const char str, ostream& os )
    {
@@ -505,80 +843,289 @@ namespace fc
    }
    */
 
+   namespace detail
+   {
+      /** two-character escapes; control characters without one are written as \\u00XX */
+      static const char* short_escape( char c )
+      {
+         switch( c )
+         {
+            case '\b': return "\\b";
+            case '\f': return "\\f";
+            case '\n': return "\\n";
+            case '\r': return "\\r";
+            case '\t': return "\\t";
+            case '\\': return "\\\\";
+            case '"':  return "\\\"";
+            default:   return nullptr;
+         }
+      }
+
+      static inline bool needs_escape( unsigned char c )
+      {
+         return c < 0x20 || c == '"' || c == '\\';
+      }
+
+      /** @return pointer to the first character in [itr,end) that must be escaped, or end */
+      static const char* find_escape( const char* itr, const char* end )
+      {
+#if defined(__SSE2__)
+         const __m128i quote     = _mm_set1_epi8( '"' );
+         const __m128i backslash = _mm_set1_epi8( '\\' );
+         const __m128i ctrl_max  = _mm_set1_epi8( 0x1f );
+         while( end - itr >= 16 )
+         {
+            __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( itr ) );
+            __m128i hits  = _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                          _mm_cmpeq_epi8( chunk, backslash ) );
+            // unsigned chunk <= 0x1f  <=>  min(chunk,0x1f) == chunk
+            hits = _mm_or_si128( hits, _mm_cmpeq_epi8( _mm_min_epu8( chunk, ctrl_max ), chunk ) );
+            int mask = _mm_movemask_epi8( hits );
+            if( mask != 0 )
+               return itr + __builtin_ctz( mask );
+            itr += 16;
+         }
+#endif
+         while( itr != end && !needs_escape( static_cast<unsigned char>(*itr) ) )
+            ++itr;
+         return itr;
+      }
+   }
+
    /**
     *  Convert '\t', '\a', '\n', '\\' and '"'  to "\t\a\n\\\""
     *
-    *  All other characters are printed as UTF8.
+    *  All other characters are printed as UTF8.  Runs of characters that need
+    *  no escaping are located with SIMD (where available) and written in bulk.
     */
-   void escape_string( const string& str, ostream& os )
+   void escape_string( const char* str, size_t len, ostream& os )
    {
-      os << '"';
-      for( auto itr = str.begin(); itr != str.end(); ++itr )
+      static const char hex[] = "0123456789abcdef";
+      os.put( '"' );
+      const char* itr = str;
+      const char* end = itr + len;
+      while( itr != end )
       {
-         switch( *itr )
+         const char* next = detail::find_escape( itr, end );
+         if( next != itr )
+            os.write( itr, next - itr );
+         if( next == end )
+            break;
+         if( const char* esc = detail::short_escape( *next ) )
+            os.write( esc, 2 );
+         else
          {
-            case '\b':        // \x08
-               os << "\\b";
-               break;
-            case '\f':        // \x0c
-               os << "\\f";
-               break;
-            case '\n':        // \x0a
-               os << "\\n";
-               break;
-            case '\r':        // \x0d
-               os << "\\r";
+            unsigned char c = static_cast<unsigned char>(*next);
+            char buf[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            os.write( buf, sizeof(buf) );
+         }
+         itr = next + 1;
+      }
+      os.put( '"' );
+   }
+
+   void escape_string( const string& str, ostream& os )
+   {
+      escape_string( str.data(), str.size(), os );
+   }
+   /**
+    *  Validates strict JSON in a single pass without allocating and reports the first limit
+    *  that is exceeded.  With sequence set, any number of whitespace separated values is accepted.
+    */
+   detail::scan_result scan_json( const string& str, const json::limits& l, bool sequence )
+   {
+      using detail::scan_result;
+      if( l.max_bytes != 0 && str.size() > l.max_bytes )
+         return scan_result::too_large;
+
+      const uint32_t max_depth = l.effective_max_depth();
+      uint64_t       is_object[ json::limits::max_depth_cap / 64 ];
+      uint32_t       depth    = 0;
+      size_t         elements = 0;
+
+      const char* itr = str.data();
+      const char* end = itr + str.size();
+
+      auto skip_white_space = [&]() {
+         while( itr != end && ( *itr == ' ' || *itr == '\t' || *itr == '\n' || *itr == '\r' ) )
+            ++itr;
+      };
+      auto is_digit = [&]() { return itr != end && *itr >= '0' && *itr <= '9'; };
+      auto skip_digits = [&]() { while( is_digit() ) ++itr; };
+
+      // on success itr is one past the closing quote
+      auto scan_string = [&]() -> scan_result {
+         const char* begin = ++itr;
+         while( true )
+         {
+            itr = detail::find_escape( itr, end );
+            if( itr == end )
+               return scan_result::invalid;
+            if( *itr == '"' )
                break;
-            case '\t':        // \x09
-               os << "\\t";
+            if( *itr != '\\' )
+               return scan_result::invalid; // raw control character
+            if( ++itr == end )
+               return scan_result::invalid;
+            switch( *itr )
+            {
+               case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                  ++itr;
+                  break;
+               case 'u':
+                  for( int i = 0; i < 4; ++i )
+                  {
+                     if( ++itr == end || !isxdigit( static_cast<unsigned char>(*itr) ) )
+                        return scan_result::invalid;
+                  }
+                  ++itr;
+                  break;
+               default:
+                  return scan_result::invalid;
+            }
+         }
+         if( l.max_string_length != 0 && size_t(itr - begin) > l.max_string_length )
+            return scan_result::string_too_long;
+         ++itr;
+         return scan_result::valid;
+      };
+
+      enum { want_value, want_key, after_value } state = want_value;
+      skip_white_space();
+      if( itr == end )
+         return scan_result::invalid;
+      while( true )
+      {
+         switch( state )
+         {
+            case want_value:
+            {
+               if( itr == end )
+                  return scan_result::invalid;
+               if( l.max_elements != 0 && ++elements > l.max_elements )
+                  return scan_result::too_many_elements;
+               state = after_value;
+               switch( *itr )
+               {
+                  case '{':
+                  case '[':
+                  {
+                     if( depth + 1 >= max_depth )
+                        return scan_result::too_deep;
+                     const bool object = *itr == '{';
+                     if( object )
+                        is_object[depth / 64] |= uint64_t(1) << (depth % 64);
+                     else
+                        is_object[depth / 64] &= ~(uint64_t(1) << (depth % 64));
+                     ++depth;
+                     ++itr;
+                     skip_white_space();
+                     if( itr != end && *itr == ( object ? '}' : ']' ) )
+                     {
+                        --depth;
+                        ++itr;
+                     }
+                     else
+                        state = object ? want_key : want_value;
+                     break;
+                  }
+                  case '"':
+                  {
+                     auto r = scan_string();
+                     if( r != scan_result::valid )
+                        return r;
+                     break;
+                  }
+                  case 't':
+                  case 'f':
+                  case 'n':
+                  {
+                     const char* literal = *itr == 't' ? "true" : *itr == 'f' ? "false" : "null";
+                     size_t len = strlen( literal );
+                     if( size_t(end - itr) < len || memcmp( itr, literal, len ) != 0 )
+                        return scan_result::invalid;
+                     itr += len;
+                     break;
+                  }
+                  default:
+                  {
+                     if( *itr == '-' )
+                        ++itr;
+                     if( !is_digit() )
+                        return scan_result::invalid;
+                     if( *itr == '0' )
+                        ++itr;
+                     else
+                        skip_digits();
+                     if( itr != end && *itr == '.' )
+                     {
+                        ++itr;
+                        if( !is_digit() )
+                           return scan_result::invalid;
+                        skip_digits();
+                     }
+                     if( itr != end && ( *itr == 'e' || *itr == 'E' ) )
+                     {
+                        ++itr;
+                        if( itr != end && ( *itr == '+' || *itr == '-' ) )
+                           ++itr;
+                        if( !is_digit() )
+                           return scan_result::invalid;
+                        skip_digits();
+                     }
+                  }
+               }
                break;
-            case '\\':
-               os << "\\\\";
+            }
+            case want_key:
+            {
+               if( itr == end || *itr != '"' )
+                  return scan_result::invalid;
+               auto r = scan_string();
+               if( r != scan_result::valid )
+                  return r;
+               skip_white_space();
+               if( itr == end || *itr != ':' )
+                  return scan_result::invalid;
+               ++itr;
+               skip_white_space();
+               state = want_value;
                break;
-            case '\"':
-               os << "\\\"";
+            }
+            case after_value:
+            {
+               skip_white_space();
+               if( depth == 0 )
+               {
+                  if( itr == end )
+                     return scan_result::valid;
+                  if( !sequence )
+                     return scan_result::invalid;
+                  state = want_value;
+                  break;
+               }
+               if( itr == end )
+                  return scan_result::invalid;
+               const bool object = ( is_object[(depth - 1) / 64] >> ((depth - 1) % 64) ) & 1;
+               if( *itr == ',' )
+               {
+                  ++itr;
+                  skip_white_space();
+                  state = object ? want_key : want_value;
+               }
+               else if( *itr == ( object ? '}' : ']' ) )
+               {
+                  --depth;
+                  ++itr;
+               }
+               else
+                  return scan_result::invalid;
                break;
-            case '\x00': os << "\\u0000"; break;
-            case '\x01': os << "\\u0001"; break;
-            case '\x02': os << "\\u0002"; break;
-            case '\x03': os << "\\u0003"; break;
-            case '\x04': os << "\\u0004"; break;
-            case '\x05': os << "\\u0005"; break;
-            case '\x06': os << "\\u0006"; break;
-            case '\x07': os << "\\u0007"; break; // \a is not valid JSON
-         // case '\x08': os << "\\u0008"; break; // \b
-         // case '\x09': os << "\\u0009"; break; // \t
-         // case '\x0a': os << "\\u000a"; break; // \n
-            case '\x0b': os << "\\u000b"; break;
-         // case '\x0c': os << "\\u000c"; break; // \f
-         // case '\x0d': os << "\\u000d"; break; // \r
-            case '\x0e': os << "\\u000e"; break;
-            case '\x0f': os << "\\u000f"; break;
-
-            case '\x10': os << "\\u0010"; break;
-            case '\x11': os << "\\u0011"; break;
-            case '\x12': os << "\\u0012"; break;
-            case '\x13': os << "\\u0013"; break;
-            case '\x14': os << "\\u0014"; break;
-            case '\x15': os << "\\u0015"; break;
-            case '\x16': os << "\\u0016"; break;
-            case '\x17': os << "\\u0017"; break;
-            case '\x18': os << "\\u0018"; break;
-            case '\x19': os << "\\u0019"; break;
-            case '\x1a': os << "\\u001a"; break;
-            case '\x1b': os << "\\u001b"; break;
-            case '\x1c': os << "\\u001c"; break;
-            case '\x1d': os << "\\u001d"; break;
-            case '\x1e': os << "\\u001e"; break;
-            case '\x1f': os << "\\u001f"; break;
-
-            default:
-               os << *itr;
-               //toUTF8( *itr, os );
+            }
          }
       }
-      os << '"';
    }
+
    ostream& json::to_stream( ostream& out, const fc::string& str )
    {
         escape_string( str, out );
@@ -658,7 +1205,7 @@ namespace fc
               os << v.as_string();
               return;
          case variant::string_type:
-              escape_string( v.get_string(), os );
+              escape_string( v.string_data(), v.string_size(), os );
               return;
          case variant::blob_type:
               escape_string( v.as_string(), os );
@@ -686,114 +1233,126 @@ namespace fc
    }
 
 
-    fc::string pretty_print( const fc::string& v, uint8_t indent ) {
-      int level = 0;
-      fc::stringstream ss;
-      bool first = false;
-      bool quote = false;
-      bool escape = false;
-      for( uint32_t i = 0; i < v.size(); ++i ) {
-         switch( v[i] ) {
-            case '\\':
-              if( !escape ) {
-                if( quote )
-                  escape = true;
-              } else { escape = false; }
-              ss<<v[i];
-              break;
-            case ':':
-              if( !quote ) {
-                ss<<": ";
-              } else {
-                ss<<':';
-              }
-              break;
-            case '"':
-              if( first ) {
-                 ss<<'\n';
-                 for( int i = 0; i < level*indent; ++i ) ss<<' ';
-                 first = false;
-              }
-              if( !escape ) {
-                quote = !quote;
-              }
-              escape = false;
-              ss<<'"';
-              break;
-            case '{':
-            case '[':
-              ss<<v[i];
-              if( !quote ) {
-                ++level;
-                first = true;
-              }else {
-                escape = false;
-              }
-              break;
-            case '}':
-            case ']':
-              if( !quote ) {
-                if( v[i-1] != '[' && v[i-1] != '{' ) {
-                  ss<<'\n';
-                }
-                --level;
-                if( !first ) {
-                  for( int i = 0; i < level*indent; ++i ) ss<<' ';
-                }
-                first = false;
-                ss<<v[i];
-                break;
-              } else {
-                escape = false;
-                ss<<v[i];
-              }
-              break;
-            case ',':
-              if( !quote ) {
-                ss<<',';
-                first = true;
-              } else {
-                escape = false;
-                ss<<',';
-              }
-              break;
-            case 'n':
-              //If we're in quotes and see a \n, just print it literally but unset the escape flag.
-              if( quote && escape )
-                escape = false;
-              //No break; fall through to default case
-            default:
-              if( first ) {
-                 ss<<'\n';
-                 for( int i = 0; i < level*indent; ++i ) ss<<' ';
-                 first = false;
-              }
-              ss << v[i];
+   /**
+    *  Writes a variant with one member / element per line in a single pass.  The
+    *  layout matches what the old re-scanning pretty printer produced: a nested
+    *  container opens on the same line as its key or preceding ',', and
+    *  empty containers are written as "{}" / "[]".
+    */
+   template<typename T>
+   class pretty_writer
+   {
+      public:
+         pretty_writer( T& os, json::output_formatting format, uint8_t indent )
+         :_os(os),_format(format),_indent(indent){}
+
+         void write( const variant& v )
+         {
+            switch( v.get_type() )
+            {
+               case variant::array_type:
+                  write( v.get_array() );
+                  return;
+               case variant::object_type:
+                  write( v.get_object() );
+                  return;
+               default:
+                  begin_line();
+                  to_stream( _os, v, _format );
+            }
          }
-      }
-      return ss.str();
-    }
 
+         void write( const variants& a )
+         {
+            _os << '[';
+            ++_level;
+            for( auto itr = a.begin(); itr != a.end(); ++itr )
+            {
+               if( itr != a.begin() )
+                  _os << ',';
+               _new_line = true;
+               write( *itr );
+            }
+            end_container( ']', a.empty() );
+         }
 
+         void write( const variant_object& o )
+         {
+            _os << '{';
+            ++_level;
+            for( auto itr = o.begin(); itr != o.end(); ++itr )
+            {
+               if( itr != o.begin() )
+                  _os << ',';
+               _new_line = true;
+               begin_line();
+               escape_string( itr->key(), _os );
+               _os.write( ": ", 2 );
+               write( itr->value() );
+            }
+            end_container( '}', o.size() == 0 );
+         }
+
+      private:
+         void begin_line()
+         {
+            if( !_new_line ) return;
+            _new_line = false;
+            _os << '\n';
+            write_indent();
+         }
+
+         void end_container( char c, bool empty )
+         {
+            --_level;
+            _new_line = false;
+            if( !empty )
+            {
+               _os << '\n';
+               write_indent();
+            }
+            _os << c;
+         }
+
+         void write_indent()
+         {
+            static const char spaces[] = "                                                                ";
+            size_t n = size_t(_level) * _indent;
+            while( n > 0 )
+            {
+               size_t chunk = std::min( n, sizeof(spaces) - 1 );
+               _os.write( spaces, chunk );
+               n -= chunk;
+            }
+         }
+
+         T&                      _os;
+         json::output_formatting _format;
+         uint8_t                 _indent;
+         uint32_t                _level = 0;
+         bool                    _new_line = false;
+   };
+
+   template<typename T>
+   void to_pretty_stream( T& os, const variant& v, json::output_formatting format, uint8_t indent )
+   {
+      pretty_writer<T>( os, format, indent ).write( v );
+   }
 
    fc::string json::to_pretty_string( const variant& v, output_formatting format /* = stringify_large_ints_and_doubles */ )
    {
-	   return pretty_print(to_string(v, format), 2);
+      fc::stringstream ss;
+      to_pretty_stream( ss, v, format, 2 );
+      return ss.str();
    }
 
    void json::save_to_file( const variant& v, const fc::path& fi, bool pretty, output_formatting format /* = stringify_large_ints_and_doubles */ )
    {
+      fc::ofstream o(fi);
       if( pretty )
-      {
-        auto str = json::to_pretty_string( v, format );
-        fc::ofstream o(fi);
-        o.write( str.c_str(), str.size() );
-      }
+        to_pretty_stream( o, v, format, 2 );
       else
-      {
-       fc::ofstream o(fi);
-       fc::to_stream( o, v, format );
-      }
+        fc::to_stream( o, v, format );
    }
    variant json::from_file( const fc::path& p, parse_type ptype )
    {
@@ -850,7 +1409,21 @@ namespace fc
 
    bool json::is_valid( const std::string& utf8_str, parse_type ptype )
    {
+      return is_valid( utf8_str, ptype, default_limits() );
+   }
+
+   bool json::is_valid( const std::string& utf8_str, parse_type ptype, const limits& l )
+   {
+      auto r = scan_json( utf8_str, l, false );
+      if( r == detail::scan_result::valid )
+         return true;
+      if( r != detail::scan_result::invalid || ptype == strict_parser )
+         return false;
+
+      // not strict JSON, but the lenient parsers may still accept it
       if( utf8_str.size() == 0 ) return false;
+      if( scan_lenient( utf8_str, l ) != detail::scan_result::valid )
+         return false;
       fc::stringstream in( utf8_str );
       switch( ptype )
       {
@@ -860,9 +1433,6 @@ namespace fc
           case legacy_parser_with_string_doubles:
               variant_from_stream<fc::stringstream, legacy_parser_with_string_doubles>( in );
               break;
-          case strict_parser:
-              json_relaxed::variant_from_stream<fc::stringstream, true>( in );
-              break;
           case relaxed_parser:
               json_relaxed::variant_from_stream<fc::stringstream, false>( in );
               break;
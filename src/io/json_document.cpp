@@ -0,0 +1,347 @@
+#include <fc/io/json_document.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <cstring>
+#include <limits>
+
+namespace fc
+{
+   namespace
+   {
+      inline size_t skip_white_space( const char* s, size_t pos, size_t n )
+      {
+         while( pos < n && ( s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r' ) )
+            ++pos;
+         return pos;
+      }
+
+      /** @return offset one past the closing quote, or 0 if the string is not terminated */
+      inline size_t skip_string( const char* s, size_t pos, size_t n )
+      {
+         for( ++pos; pos < n; ++pos )
+         {
+            if( s[pos] == '\\' )
+               ++pos;
+            else if( s[pos] == '"' )
+               return pos + 1;
+         }
+         return 0;
+      }
+
+      /** unescapes the body of a string the same way the legacy parser does */
+      string unescape( const char* itr, const char* end )
+      {
+         string result;
+         result.reserve( end - itr );
+         while( itr != end )
+         {
+            const char* bs = static_cast<const char*>( memchr( itr, '\\', end - itr ) );
+            if( bs == nullptr )
+            {
+               result.append( itr, end );
+               break;
+            }
+            result.append( itr, bs );
+            itr = bs + 1;
+            if( itr == end )
+               break;
+            switch( *itr )
+            {
+               case 't': result.push_back( '\t' ); break;
+               case 'n': result.push_back( '\n' ); break;
+               case 'r': result.push_back( '\r' ); break;
+               default:  result.push_back( *itr );
+            }
+            ++itr;
+         }
+         return result;
+      }
+   }
+
+   json_document json_document::from_string( string utf8_str )
+   { try {
+      json_document doc;
+      doc._json = std::move( utf8_str );
+      if( !doc.build_tape() )
+      {
+         doc._json = json::to_string( json::from_string( doc._json ), json::legacy_generator );
+         FC_ASSERT( doc.build_tape(), "unable to index normalized JSON" );
+      }
+      return doc;
+   } FC_RETHROW_EXCEPTIONS( warn, "" ) }
+
+   /**
+    *  Single forward pass over _json that records one tape_entry per value.  Returns
+    *  false for anything that is not plain JSON so the caller can fall back to the
+    *  legacy parser, which decides whether and how to accept it.
+    */
+   bool json_document::build_tape()
+   {
+      const char*  s = _json.data();
+      const size_t n = _json.size();
+      if( n == 0 || n >= std::numeric_limits<uint32_t>::max() )
+         return false;
+
+      _tape.clear();
+      _tape.reserve( n / 8 + 1 );
+      std::vector<uint32_t> open;
+      // json::from_string enforces the same bound, so input too deep for the tape fails there
+      // with a proper error rather than failing to index after the fallback
+      const uint32_t max_depth = json::default_limits().effective_max_depth();
+
+      auto push = [&]( json_value::value_type t, size_t begin, size_t end ) {
+         _tape.push_back( tape_entry{ uint8_t(t), uint32_t(begin), uint32_t(end), uint32_t(_tape.size() + 1), 0 } );
+      };
+
+      size_t pos = skip_white_space( s, 0, n );
+      while( true )
+      {
+         // parse one value starting at pos
+         if( pos >= n )
+            return false;
+         if( !open.empty() && _tape[open.back()].type == json_value::array_value )
+            ++_tape[open.back()].count;
+
+         bool closed_value = true;
+         switch( s[pos] )
+         {
+            case '{':
+            case '[':
+            {
+               if( open.size() + 1 >= max_depth )
+                  return false;
+               const bool is_object = s[pos] == '{';
+               open.push_back( uint32_t(_tape.size()) );
+               push( is_object ? json_value::object_value : json_value::array_value, pos, pos );
+               pos = skip_white_space( s, pos + 1, n );
+               if( pos < n && s[pos] == ( is_object ? '}' : ']' ) )
+                  break; // empty container, closed below
+               closed_value = false;
+               break;
+            }
+            case '"':
+            {
+               size_t end = skip_string( s, pos, n );
+               if( end == 0 )
+                  return false;
+               push( json_value::string_value, pos, end );
+               pos = end;
+               break;
+            }
+            case 't':
+            case 'f':
+            case 'n':
+            {
+               const char* lit = s[pos] == 't' ? "true" : s[pos] == 'f' ? "false" : "null";
+               size_t len = strlen( lit );
+               if( n - pos < len || memcmp( s + pos, lit, len ) != 0 )
+                  return false;
+               push( s[pos] == 'n' ? json_value::null_value : json_value::bool_value, pos, pos + len );
+               pos += len;
+               break;
+            }
+            default:
+            {
+               size_t end = pos;
+               while( end < n && ( ( s[end] >= '0' && s[end] <= '9' ) || s[end] == '-' || s[end] == '+'
+                                   || s[end] == '.' || s[end] == 'e' || s[end] == 'E' ) )
+                  ++end;
+               if( end == pos )
+                  return false;
+               push( json_value::number_value, pos, end );
+               pos = end;
+            }
+         }
+
+         if( !closed_value )
+         {
+            // first member of a non-empty object needs a key, first element of an array is a value
+            if( _tape[open.back()].type == json_value::object_value )
+               goto parse_key;
+            continue;
+         }
+
+         // after a value: close containers or move on to the next sibling
+         while( true )
+         {
+            pos = skip_white_space( s, pos, n );
+            if( open.empty() )
+               return pos == n;
+            if( pos >= n )
+               return false;
+
+            tape_entry& parent = _tape[open.back()];
+            const char close = parent.type == json_value::object_value ? '}' : ']';
+            if( s[pos] == close )
+            {
+               parent.end  = uint32_t(pos + 1);
+               parent.next = uint32_t(_tape.size());
+               open.pop_back();
+               ++pos;
+               continue;
+            }
+            if( s[pos] != ',' )
+               return false;
+            pos = skip_white_space( s, pos + 1, n );
+            break;
+         }
+         if( _tape[open.back()].type == json_value::array_value )
+            continue;
+
+      parse_key:
+         {
+            if( pos >= n || s[pos] != '"' )
+               return false;
+            size_t end = skip_string( s, pos, n );
+            if( end == 0 )
+               return false;
+            ++_tape[open.back()].count;
+            push( json_value::string_value, pos, end );
+            pos = skip_white_space( s, end, n );
+            if( pos >= n || s[pos] != ':' )
+               return false;
+            pos = skip_white_space( s, pos + 1, n );
+         }
+      }
+   }
+
+   json_value::value_type json_value::get_type()const
+   {
+      if( _var == nullptr )
+         return value_type( _doc->_tape[_index].type );
+      switch( _var->get_type() )
+      {
+         case variant::null_type:   return null_value;
+         case variant::bool_type:   return bool_value;
+         case variant::int64_type:
+         case variant::uint64_type:
+         case variant::double_type: return number_value;
+         case variant::array_type:  return array_value;
+         case variant::object_type: return object_value;
+         default:                   return string_value;
+      }
+   }
+
+   size_t json_value::size()const
+   {
+      if( !is_array() && !is_object() )
+         return 0;
+      if( _var != nullptr )
+         return is_array() ? _var->get_array().size() : _var->get_object().size();
+      return _doc->_tape[_index].count;
+   }
+
+   json_value json_value::operator[]( size_t pos )const
+   {
+      FC_ASSERT( is_array(), "json value is not an array" );
+      FC_ASSERT( pos < size(), "index ${pos} out of range, array has ${size} elements", ("pos",pos)("size",size()) );
+      if( _var != nullptr )
+         return json_value( _var->get_array()[pos] );
+      uint32_t child = _index + 1;
+      while( pos-- > 0 )
+         child = _doc->_tape[child].next;
+      return json_value( _doc, child );
+   }
+
+   json_value json_value::find( const string& key )const
+   {
+      if( !is_object() )
+         return json_value();
+      if( _var != nullptr )
+      {
+         const variant_object& obj = _var->get_object();
+         auto itr = obj.find( key );
+         return itr == obj.end() ? json_value() : json_value( itr->value() );
+      }
+      const auto& tape = _doc->_tape;
+      const char* s = _doc->_json.data();
+      uint32_t k = _index + 1;
+      for( uint32_t i = 0; i < tape[_index].count; ++i )
+      {
+         const char* begin = s + tape[k].begin + 1;
+         const char* end   = s + tape[k].end - 1;
+         size_t len = end - begin;
+         bool match;
+         if( memchr( begin, '\\', len ) == nullptr )
+            match = len == key.size() && memcmp( begin, key.data(), len ) == 0;
+         else
+            match = unescape( begin, end ) == key;
+         if( match )
+            return json_value( _doc, k + 1 );
+         k = tape[k + 1].next;
+      }
+      return json_value();
+   }
+
+   json_value json_value::operator[]( const string& key )const
+   {
+      json_value v = find( key );
+      if( v._is_missing() )
+         FC_THROW_EXCEPTION( key_not_found_exception, "Key ${key}", ("key",key) );
+      return v;
+   }
+
+   string json_value::raw()const
+   {
+      if( _is_missing() )
+         return "null";
+      if( _var != nullptr )
+         return json::to_string( *_var, json::legacy_generator );
+      const auto& e = _doc->_tape[_index];
+      return _doc->_json.substr( e.begin, e.end - e.begin );
+   }
+
+   string json_value::as_string()const
+   {
+      if( is_string() && _var == nullptr )
+      {
+         const auto& e = _doc->_tape[_index];
+         const char* s = _doc->_json.data();
+         return unescape( s + e.begin + 1, s + e.end - 1 );
+      }
+      return as_variant().as_string();
+   }
+
+   uint64_t json_value::as_uint64()const
+   {
+      return as_variant().as_uint64();
+   }
+
+   int64_t json_value::as_int64()const
+   {
+      return as_variant().as_int64();
+   }
+
+   variant json_value::as_variant()const
+   {
+      if( is_null() )
+         return variant();
+      if( _var != nullptr )
+         return *_var;
+      if( is_string() )
+         return variant( as_string() );
+      return json::from_string( raw() );
+   }
+
+   variants json_value::as_variants()const
+   {
+      FC_ASSERT( is_array(), "json value is not an array" );
+      if( _var != nullptr )
+         return _var->get_array();
+      variants result;
+      result.reserve( size() );
+      uint32_t child = _index + 1;
+      for( size_t i = 0; i < size(); ++i )
+      {
+         result.push_back( json_value( _doc, child ).as_variant() );
+         child = _doc->_tape[child].next;
+      }
+      return result;
+   }
+
+   void to_variant( const json_value& v, variant& var )
+   {
+      var = v.as_variant();
+   }
+
+} // fc
@@ -9,6 +9,7 @@
 #include <fc/log/file_appender.hpp>
 #include <fc/log/gelf_appender.hpp>
 #include <fc/variant.hpp>
+#include <fc/thread/thread_specific.hpp>
 #include "console_defines.h"
 
 
@@ -32,6 +33,16 @@ namespace fc {
       get_appender_factory_map()[type] = f;
       return true;
    }
+   const string& appender::format_message( const log_message& m )
+   {
+      static fc::thread_specific_ptr<string> buffer;
+      if( !buffer )
+         buffer.reset( new string() );
+      buffer->clear();
+      m.format_message( *buffer );
+      return *buffer;
+   }
+
    appender::ptr appender::create( const fc::string& name, const fc::string& type, const variant& args  )
    {
       auto fact_itr = get_appender_factory_map().find(type);
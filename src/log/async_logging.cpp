@@ -0,0 +1,443 @@
+#include <fc/log/logger.hpp>
+#include <fc/log/logger_config.hpp>
+#include <fc/log/appender.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/time.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <string>
+
+namespace fc {
+   extern std::unordered_map<std::string,appender::ptr>& get_appender_map();
+
+   namespace detail
+   {
+      bool& on_log_writer()
+      {
+         #ifdef _MSC_VER
+            static __declspec(thread) bool w = false;
+         #else
+            static __thread bool w = false;
+         #endif
+         return w;
+      }
+
+      bool& in_log_batch()
+      {
+         #ifdef _MSC_VER
+            static __declspec(thread) bool b = false;
+         #else
+            static __thread bool b = false;
+         #endif
+         return b;
+      }
+
+      /** lets the other tasks of the calling fc thread run while it waits on the writer */
+      void backoff( uint32_t& attempt )
+      {
+         if( ++attempt < 16 )
+            fc::yield();
+         else
+            fc::usleep( fc::microseconds( 100 ) );
+      }
+
+      /**
+       *  Owns the bounded multi-producer / single-consumer ring that logger::log() feeds
+       *  and the thread that drains it.  Every cell carries a sequence number, so a
+       *  producer claims a cell with one CAS on the enqueue position and publishes it
+       *  with a release store; the writer never takes a lock while there is work.
+       */
+      class async_log_writer
+      {
+         public:
+            explicit async_log_writer( const async_logging_config& cfg )
+            :_cfg(cfg),_thread("log_writer")
+            {
+               size_t size = 2;
+               while( size < cfg.queue_size )
+                  size <<= 1;
+               _mask  = size - 1;
+               _cells.reset( new cell[size] );
+               for( size_t i = 0; i < size; ++i )
+                  _cells[i].seq.store( i, std::memory_order_relaxed );
+               _done = _thread.async( [this](){ run(); }, "log_writer" );
+            }
+
+            /** @return false if m must be dispatched by the caller */
+            bool push( const logger& l, log_message& m )
+            {
+               return push( l, m.get_context().get_log_level(), [&]( cell& c ){
+                  c.msg = fc::move(m);
+                  c.is_record = false;
+               });
+            }
+
+            bool push( const logger& l, const log_record& r )
+            {
+               return push( l, r.get_log_level(), [&]( cell& c ){
+                  c.rec = r;
+                  c.is_record = true;
+               });
+            }
+
+            void flush()
+            {
+               await_written( _enqueue_pos.load( std::memory_order_acquire ), fc::hours(24) );
+            }
+
+            /** flushes with a bound on the wait, for paths that are about to terminate */
+            void flush_before_exit()
+            {
+               wait_written( _enqueue_pos.load( std::memory_order_acquire ), std::chrono::seconds(2) );
+            }
+
+            /**
+             *  Turns new pushes away, so their callers dispatch synchronously, waits for the
+             *  pushes already under way, drains the queue and stops the writer thread.
+             */
+            void stop()
+            {
+               _stopping.store( true, std::memory_order_seq_cst );
+               uint32_t attempt = 0;
+               while( _producers.load( std::memory_order_seq_cst ) != 0 )
+                  backoff( attempt );
+               _closed.store( true, std::memory_order_release );
+               wake();
+               _done.wait();
+               _thread.quit();
+            }
+
+         private:
+            static const size_t max_batch = 256;
+
+            struct cell
+            {
+               cell():lgr(nullptr),msg(empty_message()),is_record(false){}
+               std::atomic<uint64_t> seq;
+               logger                lgr;
+               log_message           msg;
+               log_record            rec;
+               bool                  is_record;
+            };
+
+            /** counts a push under way, stop() lets the writer exit only once there are none */
+            struct producer_scope
+            {
+               explicit producer_scope( std::atomic<uint32_t>& n ):_n(n) { _n.fetch_add( 1, std::memory_order_seq_cst ); }
+               ~producer_scope() { _n.fetch_sub( 1, std::memory_order_release ); }
+               std::atomic<uint32_t>& _n;
+            };
+
+            template<typename Fill>
+            bool push( const logger& l, log_level level, Fill&& fill )
+            {
+               uint64_t pos;
+               {
+                  producer_scope producing( _producers );
+                  // either stop() sees this push in _producers or this sees _stopping
+                  if( _stopping.load( std::memory_order_seq_cst ) )
+                     return false;
+                  uint32_t attempt = 0;
+                  while( !try_push( l, fill, pos ) )
+                  {
+                     if( _cfg.overflow != async_logging_config::overflow_policy::block )
+                     {
+                        _dropped.fetch_add( 1, std::memory_order_relaxed );
+                        return true;
+                     }
+                     if( _stopping.load( std::memory_order_acquire ) )
+                        return false;
+                     wake();
+                     backoff( attempt );
+                  }
+               }
+               // pairs with the fence implied by the writer's seq_cst store to _sleeping
+               std::atomic_thread_fence( std::memory_order_seq_cst );
+               if( _sleeping.load( std::memory_order_relaxed ) )
+                  wake();
+               if( _cfg.flush_on_error && level >= log_level::error )
+                  await_written( pos + 1, fc::milliseconds(100) );
+               return true;
+            }
+
+            /** shared by all unused cells so that building the ring allocates no messages */
+            static const log_message& empty_message()
+            {
+               static log_message m;
+               return m;
+            }
+
+            template<typename Fill>
+            bool try_push( const logger& l, Fill& fill, uint64_t& pos )
+            {
+               pos = _enqueue_pos.load( std::memory_order_relaxed );
+               for( ;; )
+               {
+                  cell& c = _cells[pos & _mask];
+                  const uint64_t seq = c.seq.load( std::memory_order_acquire );
+                  const int64_t  dif = int64_t(seq) - int64_t(pos);
+                  if( dif == 0 )
+                  {
+                     if( _enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                     {
+                        c.lgr = l;
+                        fill( c );
+                        c.seq.store( pos + 1, std::memory_order_release );
+                        return true;
+                     }
+                  }
+                  else if( dif < 0 )
+                     return false;
+                  else
+                     pos = _enqueue_pos.load( std::memory_order_relaxed );
+               }
+            }
+
+            /** delivers at most max_batch messages, @return how many */
+            size_t deliver_batch()
+            {
+               size_t n = 0;
+               in_log_batch() = true;
+               for( ; n < max_batch; ++n )
+               {
+                  cell& c = _cells[_dequeue_pos & _mask];
+                  if( c.seq.load( std::memory_order_acquire ) != _dequeue_pos + 1 )
+                     break;
+                  logger      l( fc::move(c.lgr) );
+                  log_message m( empty_message() );
+                  try
+                  {
+                     m = c.is_record ? c.rec.to_log_message() : fc::move(c.msg);
+                  }
+                  catch( ... )
+                  {
+                     l = logger(nullptr);
+                  }
+                  c.seq.store( _dequeue_pos + _mask + 1, std::memory_order_release );
+                  ++_dequeue_pos;
+                  try
+                  {
+                     if( l != nullptr )
+                        l.dispatch( m );
+                  }
+                  catch( ... )
+                  {
+                     // an appender failing must not take the writer down with it
+                  }
+               }
+               in_log_batch() = false;
+               return n;
+            }
+
+            void flush_appenders()
+            {
+               for( auto& a : get_appender_map() )
+               {
+                  if( a.second )
+                  {
+                     try { a.second->flush(); } catch( ... ) {}
+                  }
+               }
+            }
+
+            void report_drops()
+            {
+               const uint64_t dropped = _dropped.load( std::memory_order_relaxed );
+               if( dropped == _reported )
+                  return;
+               if( _cfg.overflow == async_logging_config::overflow_policy::drop_and_report )
+               {
+                  logger l = logger::get();
+                  if( l != nullptr && l.is_enabled( log_level::warn ) )
+                  {
+                     log_message m( FC_LOG_CONTEXT(warn), "log queue overflowed, ${n} messages were dropped",
+                                    fc::mutable_variant_object()( "n", dropped - _reported ) );
+                     l.dispatch( m );
+                  }
+               }
+               _reported = dropped;
+            }
+
+            void run()
+            {
+               on_log_writer() = true;
+               for( ;; )
+               {
+                  size_t delivered = 0;
+                  while( size_t n = deliver_batch() )
+                  {
+                     delivered += n;
+                     if( n < max_batch )
+                        break;
+                  }
+                  if( delivered )
+                  {
+                     report_drops();
+                     flush_appenders();
+                     std::lock_guard<std::mutex> lock( _mutex );
+                     _written.store( _dequeue_pos, std::memory_order_release );
+                     _drained.notify_all();
+                     continue;
+                  }
+
+                  // nothing queued: tell producers to wake us, then look once more before sleeping
+                  std::unique_lock<std::mutex> lock( _mutex );
+                  _sleeping.store( true, std::memory_order_seq_cst );
+                  // loaded first: once closed, every accepted push is visible in the ring
+                  const bool closed = _closed.load( std::memory_order_acquire );
+                  const bool idle = _cells[_dequeue_pos & _mask].seq.load( std::memory_order_acquire ) != _dequeue_pos + 1;
+                  if( idle && closed )
+                  {
+                     _sleeping.store( false, std::memory_order_relaxed );
+                     break;
+                  }
+                  if( idle )
+                     _wake.wait_for( lock, std::chrono::milliseconds(100) );
+                  _sleeping.store( false, std::memory_order_relaxed );
+               }
+               report_drops();
+               on_log_writer() = false;
+            }
+
+            void wake()
+            {
+               std::lock_guard<std::mutex> lock( _mutex );
+               _wake.notify_one();
+            }
+
+            /** waits with fc::yield() / fc::usleep(), so other tasks of the calling thread keep running */
+            void await_written( uint64_t pos, const fc::microseconds& timeout )
+            {
+               if( on_log_writer() )
+                  return;
+               const fc::time_point deadline = fc::time_point::now() + timeout;
+               uint32_t attempt = 0;
+               wake();
+               while( _written.load( std::memory_order_acquire ) < pos && fc::time_point::now() < deadline )
+                  backoff( attempt );
+            }
+
+            /** blocks the OS thread, for the terminate and exit paths where tasks may no longer run */
+            template<typename Duration>
+            void wait_written( uint64_t pos, Duration timeout )
+            {
+               if( on_log_writer() )
+                  return;
+               std::unique_lock<std::mutex> lock( _mutex );
+               _wake.notify_one();
+               _drained.wait_for( lock, timeout, [&](){ return _written.load( std::memory_order_acquire ) >= pos; } );
+            }
+
+            const async_logging_config _cfg;
+            std::unique_ptr<cell[]>    _cells;
+            uint64_t                   _mask;
+            std::atomic<uint64_t>      _enqueue_pos{0};
+            uint64_t                   _dequeue_pos = 0;  ///< only touched by the writer
+            std::atomic<uint64_t>      _written{0};
+            std::atomic<uint64_t>      _dropped{0};
+            uint64_t                   _reported = 0;
+            std::atomic<bool>          _sleeping{false};
+            std::atomic<bool>          _stopping{false};  ///< no more pushes are accepted
+            std::atomic<bool>          _closed{false};    ///< no push is under way, the writer exits once idle
+            std::atomic<uint32_t>      _producers{0};
+            std::mutex                 _mutex;
+            std::condition_variable    _wake;
+            std::condition_variable    _drained;
+            fc::thread                 _thread;
+            fc::future<void>           _done;
+      };
+
+      std::atomic<async_log_writer*>& current_log_writer()
+      {
+         static std::atomic<async_log_writer*> w( nullptr );
+         return w;
+      }
+
+      template<typename Message>
+      bool async_log_impl( const logger& l, Message& m )
+      {
+         async_log_writer* w = current_log_writer().load( std::memory_order_acquire );
+         // the writer itself logs synchronously, it cannot wait on its own queue
+         if( w == nullptr || on_log_writer() )
+            return false;
+         return w->push( l, m );
+      }
+
+      bool async_log( const logger& l, log_message& m )      { return async_log_impl( l, m ); }
+      bool async_log( const logger& l, const log_record& r ) { return async_log_impl( l, r ); }
+
+      /** makes every appender write out what it buffers, an appender failing does not stop the others */
+      void force_flush_appenders()
+      {
+         for( auto& a : get_appender_map() )
+         {
+            if( a.second )
+            {
+               try { a.second->force_flush(); } catch( ... ) {}
+            }
+         }
+      }
+
+      std::terminate_handler previous_terminate_handler = nullptr;
+
+      void flush_on_terminate()
+      {
+         if( async_log_writer* w = current_log_writer().load( std::memory_order_acquire ) )
+            w->flush_before_exit();
+         force_flush_appenders();
+         if( previous_terminate_handler )
+            previous_terminate_handler();
+         std::abort();
+      }
+
+      void flush_at_exit()
+      {
+         if( async_log_writer* w = current_log_writer().load( std::memory_order_acquire ) )
+            w->flush_before_exit();
+         force_flush_appenders();
+      }
+
+      void install_flush_hooks()
+      {
+         static const bool installed = [](){
+            // the appenders must outlive the exit hook, so they are constructed before it is registered
+            get_appender_map();
+            previous_terminate_handler = std::set_terminate( &flush_on_terminate );
+            std::atexit( &flush_at_exit );
+            return true;
+         }();
+         (void)installed;
+      }
+
+      void configure_async_logging( const async_logging_config& cfg )
+      {
+         // writers are stopped but never deleted: a producer may still be inside push()
+         if( async_log_writer* old = current_log_writer().exchange( nullptr ) )
+            old->stop();
+         if( !cfg.enabled )
+            return;
+
+         install_flush_hooks();
+         current_log_writer().store( new async_log_writer( cfg ), std::memory_order_release );
+      }
+   } // namespace detail
+
+   bool appender::in_batch()
+   {
+      return detail::in_log_batch();
+   }
+
+   void flush_logging()
+   {
+      if( detail::async_log_writer* w = detail::current_log_writer().load( std::memory_order_acquire ) )
+         w->flush();
+      detail::force_flush_appenders();
+   }
+
+} // namespace fc
@@ -116,8 +116,7 @@ namespace fc {
          line << std::setw( 20 ) << std::left << m.get_context().get_method().substr(p,20).c_str() <<" ";
       }
       line << "] ";
-      fc::string message = fc::format_string( m.get_format(), m.get_data() );
-      line << message;//.c_str();
+      line << format_message( m );
 
       fc::unique_lock<boost::mutex> lock(log_mutex());
 
@@ -1,3 +1,4 @@
+#include <fc/compress/zlib.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/io/fstream.hpp>
 #include <fc/log/file_appender.hpp>
@@ -9,18 +10,31 @@
 #include <iomanip>
 #include <queue>
 #include <sstream>
+#include <vector>
 
 namespace fc {
 
+   namespace detail {
+      fc::thread& log_maintenance_thread();
+      void install_flush_hooks();
+   }
+   using detail::log_maintenance_thread;
+
+   /** compresses rotated files, so a long compression holds up neither flushing nor the log limiters */
+   static fc::thread& log_compression_thread() { static fc::thread t("log_compression"); return t; }
+
    class file_appender::impl : public fc::retainable
    {
       public:
          config                     cfg;
          ofstream                   out;
          boost::mutex               slock;
+         string                     pending;  ///< messages not yet written to out
 
       private:
          future<void>               _rotation_task;
+         future<void>               _flush_task;
+         future<void>               _compress_task;
          time_point_sec             _current_file_start_time;
 
          time_point_sec get_file_start_time( const time_point_sec& timestamp, const microseconds& interval )
@@ -41,8 +55,12 @@ namespace fc {
 
 
 
-                 _rotation_task = async( [this]() { rotate_files( true ); }, "rotate_files(1)" );
+                 _rotation_task = log_maintenance_thread().async( [this]() { rotate_files( true ); }, "rotate_files(1)" );
              }
+             if( !cfg.flush )
+                 detail::install_flush_hooks();
+             if( !cfg.flush && cfg.flush_interval > microseconds() )
+                 _flush_task = log_maintenance_thread().async( [this]() { flush_loop(); }, "file_appender flush" );
          }
 
          ~impl()
@@ -54,6 +72,58 @@ namespace fc {
             catch( ... )
             {
             }
+            try
+            {
+              _flush_task.cancel_and_wait("file_appender is destructing");
+            }
+            catch( ... )
+            {
+            }
+            try
+            {
+              _compress_task.cancel_and_wait("file_appender is destructing");
+            }
+            catch( ... )
+            {
+            }
+            write_pending();
+         }
+
+         /** writes out the buffered messages, the caller holds slock unless the appender is going away */
+         void write_pending()
+         {
+            if( pending.empty() )
+               return;
+            out.write( pending.data(), pending.size() );
+            out.flush();
+            pending.clear();
+         }
+
+         /** runs on the log maintenance thread until ~impl cancels it, which wakes the sleep */
+         void flush_loop()
+         {
+            for( ;; )
+            {
+               fc::usleep( cfg.flush_interval );
+               fc::scoped_lock<boost::mutex> lock( slock );
+               write_pending();
+            }
+         }
+
+         /** replaces each file by <file>.zlib, a file that fails is left as it is */
+         static void compress_files( const std::vector<fc::path>& files )
+         {
+             for( const fc::path& f : files )
+             {
+                 try
+                 {
+                     zlib_compress_file( f, f.string() + ".zlib" );
+                     remove_all( f );
+                 }
+                 catch( ... )
+                 {
+                 }
+             }
          }
 
          void rotate_files( bool initializing = false )
@@ -72,13 +142,13 @@ namespace fc {
                {
                    if( start_time <= _current_file_start_time )
                    {
-                       _rotation_task = schedule( [this]() { rotate_files(); },
+                       _rotation_task = log_maintenance_thread().schedule( [this]() { rotate_files(); },
                                                   _current_file_start_time + cfg.rotation_interval.to_seconds(),
                                                   "rotate_files(2)" );
                        return;
                    }
 
-                   out.flush();
+                   write_pending();
                    out.close();
                }
                remove_all(link_filename);  // on windows, you can't delete the link while the underlying file is opened for writing
@@ -92,6 +162,9 @@ namespace fc {
 
              /* Delete old log files */
              fc::time_point limit_time = now - cfg.rotation_limit;
+             // files left uncompressed while a compression is still running are picked up by the next rotation
+             const bool compress = cfg.compress && ( !_compress_task.valid() || _compress_task.ready() );
+             std::vector<fc::path> to_compress;
              string link_filename_string = link_filename.filename().string();
              directory_iterator itr(link_filename.parent_path());
              for( ; itr != directory_iterator(); itr++ )
@@ -107,11 +180,13 @@ namespace fc {
                      fc::time_point_sec current_timestamp = fc::time_point_sec::from_iso_string( current_timestamp_str );
                      if( current_timestamp < start_time )
                      {
-                         if( current_timestamp < limit_time || file_size( current_filename ) <= 0 )
+                         if( current_timestamp < limit_time || file_size( *itr ) <= 0 )
                          {
                              remove_all( *itr );
                              continue;
                          }
+                         if( compress && itr->extension() != ".zlib" )
+                             to_compress.push_back( *itr );
                      }
                  }
                  catch (const fc::canceled_exception&)
@@ -123,8 +198,12 @@ namespace fc {
                  }
              }
 
+             if( !to_compress.empty() )
+                 _compress_task = log_compression_thread().async( [to_compress]() { compress_files( to_compress ); },
+                                                                  "compress_files" );
+
              _current_file_start_time = start_time;
-             _rotation_task = schedule( [this]() { rotate_files(); },
+             _rotation_task = log_maintenance_thread().schedule( [this]() { rotate_files(); },
                                         _current_file_start_time + cfg.rotation_interval.to_seconds(),
                                         "rotate_files(3)" );
          }
@@ -180,19 +259,33 @@ namespace fc {
       }
 
       line << "] ";
-      fc::string message = fc::format_string( m.get_format(), m.get_data() );
-      line << message.c_str();
+      line << format_message( m ).c_str();
 
       //fc::variant lmsg(m);
 
       // fc::string fmt_str = fc::format_string( my->cfg.format, mutable_variant_object(m.get_context())( "message", message)  );
 
       {
+        line << "\t\t\t" << m.get_context().get_file() << ":" << m.get_context().get_line_number() << "\n";
         fc::scoped_lock<boost::mutex> lock( my->slock );
-        my->out << line.str() << "\t\t\t" << m.get_context().get_file() << ":" << m.get_context().get_line_number() << "\n";
-        if( my->cfg.flush )
-          my->out.flush();
+        my->pending += line.str();
+        if( ( my->cfg.flush && !in_batch() ) || m.get_context().get_log_level() >= log_level::error ||
+            my->pending.size() >= my->cfg.flush_size )
+          my->write_pending();
       }
    }
 
+   void file_appender::flush()
+   {
+      fc::scoped_lock<boost::mutex> lock( my->slock );
+      if( my->cfg.flush )
+         my->write_pending();
+   }
+
+   void file_appender::force_flush()
+   {
+      fc::scoped_lock<boost::mutex> lock( my->slock );
+      my->write_pending();
+   }
+
 } // fc
@@ -33,9 +33,10 @@ namespace fc
             :context( std::move(ctx) ){}
             log_message_impl(){}
 
-            log_context     context;
-            string          format;
-            variant_object  args;
+            log_context            context;
+            string                 format;   ///< unused if tpl is set
+            const format_template* tpl = nullptr;
+            variant_object         args;
       };
    }
 
@@ -58,6 +59,19 @@ namespace fc
       my->task_name   = current_task_desc ? current_task_desc : "?unnamed?";
    }
 
+   log_context::log_context( log_level ll, string file, uint64_t line, const char* method,
+                             time_point timestamp, string thread_name, string task_name )
+   :my( std::make_shared<detail::log_context_impl>() )
+   {
+      my->level       = ll;
+      my->file        = std::move(file);
+      my->line        = line;
+      my->method      = method;
+      my->timestamp   = timestamp;
+      my->thread_name = std::move(thread_name);
+      my->task_name   = std::move(task_name);
+   }
+
    log_context::log_context( const variant& v )
    :my( std::make_shared<detail::log_context_impl>() )
    {
@@ -191,6 +205,16 @@ namespace fc
       my->args    = std::move(args);
    }
 
+   log_message::log_message( log_context ctx, const format_template* tpl, const char* format, variant_object args )
+   :my( std::make_shared<detail::log_message_impl>(std::move(ctx)) )
+   {
+      if( tpl )
+         my->tpl = tpl;
+      else
+         my->format = format;
+      my->args = std::move(args);
+   }
+
    log_message::log_message( const variant& v )
    :my( std::make_shared<detail::log_message_impl>( log_context( v.get_object()["context"] ) ) )
    {
@@ -201,19 +225,29 @@ namespace fc
    variant log_message::to_variant()const
    {
       return mutable_variant_object( "context", my->context )
-                          ( "format",  my->format )
+                          ( "format",  get_format() )
                           ( "data",    my->args   );
    }
 
    log_context          log_message::get_context()const { return my->context; }
-   string              log_message::get_format()const  { return my->format;  }
+   string              log_message::get_format()const  { return my->tpl ? my->tpl->get_format() : my->format; }
    variant_object log_message::get_data()const    { return my->args;    }
 
    string        log_message::get_message()const
    {
+      if( my->tpl )
+         return my->tpl->format( my->args );
       return format_string( my->format, my->args );
    }
 
+   void          log_message::format_message( string& out )const
+   {
+      if( my->tpl )
+         my->tpl->format( my->args, out );
+      else
+         format_string( my->format.data(), my->format.size(), my->args, out );
+   }
+
 
 } // fc
 
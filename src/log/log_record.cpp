@@ -0,0 +1,158 @@
+#include <fc/log/log_record.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/filesystem.hpp>
+
+namespace fc
+{
+   log_site::log_site( log_level level, const char* file, uint64_t line, const char* method )
+   :level(level),file( fc::path(file).filename().generic_string() ),line(line),method(method){}
+
+   log_record::log_record( const log_record& r )
+   :_site(r._site),_tpl(r._tpl),_timestamp(r._timestamp),_size(0)
+   {
+      put( r.data(), r._size );
+   }
+
+   log_record& log_record::operator=( const log_record& r )
+   {
+      if( this != &r )
+      {
+         _site      = r._site;
+         _tpl       = r._tpl;
+         _timestamp = r._timestamp;
+         _size      = 0;
+         _heap.clear();
+         put( r.data(), r._size );
+      }
+      return *this;
+   }
+
+   void log_record::capture( const char* format, size_t len )
+   {
+      _timestamp = time_point::now();
+      thread& t = fc::thread::current();
+      const string& thread_name = t.name();
+      put_string( thread_name.data(), thread_name.size() );
+      const char* task = t.current_task_desc();
+      if( task == nullptr )
+         task = "?unnamed?";
+      put_string( task, strlen(task) );
+      put_string( format, len );
+   }
+
+   char* log_record::grow( size_t n )
+   {
+      if( _heap.empty() )
+      {
+         _heap.reserve( 2 * ( _size + n ) );
+         _heap.assign( _inline, _inline + _size );
+      }
+      _heap.resize( _size + n );
+      return _heap.data() + _size;
+   }
+
+   void log_record::put_variant( const char* key, size_t len, const variant& v )
+   {
+      put_key( key, len, variant_tag );
+      const size_t packed = fc::raw::pack_size( v );
+      const uint32_t l = packed;
+      put( &l, sizeof(l) );
+      char* p = _size + packed <= inline_capacity && _heap.empty() ? _inline + _size : grow( packed );
+      datastream<char*> ds( p, packed );
+      fc::raw::pack( ds, v );
+      _size += packed;
+   }
+
+   log_record& log_record::operator()( const variant_object& args )
+   {
+      for( const variant_object::entry& e : args )
+      {
+         const string& k = e.key();
+         put_variant( k.c_str(), k.size(), e.value() );
+      }
+      return *this;
+   }
+
+   namespace
+   {
+      struct record_reader
+      {
+         record_reader( const char* d, size_t size ):pos(d),end(d + size){}
+
+         template<typename T>
+         T get()
+         {
+            FC_ASSERT( size_t(end - pos) >= sizeof(T), "truncated log record" );
+            T v;
+            memcpy( &v, pos, sizeof(T) );
+            pos += sizeof(T);
+            return v;
+         }
+         const char* get_bytes( size_t n )
+         {
+            FC_ASSERT( size_t(end - pos) >= n, "truncated log record" );
+            const char* p = pos;
+            pos += n;
+            return p;
+         }
+         string get_string()
+         {
+            const uint32_t len = get<uint32_t>();
+            return string( get_bytes( len ), len );
+         }
+
+         const char* pos;
+         const char* end;
+      };
+   }
+
+   log_message log_record::to_log_message()const
+   {
+      FC_ASSERT( _site != nullptr );
+      record_reader r( data(), _size );
+      string thread_name = r.get_string();
+      string task_name   = r.get_string();
+      string format      = r.get_string();
+
+      mutable_variant_object args;
+      while( r.pos != r.end )
+      {
+         string key = r.get_string();
+         switch( r.get<char>() )
+         {
+            case int64_tag:
+               args( fc::move(key), r.get<int64_t>() );
+               break;
+            case uint64_tag:
+               args( fc::move(key), r.get<uint64_t>() );
+               break;
+            case double_tag:
+               args( fc::move(key), r.get<double>() );
+               break;
+            case bool_tag:
+               args( fc::move(key), r.get<char>() != 0 );
+               break;
+            case string_tag:
+               args( fc::move(key), r.get_string() );
+               break;
+            case variant_tag:
+            {
+               const uint32_t len = r.get<uint32_t>();
+               datastream<const char*> ds( r.get_bytes( len ), len );
+               variant v;
+               fc::raw::unpack( ds, v );
+               args( fc::move(key), fc::move(v) );
+               break;
+            }
+            default:
+               FC_THROW_EXCEPTION( assert_exception, "corrupt log record" );
+         }
+      }
+
+      log_context ctx( _site->level, _site->file, _site->line, _site->method,
+                       _timestamp, fc::move(thread_name), fc::move(task_name) );
+      return log_message( fc::move(ctx), _tpl, format.c_str(), fc::move(args) );
+   }
+
+} // namespace fc
@@ -6,6 +6,7 @@
 #include <fc/log/appender.hpp>
 #include <fc/filesystem.hpp>
 #include <unordered_map>
+#include <vector>
 #include <string>
 #include <fc/log/logger_config.hpp>
 
@@ -61,14 +62,32 @@ namespace fc {
        return e >= my->_level;
     }
 
+    namespace detail
+    {
+       bool async_log( const logger& l, log_message& m );
+       bool async_log( const logger& l, const log_record& r );
+    }
+
     void logger::log( log_message m ) {
+       if( !detail::async_log( *this, m ) )
+          dispatch( m );
+    }
+
+    void logger::log( const log_record& r ) {
+       if( !detail::async_log( *this, r ) ) {
+          log_message m = r.to_log_message();
+          dispatch( m );
+       }
+    }
+
+    void logger::dispatch( log_message& m ) {
        m.get_context().append_context( my->_name );
 
        for( auto itr = my->_appenders.begin(); itr != my->_appenders.end(); ++itr )
           (*itr)->log( m );
 
        if( my->_additivity && my->_parent != nullptr) {
-          my->_parent.log(m);
+          my->_parent.dispatch(m);
        }
     }
     void logger::set_name( const fc::string& n ) { my->_name = n; }
@@ -90,6 +109,84 @@ namespace fc {
        return get_logger_map()[s];
     }
 
+    namespace detail
+    {
+       std::atomic<uint32_t> logging_generation( 1 );
+       std::atomic<uint32_t> log_limiter_tick( 0 );
+
+       /** runs logging housekeeping such as log file rotation, off the logging path */
+       fc::thread& log_maintenance_thread() { static fc::thread t("log_maintenance"); return t; }
+
+       fc::spin_lock& log_limiters_lock() { static fc::spin_lock l; return l; }
+       std::vector<log_limiter*>& log_limiters() { static std::vector<log_limiter*>* l = new std::vector<log_limiter*>(); return *l; }
+
+       void tick_log_limiters()
+       {
+          log_limiter_tick.fetch_add( 1, std::memory_order_relaxed );
+          std::vector<log_limiter*> limiters;
+          {
+             scoped_lock<spin_lock> lock( log_limiters_lock() );
+             limiters = log_limiters();
+          }
+          for( log_limiter* l : limiters )
+          {
+             try
+             {
+                l->report_suppressed();
+             }
+             catch( ... )
+             {
+             }
+          }
+       }
+
+       /** ticks the limiters once a second on the log maintenance thread */
+       void schedule_log_limiter_tick()
+       {
+          log_maintenance_thread().schedule( [](){ tick_log_limiters(); schedule_log_limiter_tick(); },
+                                             time_point::now() + fc::seconds( 1 ), "tick_log_limiters" );
+       }
+    }
+
+    void cached_logger::refresh() {
+       static fc::spin_lock refresh_spinlock;
+       scoped_lock<spin_lock> lock(refresh_spinlock);
+       const uint32_t generation = detail::logging_generation.load( std::memory_order_acquire );
+       if( _generation.load( std::memory_order_relaxed ) == generation )
+          return;
+       const logger* replaced = _current.exchange( new logger( logger::get( _name ) ), std::memory_order_acq_rel );
+       delete _retired;
+       _retired = replaced;
+       _generation.store( generation, std::memory_order_release );
+    }
+
+    log_limiter::log_limiter( cached_logger& lgr, const log_site& site, string format )
+    :_logger(lgr),_site(site),_format( fc::move(format) ),_calls(0),_tick(0),_in_tick(0),_suppressed(0)
+    {
+       bool first;
+       {
+          scoped_lock<spin_lock> lock( detail::log_limiters_lock() );
+          first = detail::log_limiters().empty();
+          detail::log_limiters().push_back( this );
+       }
+       if( first )
+          detail::schedule_log_limiter_tick();
+    }
+
+    void log_limiter::report_suppressed()
+    {
+       const uint64_t suppressed = _suppressed.exchange( 0, std::memory_order_relaxed );
+       if( suppressed == 0 )
+          return;
+       logger l = _logger.get();
+       if( !l.is_enabled( _site.level ) )
+          return;
+       log_context ctx( _site.level, _site.file, _site.line, _site.method, time_point::now(),
+                        fc::thread::current().name(), "tick_log_limiters" );
+       l.log( log_message( fc::move(ctx), "suppressed ${n} more messages like \"${format}\"",
+                           fc::mutable_variant_object()( "n", suppressed )( "format", _format ) ) );
+    }
+
     logger  logger::get_parent()const { return my->_parent; }
     logger& logger::set_parent(const logger& p) { my->_parent = p; return *this; }
 
@@ -13,6 +13,7 @@
 namespace fc {
    extern std::unordered_map<std::string,logger>& get_logger_map();
    extern std::unordered_map<std::string,appender::ptr>& get_appender_map();
+   namespace detail { void configure_async_logging( const async_logging_config& cfg ); }
    logger_config& logger_config::add_appender( const string& s ) { appenders.push_back(s); return *this; }
 
    void configure_logging( const fc::path& lc )
@@ -24,6 +25,8 @@ namespace fc {
       try {
       static bool reg_console_appender = appender::register_appender<console_appender>( "console" );
       static bool reg_file_appender = appender::register_appender<file_appender>( "file" );
+      // drain the queue into the old appenders before replacing them
+      detail::configure_async_logging( async_logging_config() );
       get_logger_map().clear();
       get_appender_map().clear();
 
@@ -48,6 +51,8 @@ namespace fc {
             if( ap ) { lgr.add_appender(ap); }
          }
       }
+      detail::configure_async_logging( cfg.async );
+      detail::logging_generation.fetch_add( 1, std::memory_order_release );
       return reg_console_appender || reg_file_appender;
       } catch ( exception& e )
       {
@@ -120,7 +120,7 @@ namespace fc { namespace http {
         } 
         catch ( fc::exception& e ) 
         {
-          wlog( "unable to read request ${1}", ("1", e.to_detail_string() ) );//fc::except_str().c_str());
+          wlog_rate( 10, "unable to read request ${1}", ("1", e.to_detail_string() ) );//fc::except_str().c_str());
         }
         //wlog( "done handle connection" );
       }
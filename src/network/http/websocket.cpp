@@ -181,7 +181,7 @@ namespace fc { namespace http {
             {
 
                _server.clear_access_channels( websocketpp::log::alevel::all );
-               _server.init_asio(&fc::asio::default_io_service());
+               _server.init_asio(&fc::asio::next_io_service());
                _server.set_reuse_addr(true);
                _server.set_open_handler( [&]( connection_hdl hdl ){
                     _server_thread.async( [&](){
@@ -219,7 +219,7 @@ namespace fc { namespace http {
                        std::string request_body = con->get_request_body();
                        wdump(("server")(request_body));
 
-                       fc::async([current_con, request_body, con] {
+                       fc::post([current_con, request_body, con] {
                           std::string response = current_con->on_http(request_body);
                           con->set_body( response );
                           con->set_status( websocketpp::http::status_code::ok );
@@ -315,7 +315,7 @@ namespace fc { namespace http {
                }
 
                _server.clear_access_channels( websocketpp::log::alevel::all );
-               _server.init_asio(&fc::asio::default_io_service());
+               _server.init_asio(&fc::asio::next_io_service());
                _server.set_reuse_addr(true);
                _server.set_open_handler( [&]( connection_hdl hdl ){
                     _server_thread.async( [&](){
@@ -446,7 +446,7 @@ namespace fc { namespace http {
                        _closed->set_value();
                 });
 
-                _client.init_asio( &fc::asio::default_io_service() );
+                _client.init_asio( &fc::asio::next_io_service() );
             }
             ~websocket_client_impl()
             {
@@ -547,7 +547,7 @@ namespace fc { namespace http {
                    return ctx;
                 });
 
-                _client.init_asio( &fc::asio::default_io_service() );
+                _client.init_asio( &fc::asio::next_io_service() );
             }
             ~websocket_tls_client_impl()
             {
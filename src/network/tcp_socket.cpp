@@ -21,7 +21,7 @@ namespace fc {
   class tcp_socket::impl : public tcp_socket_io_hooks {
     public:
       impl() :
-        _sock(fc::asio::default_io_service()),
+        _sock(fc::asio::current_io_service()),
         _io_hooks(this)
       {}
       ~impl()
@@ -240,7 +240,7 @@ namespace fc {
   class tcp_server::impl {
     public:
       impl()
-      :_accept( fc::asio::default_io_service() )
+      :_accept( fc::asio::current_io_service() )
       {
         _accept.open(boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 0).protocol());
       }
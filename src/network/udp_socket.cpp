@@ -8,7 +8,7 @@ namespace fc {
   
   class udp_socket::impl : public fc::retainable {
     public:
-      impl():_sock( fc::asio::default_io_service() ){}
+      impl():_sock( fc::asio::current_io_service() ){}
       ~impl(){
       //  _sock.cancel();
       }
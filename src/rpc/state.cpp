@@ -13,13 +13,25 @@ void state::add_method( const fc::string& name, method m )
    _methods.emplace(std::pair<std::string,method>(name,fc::move(m)));
 }
 
+void state::add_lazy_method( const fc::string& name, lazy_method m )
+{
+   _lazy_methods.emplace(std::pair<std::string,lazy_method>(name,fc::move(m)));
+}
+
 void state::remove_method( const fc::string& name )
 {
    _methods.erase(name);
+   _lazy_methods.erase(name);
 }
 
 variant state::local_call( const string& method_name, const variants& args )
 {
+   auto lazy_itr = _lazy_methods.find(method_name);
+   if( lazy_itr != _lazy_methods.end() )
+   {
+      const variant arg_array( args );
+      return lazy_itr->second( json_value( arg_array ) );
+   }
    auto method_itr = _methods.find(method_name);
    if( method_itr == _methods.end() && _unhandled )
       return _unhandled( method_name, args );
@@ -27,6 +39,18 @@ variant state::local_call( const string& method_name, const variants& args )
    return method_itr->second(args);
 }
 
+variant state::local_call( const string& method_name, const json_value& args )
+{
+   auto lazy_itr = _lazy_methods.find(method_name);
+   if( lazy_itr != _lazy_methods.end() )
+      return lazy_itr->second( args );
+   auto method_itr = _methods.find(method_name);
+   if( method_itr == _methods.end() && _unhandled )
+      return _unhandled( method_name, args.is_null() ? variants() : args.as_variants() );
+   FC_ASSERT( method_itr != _methods.end(), "Unknown Method: ${name}", ("name",method_name) );
+   return method_itr->second( args.is_null() ? variants() : args.as_variants() );
+}
+
 void  state::handle_reply( const response& response )
 {
    auto await = _awaiting.find( response.id );
@@ -10,14 +10,14 @@ websocket_api_connection::~websocket_api_connection()
 websocket_api_connection::websocket_api_connection( fc::http::websocket_connection& c )
    : _connection(c)
 {
-   _rpc_state.add_method( "call", [this]( const variants& args ) -> variant
+   _rpc_state.add_lazy_method( "call", [this]( const json_value& args ) -> variant
    {
-      FC_ASSERT( args.size() == 3 && args[2].is_array() );
+      FC_ASSERT( args.is_array() && args.size() == 3 && args[2].is_array() );
       api_id_type api_id;
       if( args[0].is_string() )
       {
          variants subargs;
-         subargs.push_back( args[0] );
+         subargs.push_back( args[0].as_variant() );
          variant subresult = this->receive_call( 1, "get_api_by_name", subargs );
          api_id = subresult.as_uint64();
       }
@@ -27,7 +27,7 @@ websocket_api_connection::websocket_api_connection( fc::http::websocket_connecti
       return this->receive_call(
          api_id,
          args[1].as_string(),
-         args[2].get_array() );
+         args[2] );
    } );
 
    _rpc_state.add_method( "notice", [this]( const variants& args ) -> variant
@@ -88,9 +88,10 @@ std::string websocket_api_connection::on_message(
    wdump((message));
    try
    {
-      auto var = fc::json::from_string(message);
-      const auto& var_obj = var.get_object();
-      if( var_obj.contains( "method" ) )
+      auto doc = fc::json_document::from_string(message);
+      const auto root = doc.root();
+      FC_ASSERT( root.is_object(), "Expected a JSON object" );
+      if( root.contains( "method" ) )
       {
           //TODO: need to convert to consensus version, since it's a temp workaround.
           string block_message = check_blacklist(message);
@@ -99,7 +100,12 @@ std::string websocket_api_connection::on_message(
             return block_message;
           }              
 
-         auto call = var.as<fc::rpc::request>();
+         // only the envelope is decoded here, params stay in the document until a method needs them
+         const bool     has_call_id = !root.find( "id" ).is_null();
+         const uint64_t call_id     = has_call_id ? root["id"].as_uint64() : 0;
+         const string call_method = root["method"].as_string();
+         const json_value call_params = root.find( "params" );
+
          exception_ptr optexcept;
          try
          {
@@ -109,37 +115,37 @@ std::string websocket_api_connection::on_message(
                auto start = time_point::now();
 #endif
 
-               auto result = _rpc_state.local_call( call.method, call.params );
+               auto result = _rpc_state.local_call( call_method, call_params );
 
 #ifdef LOG_LONG_API
                auto end = time_point::now();
 
                if( end - start > fc::milliseconds( LOG_LONG_API_MAX_MS ) )
-                  elog( "API call execution time limit exceeded. method: ${m} params: ${p} time: ${t}", ("m",call.method)("p",call.params)("t", end - start) );
+                  elog( "API call execution time limit exceeded. method: ${m} params: ${p} time: ${t}", ("m",call_method)("p",call_params)("t", end - start) );
                else if( end - start > fc::milliseconds( LOG_LONG_API_WARN_MS ) )
-                  wlog( "API call execution time nearing limit. method: ${m} params: ${p} time: ${t}", ("m",call.method)("p",call.params)("t", end - start) );
+                  wlog( "API call execution time nearing limit. method: ${m} params: ${p} time: ${t}", ("m",call_method)("p",call_params)("t", end - start) );
 #endif
 
-               if( call.id )
+               if( has_call_id )
                {
-                  auto reply = fc::json::to_string( response( *call.id, result ) );
+                  auto reply = fc::json::to_string( response( call_id, result ) );
                   if( send_message )
                      _connection.send_message( reply );
                   return reply;
                }
             }
-            FC_CAPTURE_AND_RETHROW( (call.method)(call.params) )
+            FC_CAPTURE_AND_RETHROW( (call_method)(call_params) )
          }
          catch ( const fc::exception& e )
          {
-            if( call.id )
+            if( has_call_id )
             {
                optexcept = e.dynamic_copy_exception();
             }
          }
          if( optexcept ) {
 
-               auto reply = fc::json::to_string( response( *call.id,  error_object{ 1, optexcept->to_detail_string(), fc::variant(*optexcept)}  ) );
+               auto reply = fc::json::to_string( response( call_id,  error_object{ 1, optexcept->to_detail_string(), fc::variant(*optexcept)}  ) );
                if( send_message )
                   _connection.send_message( reply );
 
@@ -148,7 +154,7 @@ std::string websocket_api_connection::on_message(
       }
       else
       {
-         auto reply = var.as<fc::rpc::response>();
+         auto reply = root.as<fc::rpc::response>();
          _rpc_state.handle_reply( reply );
       }
    }
@@ -18,8 +18,15 @@ namespace fc {
   }
 
   void retainable::release() {
+    boost::atomic<int32_t>* count = (boost::atomic<int32_t>*)&_ref_count;
+    // nobody else can retain the last reference, so releasing it needs no read-modify-write
+    if( count->load( boost::memory_order_acquire ) == 1 ) {
+        count->store( 0, boost::memory_order_relaxed );
+        delete this;
+        return;
+    }
+    if( 1 == count->fetch_sub(1, boost::memory_order_release ) ) {
         boost::atomic_thread_fence(boost::memory_order_acquire);
-    if( 1 == ((boost::atomic<int32_t>*)&_ref_count)->fetch_sub(1, boost::memory_order_release ) ) {
         delete this;
     }
   }
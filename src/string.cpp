@@ -90,42 +90,57 @@ namespace fc  {
 
 
   int64_t    to_int64( const fc::string& i )
+  {
+    return to_int64( i.c_str(), i.size() );
+  }
+
+  uint64_t   to_uint64( const fc::string& i )
+  { try {
+    return to_uint64( i.c_str(), i.size() );
+  } FC_CAPTURE_AND_RETHROW( (i) ) }
+
+  double     to_double( const fc::string& i)
+  {
+    return to_double( i.c_str(), i.size() );
+  }
+
+  int64_t    to_int64( const char* s, size_t len )
   {
     try
     {
-      return boost::lexical_cast<int64_t>(i.c_str());
+      return boost::lexical_cast<int64_t>( s, len );
     }
     catch( const boost::bad_lexical_cast& e )
     {
       FC_THROW_EXCEPTION( parse_error_exception, "Couldn't parse int64_t" );
     }
-    FC_RETHROW_EXCEPTIONS( warn, "${i} => int64_t", ("i",i) )
+    FC_RETHROW_EXCEPTIONS( warn, "${i} => int64_t", ("i",fc::string( s, len )) )
   }
 
-  uint64_t   to_uint64( const fc::string& i )
-  { try {
+  uint64_t   to_uint64( const char* s, size_t len )
+  {
     try
     {
-      return boost::lexical_cast<uint64_t>(i.c_str());
+      return boost::lexical_cast<uint64_t>( s, len );
     }
     catch( const boost::bad_lexical_cast& e )
     {
       FC_THROW_EXCEPTION( parse_error_exception, "Couldn't parse uint64_t" );
     }
-    FC_RETHROW_EXCEPTIONS( warn, "${i} => uint64_t", ("i",i) )
-  } FC_CAPTURE_AND_RETHROW( (i) ) }
+    FC_RETHROW_EXCEPTIONS( warn, "${i} => uint64_t", ("i",fc::string( s, len )) )
+  }
 
-  double     to_double( const fc::string& i)
+  double     to_double( const char* s, size_t len )
   {
     try
     {
-      return boost::lexical_cast<double>(i.c_str());
+      return boost::lexical_cast<double>( s, len );
     }
     catch( const boost::bad_lexical_cast& e )
     {
       FC_THROW_EXCEPTION( parse_error_exception, "Couldn't parse double" );
     }
-    FC_RETHROW_EXCEPTIONS( warn, "${i} => double", ("i",i) )
+    FC_RETHROW_EXCEPTIONS( warn, "${i} => double", ("i",fc::string( s, len )) )
   }
 
   fc::string to_string(double d)
@@ -0,0 +1,153 @@
+#include <fc/thread/channel.hpp>
+#include <fc/thread/scoped_lock.hpp>
+#include <algorithm>
+
+namespace fc
+{
+   namespace detail
+   {
+      bool channel_waiter::wait_until( const time_point& deadline )
+      {
+         try
+         {
+            _prom->wait_until( deadline );
+            return true;
+         }
+         catch( const timeout_exception& )
+         {
+            return false;
+         }
+      }
+
+      channel_base::channel_base()
+      :_waiting_receivers(0),_waiting_senders(0),_closed(false)
+      {
+         _receivers.count = &_waiting_receivers;
+         _senders.count   = &_waiting_senders;
+      }
+
+      void channel_base::close()
+      {
+         _closed.store( true, std::memory_order_release );
+         std::atomic_thread_fence( std::memory_order_seq_cst );
+         wake( _receivers, size_t(-1) );
+         wake( _senders, size_t(-1) );
+      }
+
+      void channel_base::add( waiter_list& list, const channel_waiter_ptr& w )
+      {
+         fc::scoped_lock<spin_lock> lock( _lock );
+         list.waiters.push_back( w );
+         list.count->fetch_add( 1, std::memory_order_seq_cst );
+      }
+
+      void channel_base::remove( waiter_list& list, const channel_waiter_ptr& w )
+      {
+         fc::scoped_lock<spin_lock> lock( _lock );
+         auto itr = std::find( list.waiters.begin(), list.waiters.end(), w );
+         if( itr != list.waiters.end() )
+         {
+            list.waiters.erase( itr );
+            list.count->fetch_sub( 1, std::memory_order_relaxed );
+         }
+      }
+
+      void channel_base::wake( waiter_list& list, size_t n )
+      {
+         while( n )
+         {
+            channel_waiter_ptr w;
+            {
+               fc::scoped_lock<spin_lock> lock( _lock );
+               if( list.waiters.empty() )
+                  return;
+               w = std::move( list.waiters.front() );
+               list.waiters.pop_front();
+               list.count->fetch_sub( 1, std::memory_order_relaxed );
+            }
+            // a waiter that select() woke through another channel does not count
+            if( w->wake() )
+               --n;
+         }
+      }
+
+      bool channel_base::wait( waiter_list& list, bool (channel_base::*ready)()const, const time_point& deadline )
+      {
+         channel_waiter_ptr w = std::make_shared<channel_waiter>();
+         add( list, w );
+         // registered first and checked after, so a send or receive in between wakes us
+         bool woken = (this->*ready)();
+         try
+         {
+            if( !woken )
+               woken = w->wait_until( deadline );
+         }
+         catch( ... )
+         {
+            remove( list, w );
+            if( !w->wake() && (this->*ready)() )
+               wake( list, 1 ); // pass on the wakeup this fiber will not act on
+            throw;
+         }
+         remove( list, w );
+         if( !w->wake() )
+            woken = true; // possibly just as the wait timed out
+         return woken;
+      }
+   } // namespace detail
+
+   int select_until( const std::vector<detail::channel_base*>& channels, const time_point& deadline )
+   {
+      for( ;; )
+      {
+         for( size_t i = 0; i < channels.size(); ++i )
+            if( channels[i]->receivable() )
+               return int(i);
+
+         detail::channel_waiter_ptr w = std::make_shared<detail::channel_waiter>();
+         for( auto c : channels )
+            c->add( c->_receivers, w );
+
+         bool registered_ready = false;
+         for( auto c : channels )
+            registered_ready = registered_ready || c->receivable();
+
+         bool timed_out = false;
+         try
+         {
+            if( !registered_ready )
+               timed_out = !w->wait_until( deadline );
+         }
+         catch( ... )
+         {
+            for( auto c : channels )
+               c->remove( c->_receivers, w );
+            if( !w->wake() )
+               for( auto c : channels )
+                  if( c->receivable() )
+                     c->wake( c->_receivers, 1 );
+            throw;
+         }
+
+         for( auto c : channels )
+            c->remove( c->_receivers, w );
+
+         int ready = -1;
+         for( size_t i = 0; i < channels.size() && ready < 0; ++i )
+            if( channels[i]->receivable() )
+               ready = int(i);
+
+         // the caller receives from one channel, let a wakeup from any other reach someone else
+         if( !w->wake() )
+            for( size_t i = 0; i < channels.size(); ++i )
+               if( int(i) != ready && channels[i]->receivable() )
+                  channels[i]->wake( channels[i]->_receivers, 1 );
+
+         if( ready >= 0 )
+            return ready;
+         if( timed_out )
+            return -1;
+      }
+   }
+
+} // namespace fc
@@ -3,6 +3,7 @@
 #include <boost/context/all.hpp>
 #include <fc/exception/exception.hpp>
 #include <vector>
+#include <limits>
 
 #include <iostream>
 
@@ -10,16 +11,11 @@
 
 #if BOOST_VERSION >= 105400
 # include <boost/coroutine/stack_context.hpp>
+# include <boost/assert.hpp>
+# include "stack_pool.hpp"
   namespace bc  = boost::context;
   namespace bco = boost::coroutines;
-# if BOOST_VERSION >= 105600 && !defined(NDEBUG)
-#  include <boost/assert.hpp>
-#  include <boost/coroutine/protected_stack_allocator.hpp>
-  typedef bco::protected_stack_allocator stack_allocator;
-# else
-#  include <boost/coroutine/stack_allocator.hpp>
-  typedef bco::stack_allocator stack_allocator;
-# endif
+  typedef fc::stack_pool stack_allocator;
 
 #elif BOOST_VERSION >= 105300
   #include <boost/coroutine/stack_allocator.hpp>
@@ -55,9 +51,10 @@ namespace fc {
     typedef intptr_t transfer_t;
 #endif
 
-    context( void (*sf)(transfer_t), stack_allocator& alloc, fc::thread* t )
+    context( void (*sf)(transfer_t), stack_allocator& alloc, fc::thread* t, size_t requested_stack_size = FC_CONTEXT_STACK_SIZE )
     : caller_context(0),
       stack_alloc(&alloc),
+      stack_size(FC_CONTEXT_STACK_SIZE),
       next_blocked(0), 
       next_blocked_mutex(0), 
       next(0), 
@@ -70,26 +67,25 @@ namespace fc {
       cur_task(0),
       context_posted_num(0)
     {
+     sleep_timer.data = this;
 #if BOOST_VERSION >= 106100
      //  std::cerr<< "HERE: "<< BOOST_VERSION <<"\n";
      //my_context = new bc::execution_context<intptr_t>( [=]( bc::execution_context<intptr_t> sink, intptr_t self  ){ std::cerr<<"in ex\n"; sf(self);  std::cerr<<"exit ex\n"; return sink; } );
-     size_t stack_size = FC_CONTEXT_STACK_SIZE;
-     alloc.allocate(stack_ctx, stack_size);
+     alloc.allocate(stack_ctx, requested_stack_size);
+     stack_size = stack_ctx.size;
      my_context = bc::detail::make_fcontext( stack_ctx.sp, stack_ctx.size, sf );
 #elif BOOST_VERSION >= 105600
-     size_t stack_size = FC_CONTEXT_STACK_SIZE;
-     alloc.allocate(stack_ctx, stack_size);
+     alloc.allocate(stack_ctx, requested_stack_size);
+     stack_size = stack_ctx.size;
      my_context = bc::make_fcontext( stack_ctx.sp, stack_ctx.size, sf); 
 #elif BOOST_VERSION >= 105400
-     size_t stack_size = FC_CONTEXT_STACK_SIZE;
-     alloc.allocate(stack_ctx, stack_size);
+     alloc.allocate(stack_ctx, requested_stack_size);
+     stack_size = stack_ctx.size;
      my_context = bc::make_fcontext( stack_ctx.sp, stack_ctx.size, sf);
 #elif BOOST_VERSION >= 105300
-     size_t stack_size = FC_CONTEXT_STACK_SIZE;
      void*  stackptr = alloc.allocate(stack_size);
      my_context = bc::make_fcontext( stackptr, stack_size, sf);
 #else
-     size_t stack_size = FC_CONTEXT_STACK_SIZE;
      my_context.fc_stack.base = alloc.allocate( stack_size );
      my_context.fc_stack.limit = static_cast<char*>( my_context.fc_stack.base) - stack_size;
      make_fcontext( &my_context, sf );
@@ -104,6 +100,7 @@ namespace fc {
 #endif
      caller_context(0),
      stack_alloc(0),
+     stack_size(std::numeric_limits<size_t>::max()),
      next_blocked(0), 
      next_blocked_mutex(0), 
      next(0), 
@@ -116,6 +113,7 @@ namespace fc {
      cur_task(0),
      context_posted_num(0)
     {
+     sleep_timer.data = this;
     
 #if BOOST_VERSION >= 106100
        /*
@@ -129,6 +127,8 @@ namespace fc {
     ~context() {
 #if BOOST_VERSION >= 106100
       // delete my_context;
+      if(stack_alloc)
+        stack_alloc->deallocate( stack_ctx );
 #elif BOOST_VERSION >= 105600
       if(stack_alloc)
         stack_alloc->deallocate( stack_ctx );
@@ -244,6 +244,7 @@ namespace fc {
 #endif
     fc::context*                caller_context;
     stack_allocator*            stack_alloc;
+    size_t                       stack_size;  ///< usable stack, unlimited for a thread's own stack
     priority                     prio;
     //promise_base*              prom; 
     std::vector<blocked_promise> blocking_prom;
@@ -260,6 +261,7 @@ namespace fc {
     bool                         complete;
     task_base*                   cur_task;
     uint64_t                     context_posted_num; // serial number set each tiem the context is added to the ready list
+    timer_wheel::node            sleep_timer;        // scheduled in thread_d::sleep_timers while the context sleeps until resume_time
   };
 
 } // naemspace fc 
@@ -1,6 +1,7 @@
 #include <fc/thread/future.hpp>
 #include <fc/thread/spin_yield_lock.hpp>
 #include <fc/thread/thread.hpp>
+#include <fc/thread/thread_specific.hpp>
 #include <fc/thread/unique_lock.hpp>
 #include <fc/exception/exception.hpp>
 
@@ -9,6 +10,158 @@
 
 namespace fc {
 
+  namespace detail
+  {
+     /**
+      *  Blocks freed by promises and tasks on this thread, kept for the next allocation of
+      *  the same size class.  A block may be freed on another thread than the one that
+      *  allocated it, it then simply moves to that thread's list.
+      */
+     class promise_freelist
+     {
+        public:
+           static const size_t block_size  = 64;
+           static const size_t class_count = 16;   ///< larger objects use the global heap
+           static const size_t max_cached  = 256;  ///< per size class
+
+           promise_freelist()
+           {
+              for( size_t i = 0; i < class_count; ++i )
+              {
+                 _heads[i]  = nullptr;
+                 _counts[i] = 0;
+              }
+           }
+           ~promise_freelist()
+           {
+              for( size_t i = 0; i < class_count; ++i )
+              {
+                 while( node* n = _heads[i] )
+                 {
+                    _heads[i] = n->next;
+                    ::operator delete( n );
+                 }
+              }
+           }
+
+           static size_t class_of( size_t size ) { return (size + block_size - 1) / block_size - 1; }
+
+           void* pop( size_t cls )
+           {
+              node* n = _heads[cls];
+              if( n == nullptr )
+                 return ::operator new( (cls + 1) * block_size );
+              _heads[cls] = n->next;
+              --_counts[cls];
+              return n;
+           }
+           void push( size_t cls, void* p )
+           {
+              if( _counts[cls] >= max_cached )
+              {
+                 ::operator delete( p );
+                 return;
+              }
+              node* n = static_cast<node*>(p);
+              n->next = _heads[cls];
+              _heads[cls] = n;
+              ++_counts[cls];
+           }
+
+           promise_freelist_stats stats()const
+           {
+              promise_freelist_stats s;
+              for( size_t i = 0; i < class_count; ++i )
+              {
+                 s.cached_blocks += _counts[i];
+                 s.cached_bytes  += _counts[i] * (i + 1) * block_size;
+              }
+              return s;
+           }
+
+           /** @return the list of the calling thread, or nullptr once it has been cleaned up */
+           static promise_freelist* current()
+           {
+              promise_freelist*& fl = current_ptr();
+              if( fl == nullptr && !cleaned_up() )
+              {
+                 fl = new promise_freelist();
+                 set_thread_specific_data( slot(), fl, &cleanup );
+              }
+              return fl;
+           }
+
+        private:
+           struct node { node* next; };
+
+           static promise_freelist*& current_ptr()
+           {
+              #ifdef _MSC_VER
+                 static __declspec(thread) promise_freelist* fl = nullptr;
+              #else
+                 static __thread promise_freelist* fl = nullptr;
+              #endif
+              return fl;
+           }
+           static bool& cleaned_up()
+           {
+              #ifdef _MSC_VER
+                 static __declspec(thread) bool c = false;
+              #else
+                 static __thread bool c = false;
+              #endif
+              return c;
+           }
+           static unsigned slot()
+           {
+              static unsigned s = get_next_unused_thread_storage_slot();
+              return s;
+           }
+           static void cleanup( void* fl )
+           {
+              current_ptr() = nullptr;
+              cleaned_up()  = true;
+              delete static_cast<promise_freelist*>(fl);
+           }
+
+           node*    _heads[class_count];
+           uint32_t _counts[class_count];
+     };
+  }
+
+  promise_freelist_stats get_promise_freelist_stats()
+  {
+     if( detail::promise_freelist* fl = detail::promise_freelist::current() )
+        return fl->stats();
+     return promise_freelist_stats();
+  }
+
+  void* promise_base::operator new( size_t size )
+  {
+     const size_t cls = detail::promise_freelist::class_of( size );
+     if( cls < detail::promise_freelist::class_count )
+     {
+        if( detail::promise_freelist* fl = detail::promise_freelist::current() )
+           return fl->pop( cls );
+        return ::operator new( (cls + 1) * detail::promise_freelist::block_size );
+     }
+     return ::operator new( size );
+  }
+
+  void promise_base::operator delete( void* p, size_t size )
+  {
+     const size_t cls = detail::promise_freelist::class_of( size );
+     if( cls < detail::promise_freelist::class_count )
+     {
+        if( detail::promise_freelist* fl = detail::promise_freelist::current() )
+        {
+           fl->push( cls, p );
+           return;
+        }
+     }
+     ::operator delete( p );
+  }
+
   promise_base::promise_base( const char* desc )
   :_ready(false),
    _blocked_thread(nullptr),
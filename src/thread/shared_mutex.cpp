@@ -0,0 +1,215 @@
+#include <fc/thread/shared_mutex.hpp>
+#include <fc/thread/unique_lock.hpp>
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+
+/** set to 0 or 1 when building fc to override recording the lock stats in debug builds only */
+#ifndef FC_LOCK_STATS
+# ifdef NDEBUG
+#  define FC_LOCK_STATS 0
+# else
+#  define FC_LOCK_STATS 1
+# endif
+#endif
+
+namespace fc {
+
+  void lock_time_histogram::add( const microseconds& d )
+  {
+    uint64_t us = d.count() > 0 ? uint64_t(d.count()) : 0;
+    uint32_t bucket = 0;
+    while( us && bucket + 1 < buckets )
+    {
+      us >>= 1;
+      ++bucket;
+    }
+    ++counts[bucket];
+  }
+
+  shared_mutex::shared_mutex()
+  :m_readers(0),m_waiting_writers(0),m_writer(false){}
+
+  shared_mutex::~shared_mutex()
+  {
+    BOOST_ASSERT( m_waiters.empty() && "Attempt to free shared_mutex while others are blocking on lock." );
+  }
+
+  bool shared_mutex::try_lock()
+  {
+    fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+    if( m_writer || m_readers )
+      return false;
+    m_writer = true;
+#if FC_LOCK_STATS
+    m_exclusive_since = time_point::now();
+#endif
+    return true;
+  }
+
+  void shared_mutex::lock()
+  {
+    if( !try_lock() )
+      wait( true );
+  }
+
+  bool shared_mutex::try_lock_shared()
+  {
+    fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+    // readers do not pass waiting writers
+    if( m_writer || m_waiting_writers )
+      return false;
+#if FC_LOCK_STATS
+    if( m_readers == 0 )
+      m_shared_since = time_point::now();
+#endif
+    ++m_readers;
+    return true;
+  }
+
+  void shared_mutex::lock_shared()
+  {
+    if( !try_lock_shared() )
+      wait( false );
+  }
+
+  void shared_mutex::unlock()
+  {
+    fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+    release_exclusive();
+  }
+
+  void shared_mutex::unlock_shared()
+  {
+    fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+    release_shared();
+  }
+
+  /** queues the current fiber and waits until a release grants it the lock */
+  void shared_mutex::wait( bool exclusive )
+  {
+    // waiting on a promise rather than just yielding lets a cancel wake the fiber
+    waiter w{ fc::promise<void>::ptr( new fc::promise<void>( "fc::shared_mutex wait" ) ), exclusive, false };
+#if FC_LOCK_STATS
+    const time_point wait_start = time_point::now();
+#endif
+
+    {
+      fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+      m_waiters.push_back( &w );
+      if( exclusive )
+        ++m_waiting_writers;
+      // the lock may have been released since the try_lock
+      grant_waiters();
+      if( w.granted )
+        return;
+    }
+
+    std::exception_ptr e; // the cleanup takes m_lock, which may yield, so leave the catch block first
+    try
+    {
+      w.prom->wait();
+      // a release granted us the lock before it woke us
+      BOOST_ASSERT( w.granted );
+#if FC_LOCK_STATS
+      fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+      (exclusive ? m_stats.exclusive_wait : m_stats.shared_wait).add( time_point::now() - wait_start );
+#endif
+      return;
+    }
+    catch( ... )
+    {
+      e = std::current_exception();
+    }
+
+    {
+      fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+      if( w.granted )
+      {
+        // granted while being canceled, give it on
+        if( exclusive )
+          release_exclusive();
+        else
+          release_shared();
+      }
+      else
+      {
+        m_waiters.erase( std::find( m_waiters.begin(), m_waiters.end(), &w ) );
+        if( exclusive )
+          --m_waiting_writers;
+        // readers queued only because of this writer may go now
+        grant_waiters();
+      }
+    }
+    std::rethrow_exception(e);
+  }
+
+  /** grants the lock to whom it can be handed next, m_lock must be held */
+  void shared_mutex::grant_waiters()
+  {
+    if( m_writer )
+      return;
+    if( m_waiting_writers )
+    {
+      if( m_readers )
+        return;
+      auto itr = std::find_if( m_waiters.begin(), m_waiters.end(), []( waiter* w ){ return w->exclusive; } );
+      waiter* w = *itr;
+      m_waiters.erase( itr );
+      --m_waiting_writers;
+      m_writer = true;
+#if FC_LOCK_STATS
+      m_exclusive_since = time_point::now();
+#endif
+      grant( w );
+      return;
+    }
+    // only readers are waiting, let all of them in at once
+#if FC_LOCK_STATS
+    if( m_readers == 0 && !m_waiters.empty() )
+      m_shared_since = time_point::now();
+#endif
+    while( !m_waiters.empty() )
+    {
+      waiter* w = m_waiters.front();
+      m_waiters.pop_front();
+      ++m_readers;
+      grant( w );
+    }
+  }
+
+  void shared_mutex::grant( waiter* w )
+  {
+    fc::promise<void>::ptr prom = w->prom; // w may be gone once its fiber runs again
+    w->granted = true;
+    prom->set_value();
+  }
+
+  void shared_mutex::release_exclusive()
+  {
+    BOOST_ASSERT( m_writer );
+    m_writer = false;
+#if FC_LOCK_STATS
+    m_stats.exclusive_hold.add( time_point::now() - m_exclusive_since );
+#endif
+    grant_waiters();
+  }
+
+  void shared_mutex::release_shared()
+  {
+    BOOST_ASSERT( m_readers > 0 );
+    if( --m_readers )
+      return;
+#if FC_LOCK_STATS
+    m_stats.shared_hold.add( time_point::now() - m_shared_since );
+#endif
+    grant_waiters();
+  }
+
+  shared_mutex_stats shared_mutex::stats()const
+  {
+    fc::unique_lock<fc::spin_yield_lock> lock(m_lock);
+    return m_stats;
+  }
+
+} // fc
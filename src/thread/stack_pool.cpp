@@ -0,0 +1,199 @@
+#include "stack_pool.hpp"
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <atomic>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+namespace fc {
+
+  namespace
+  {
+     std::atomic<uint64_t> live_stacks(0);
+     std::atomic<uint64_t> pooled_stacks(0);
+     std::atomic<uint64_t> live_bytes(0);
+     std::atomic<uint64_t> pooled_bytes(0);
+
+     size_t page_size()
+     {
+#ifdef _WIN32
+        static const size_t size = [](){ SYSTEM_INFO si; GetSystemInfo( &si ); return size_t(si.dwPageSize); }();
+#else
+        static const size_t size = size_t( sysconf( _SC_PAGESIZE ) );
+#endif
+        return size;
+     }
+
+#ifdef _WIN32
+     /**
+      *  Commits the top page of a reserved stack and a guard page below it.  Touching the
+      *  guard page makes Windows commit it and move the guard one page down, as it does
+      *  for thread stacks; the lowest page is never committed and stops the growth.
+      */
+     void commit_top( void* base, size_t size )
+     {
+        char* top = static_cast<char*>(base) + page_size() + size;
+        VirtualAlloc( top - page_size(), page_size(), MEM_COMMIT, PAGE_READWRITE );
+        VirtualAlloc( top - 2 * page_size(), page_size(), MEM_COMMIT, PAGE_READWRITE | PAGE_GUARD );
+     }
+#endif
+
+     void* map_stack( size_t size )
+     {
+        const size_t total = size + page_size();
+#ifdef _WIN32
+        void* base = VirtualAlloc( nullptr, total, MEM_RESERVE, PAGE_NOACCESS );
+        FC_ASSERT( base != nullptr, "unable to allocate a fiber stack of ${size} bytes", ("size",size) );
+        commit_top( base, size );
+#else
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+# ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+# endif
+        void* base = mmap( nullptr, total, PROT_READ | PROT_WRITE, flags, -1, 0 );
+        FC_ASSERT( base != MAP_FAILED, "unable to allocate a fiber stack of ${size} bytes", ("size",size) );
+        mprotect( base, page_size(), PROT_NONE );
+#endif
+        return base;
+     }
+
+     void unmap_stack( void* base, size_t size )
+     {
+#ifdef _WIN32
+        VirtualFree( base, 0, MEM_RELEASE );
+#else
+        munmap( base, size + page_size() );
+#endif
+     }
+
+     void release_pages( void* base, size_t size )
+     {
+        char* usable = static_cast<char*>(base) + page_size();
+#ifdef _WIN32
+        VirtualFree( usable, size, MEM_DECOMMIT );
+        commit_top( base, size );
+#else
+        madvise( usable, size, MADV_DONTNEED );
+#endif
+     }
+
+     size_t class_size( size_t cls )
+     {
+        return size_t(FC_CONTEXT_MIN_STACK_SIZE) << cls;
+     }
+  }
+
+  fiber_stack_stats get_fiber_stack_stats()
+  {
+     fiber_stack_stats s;
+     s.live_stacks   = live_stacks.load( std::memory_order_relaxed );
+     s.pooled_stacks = pooled_stacks.load( std::memory_order_relaxed );
+     s.live_bytes    = live_bytes.load( std::memory_order_relaxed );
+     s.pooled_bytes  = pooled_bytes.load( std::memory_order_relaxed );
+     return s;
+  }
+
+  stack_pool::stack_pool()
+  :_unreleased(0){}
+
+  stack_pool::~stack_pool()
+  {
+     for( size_t cls = 0; cls < _classes.size(); ++cls )
+     {
+        const size_t size = class_size( cls );
+        for( const pooled_stack& s : _classes[cls] )
+           unmap_stack( s.base, size );
+        pooled_stacks.fetch_sub( _classes[cls].size(), std::memory_order_relaxed );
+        pooled_bytes.fetch_sub( _classes[cls].size() * size, std::memory_order_relaxed );
+     }
+  }
+
+  size_t stack_pool::class_of( size_t size )
+  {
+     size_t cls = 0;
+     while( class_size( cls ) < size )
+        ++cls;
+     return cls;
+  }
+
+  void stack_pool::allocate( boost::coroutines::stack_context& ctx, size_t size )
+  {
+     const size_t cls   = class_of( size );
+     const size_t bytes = class_size( cls );
+     void* base = nullptr;
+     if( cls < _classes.size() && !_classes[cls].empty() )
+     {
+        const pooled_stack& s = _classes[cls].back();
+        base = s.base;
+        if( !s.released )
+           --_unreleased;
+        _classes[cls].pop_back();
+        pooled_stacks.fetch_sub( 1, std::memory_order_relaxed );
+        pooled_bytes.fetch_sub( bytes, std::memory_order_relaxed );
+     }
+     else
+        base = map_stack( bytes );
+
+     ctx.size = bytes;
+     ctx.sp   = static_cast<char*>(base) + page_size() + bytes;
+     live_stacks.fetch_add( 1, std::memory_order_relaxed );
+     live_bytes.fetch_add( bytes, std::memory_order_relaxed );
+  }
+
+  void stack_pool::deallocate( boost::coroutines::stack_context& ctx )
+  {
+     const size_t cls   = class_of( ctx.size );
+     void*        base  = static_cast<char*>(ctx.sp) - ctx.size - page_size();
+     live_stacks.fetch_sub( 1, std::memory_order_relaxed );
+     live_bytes.fetch_sub( ctx.size, std::memory_order_relaxed );
+
+     if( cls >= _classes.size() )
+        _classes.resize( cls + 1 );
+     if( _classes[cls].size() >= FC_MAX_POOLED_STACKS )
+     {
+        unmap_stack( base, ctx.size );
+        return;
+     }
+     _classes[cls].push_back( pooled_stack{ base, false } );
+     ++_unreleased;
+     pooled_stacks.fetch_add( 1, std::memory_order_relaxed );
+     pooled_bytes.fetch_add( ctx.size, std::memory_order_relaxed );
+  }
+
+#ifdef _WIN32
+  void stack_pool::enter( const boost::coroutines::stack_context& ctx )
+  {
+     // boost.context starts a fiber with the TIB stack limit at the bottom of the whole
+     // stack, which would let __chkstk skip the guard page; the limit is the lowest
+     // committed page instead, and Windows lowers it as the stack grows
+     MEMORY_BASIC_INFORMATION committed;
+     VirtualQuery( static_cast<char*>(ctx.sp) - 1, &committed, sizeof(committed) );
+     reinterpret_cast<NT_TIB*>( NtCurrentTeb() )->StackLimit = committed.BaseAddress;
+  }
+#endif
+
+  void stack_pool::release_idle()
+  {
+     if( _unreleased == 0 )
+        return;
+     for( size_t cls = 0; cls < _classes.size(); ++cls )
+     {
+        for( pooled_stack& s : _classes[cls] )
+        {
+           if( !s.released )
+           {
+              release_pages( s.base, class_size( cls ) );
+              s.released = true;
+           }
+        }
+     }
+     _unreleased = 0;
+  }
+
+} // namespace fc
@@ -0,0 +1,49 @@
+#pragma once
+#include <boost/version.hpp>
+#include <boost/coroutine/stack_context.hpp>
+#include <stddef.h>
+#include <vector>
+
+namespace fc {
+
+  /**
+   *  Allocates the stacks of a thread's fibers and keeps released stacks for reuse.
+   *
+   *  Sizes are rounded up to a power of two of at least FC_CONTEXT_MIN_STACK_SIZE, and
+   *  each size class keeps up to FC_MAX_POOLED_STACKS released stacks.  Stacks are
+   *  mapped without committing memory and with a guard page below them, so a fiber only
+   *  costs the pages it touches; on Windows only the range is reserved, and pages are
+   *  committed as the stack grows into its guard page.  release_idle() hands the pages
+   *  of pooled stacks back to the OS while keeping the mappings.
+   *
+   *  Not thread safe: only the owning thread's contexts use it.
+   */
+  class stack_pool {
+    public:
+      stack_pool();
+      ~stack_pool();
+
+      void allocate( boost::coroutines::stack_context& ctx, size_t size );
+      void deallocate( boost::coroutines::stack_context& ctx );
+
+      /** lets the OS reclaim the memory of stacks pooled since the last call */
+      void release_idle();
+
+#ifdef _WIN32
+      /** called on a new fiber's stack before it runs anything, see map_stack() */
+      static void enter( const boost::coroutines::stack_context& ctx );
+#endif
+
+    private:
+      struct pooled_stack {
+        void*  base;     ///< the start of the mapping, including the guard page
+        bool   released;
+      };
+
+      static size_t class_of( size_t size );
+
+      std::vector< std::vector<pooled_stack> > _classes;
+      size_t                                   _unreleased;
+  };
+
+} // namespace fc
@@ -18,6 +18,9 @@ namespace fc {
   :
   promise_base("task_base"),
   _posted_num(0),
+  _stack_size(0),
+  _posted(false),
+  _scheduled_on(nullptr),
   _active_context(nullptr),
   _next(nullptr),
   _task_specific_data(nullptr),
@@ -52,10 +55,14 @@ namespace fc {
     } 
     catch ( const exception& e ) 
     {
+      if( _posted && e.code() != canceled_exception_code )
+        elog( "posted task ${description} failed: ${e}", ("description", get_desc())("e", e.to_detail_string()) );
       set_exception( e.dynamic_copy_exception() );
     } 
     catch ( ... ) 
     {
+      if( _posted )
+        elog( "posted task ${description} failed: ${diagnostic}", ("description", get_desc())("diagnostic",boost::current_exception_diagnostic_information()) );
       set_exception( std::make_shared<unhandled_exception>( FC_LOG_MESSAGE( warn, "unhandled exception: ${diagnostic}", ("diagnostic",boost::current_exception_diagnostic_information()) ) ) );
     }
   }
@@ -74,7 +81,12 @@ namespace fc {
 #ifndef NDEBUG
       _active_context->cancellation_reason = reason;
 #endif
-      _active_context->ctx_thread->notify_task_has_been_canceled();
+      _active_context->ctx_thread->notify_task_has_been_canceled(this);
+    }
+    else if (_scheduled_on)
+    {
+      // completes the task now instead of when it was scheduled
+      _scheduled_on->notify_task_has_been_canceled(this);
     }
   }
 
@@ -2,6 +2,7 @@
 #include <fc/vector.hpp>
 #include <fc/io/sstream.hpp>
 #include <fc/log/logger.hpp>
+#include <fc/asio.hpp>
 #include "thread_d.hpp"
 
 #if defined(_MSC_VER) && !defined(NDEBUG)
@@ -196,16 +197,16 @@ namespace fc {
       unstarted_task->set_exception(std::make_shared<canceled_exception>(FC_LOG_MESSAGE(error, "cancellation reason: thread quitting")));
     my->task_pqueue.clear();
 
-    for (task_base* scheduled_task : my->task_sch_queue)
-      scheduled_task->set_exception(std::make_shared<canceled_exception>(FC_LOG_MESSAGE(error, "cancellation reason: thread quitting")));
-    my->task_sch_queue.clear();
+    my->task_timers.clear( []( timer_wheel::node& n ) {
+      static_cast<task_base*>(n.data)->set_exception(std::make_shared<canceled_exception>(FC_LOG_MESSAGE(error, "cancellation reason: thread quitting")));
+    });
 
 
 
     // move all sleep tasks to ready
-    for( uint32_t i = 0; i < my->sleep_pqueue.size(); ++i )
-      my->add_context_to_ready_list( my->sleep_pqueue[i] );
-    my->sleep_pqueue.clear();
+    my->sleep_timers.clear( [this]( timer_wheel::node& n ) {
+      my->add_context_to_ready_list( static_cast<fc::context*>(n.data) );
+    });
 
     // move all idle tasks to ready
     fc::context* cur = my->pt_head;
@@ -300,10 +301,7 @@ namespace fc {
        if( timeout != time_point::maximum() )
        {
            my->current->resume_time = timeout;
-           my->sleep_pqueue.push_back(my->current);
-           std::push_heap( my->sleep_pqueue.begin(),
-                           my->sleep_pqueue.end(),
-                           sleep_priority_less()   );
+           my->sleep_timers.schedule( my->current->sleep_timer, timeout );
        }
 
        my->add_to_blocked( my->current );
@@ -327,13 +325,14 @@ namespace fc {
    }
 
    void thread::poke() {
-     boost::unique_lock<boost::mutex> lock(my->task_ready_mutex);
-     my->task_ready.notify_one();
+     my->wake();
    }
 
    void thread::async_task( task_base* t, const priority& p, const time_point& tp ) {
       assert(my);
       t->_when = tp;
+      if( tp != time_point::min() )
+        t->_scheduled_on = this;
      // slog( "when %lld", t->_when.time_since_epoch().count() );
      // slog( "delay %lld", (tp - fc::time_point::now()).count() );
       task_base* stale_head = my->task_in_queue.load(boost::memory_order_relaxed);
@@ -343,10 +342,8 @@ namespace fc {
       // Because only one thread can post the 'first task', only that thread will attempt
       // to aquire the lock and therefore there should be no contention on this lock except
       // when *this thread is about to block on a wait condition.
-      if( this != &current() &&  !stale_head ) {
-          boost::unique_lock<boost::mutex> lock(my->task_ready_mutex);
-          my->task_ready.notify_one();
-      }
+      if( this != &current() &&  !stale_head )
+          my->wake();
    }
 
    void yield() {
@@ -392,10 +389,7 @@ namespace fc {
          if( timeout != time_point::maximum() )
          {
              my->current->resume_time = timeout;
-             my->sleep_pqueue.push_back(my->current);
-             std::push_heap( my->sleep_pqueue.begin(),
-                             my->sleep_pqueue.end(),
-                             sleep_priority_less() );
+             my->sleep_timers.schedule( my->current->sleep_timer, timeout );
          }
 
        //  elog( "blocking %1%", my->current );
@@ -418,7 +412,7 @@ namespace fc {
       BOOST_ASSERT(p->ready());
       if( !is_current() )
       {
-        this->async( [=](){ notify(p); }, "notify", priority::max() );
+        this->post( [=](){ notify(p); }, "notify", priority::max() );
         return;
       }
       // TODO: store a list of blocked contexts with the promise
@@ -437,16 +431,10 @@ namespace fc {
           // remove it from the blocked list.
 
           // remove this context from the sleep queue...
-          for( uint32_t i = 0; i < my->sleep_pqueue.size(); ++i )
+          if( cur_blocked->sleep_timer.is_scheduled() )
           {
-            if( my->sleep_pqueue[i] == cur_blocked )
-            {
-              my->sleep_pqueue[i]->blocking_prom.clear();
-              my->sleep_pqueue[i] = my->sleep_pqueue.back();
-              my->sleep_pqueue.pop_back();
-              std::make_heap( my->sleep_pqueue.begin(),my->sleep_pqueue.end(), sleep_priority_less() );
-              break;
-            }
+            cur_blocked->blocking_prom.clear();
+            my->sleep_timers.cancel( cur_blocked->sleep_timer );
           }
           auto cur = cur_blocked;
           if( prev_blocked )
@@ -475,9 +463,10 @@ namespace fc {
       return this == &current();
     }
 
-    void thread::notify_task_has_been_canceled()
+    void thread::notify_task_has_been_canceled( task_base* t )
     {
-      async( [=](){ my->notify_task_has_been_canceled(); }, "notify_task_has_been_canceled", priority::max() );
+      promise_base::ptr keep_alive( t, true );
+      post( [this,t,keep_alive](){ my->notify_task_has_been_canceled( t ); }, "notify_task_has_been_canceled", priority::max() );
     }
 
     void thread::unblock(fc::context* c)
@@ -485,6 +474,21 @@ namespace fc {
       my->unblock(c);
     }
 
+    namespace asio
+    {
+      boost::asio::io_service& enable_thread_io_service()
+      {
+        return thread_d::of( thread::current() ).enable_io_service();
+      }
+
+      boost::asio::io_service& current_io_service()
+      {
+        if( boost::asio::io_service* reactor = thread_d::of( thread::current() ).io.load( boost::memory_order_relaxed ) )
+          return *reactor;
+        return next_io_service();
+      }
+    }
+
 
 #ifdef _MSC_VER
     /* support for providing a structured exception handler for async tasks */
@@ -1,4 +1,5 @@
 #include <fc/thread/thread.hpp>
+#include <fc/thread/timer_wheel.hpp>
 #include <fc/string.hpp>
 #include <fc/time.hpp>
 #include <boost/thread.hpp>
@@ -6,15 +7,15 @@
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread.hpp>
 #include <boost/atomic.hpp>
+#include <boost/asio/io_service.hpp>
+#if BOOST_VERSION < 106600
+#include <boost/asio/deadline_timer.hpp>
+#endif
+#include <memory>
 #include <vector>
 //#include <fc/logger.hpp>
 
 namespace fc {
-    struct sleep_priority_less {
-        bool operator()( const context::ptr& a, const context::ptr& b ) {
-            return a->resume_time > b->resume_time;
-        }
-    };
     class thread_d {
 
         public:
@@ -25,8 +26,11 @@ namespace fc {
              task_in_queue(0),
              next_posted_num(1),
              done(false),
+             io(nullptr),
+             io_polls(0),
              current(0),
              pt_head(0),
+             idle_contexts(0),
              blocked(0),
              next_unused_task_storage_slot(0)
 #ifndef NDEBUG
@@ -65,6 +69,8 @@ namespace fc {
                boost_thread->detach();
                delete boost_thread;
              }
+             io_work.reset();
+             delete io.load();
            }
 
            fc::thread&             self;
@@ -76,15 +82,23 @@ namespace fc {
            boost::atomic<task_base*>       task_in_queue;
            std::vector<task_base*>         task_pqueue;    // heap of tasks that have never started, ordered by proirity & scheduling time
            uint64_t                        next_posted_num; // each task or context gets assigned a number in the order it is ready to execute, tracked here
-           std::vector<task_base*>         task_sch_queue; // heap of tasks that have never started but are scheduled for a time in the future, ordered by the time they should be run
-           std::vector<fc::context*>       sleep_pqueue;   // heap of running tasks that have sleeped, ordered by the time they should resume
+           timer_wheel                     task_timers;    // tasks that have never started but are scheduled for a time in the future
+           timer_wheel                     sleep_timers;   // running tasks that have sleeped, or wait with a timeout
            std::vector<fc::context*>       free_list;      // list of unused contexts that are ready for deletion
 
            bool                     done;
+
+           // the thread's own io_service, if fc::asio::enable_thread_io_service() was called on it;
+           // it replaces task_ready for waiting, so I/O completions run right here
+           boost::atomic<boost::asio::io_service*>        io;
+           std::unique_ptr<boost::asio::io_service::work> io_work;
+           unsigned                                       io_polls;
+
            fc::string               name;
            fc::context*             current;     // the currently-executing task in this thread
 
            fc::context*             pt_head;     // list of contexts that can be reused for new tasks
+           unsigned                 idle_contexts; // length of the pt_head list
 
            std::vector<fc::context*> ready_heap; // priority heap of contexts that are ready to run
 
@@ -158,6 +172,7 @@ namespace fc {
            {
               c->next = pt_head;
               pt_head = c;
+              ++idle_contexts;
               /* 
               fc::context* n = pt_head;
               int i = 0;
@@ -169,6 +184,42 @@ namespace fc {
               */
            }
 
+           /** takes the first idle context with at least stack_size bytes of stack off pt_head */
+           fc::context* pt_pop( size_t stack_size )
+           {
+              for( fc::context** c = &pt_head; *c; c = &(*c)->next )
+              {
+                 if( (*c)->stack_size >= stack_size )
+                 {
+                    fc::context* found = *c;
+                    *c = found->next;
+                    found->next = 0;
+                    --idle_contexts;
+                    return found;
+                 }
+              }
+              return nullptr;
+           }
+
+           /**
+            *  Parks the current fiber on pt_head and switches to another one, unless
+            *  FC_MAX_IDLE_CONTEXTS fibers are parked already.
+            *  @return false if the current fiber should exit instead, releasing its stack
+            */
+           bool park_current_fiber()
+           {
+              if( current->stack_alloc && idle_contexts >= FC_MAX_IDLE_CONTEXTS )
+                return false;
+              pt_push_back( current );
+              start_next_fiber( false );
+              return true;
+           }
+
+           static size_t stack_size_for( const task_base* t )
+           {
+              return t->_stack_size ? t->_stack_size : FC_CONTEXT_STACK_SIZE;
+           }
+
           fc::context::ptr ready_pop_front() 
           {
             fc::context* highest_priority_context = ready_heap.front();
@@ -213,14 +264,6 @@ namespace fc {
             }
           };
 
-          struct task_when_less 
-          {
-            bool operator()( task_base* a, task_base* b ) 
-            {
-              return a->_when > b->_when;
-            }
-          };
-
            void enqueue( task_base* t ) 
            {
               time_point now = time_point::now();
@@ -245,9 +288,8 @@ namespace fc {
               {
                 if (cur->_when > now)
                 {
-                  task_sch_queue.push_back(cur);
-                  std::push_heap(task_sch_queue.begin(),
-                                 task_sch_queue.end(), task_when_less());
+                  cur->_timer.data = cur;
+                  task_timers.schedule(cur->_timer, cur->_when);
                 }
                 else
                 {
@@ -267,7 +309,7 @@ namespace fc {
 
             // first, if there are any new tasks on 'task_in_queue', which is tasks that 
             // have been just been async or scheduled, but we haven't processed them.
-            // move them into the task_sch_queue or task_pqueue, as appropriate
+            // move them into the task_timers or task_pqueue, as appropriate
 
             //DLN: changed from memory_order_consume for boost 1.55.
             //This appears to be safest replacement for now, maybe
@@ -276,20 +318,20 @@ namespace fc {
             if (pending_list)
               enqueue(pending_list);
 
-            // second, walk through task_sch_queue and move any scheduled tasks that are now
-            // able to run (because their scheduled time has arrived) to task_pqueue
-
-            while (!task_sch_queue.empty() &&
-                   task_sch_queue.front()->_when <= time_point::now())
+            // second, move any scheduled tasks that are now able to run (because their
+            // scheduled time has arrived) to task_pqueue
+            if (task_timers.empty())
+              return;
+            const time_point now = time_point::now();
+            if (task_timers.next_expiry() > now)
+              return;
+            task_timers.expire(now, [this](timer_wheel::node& n)
             {
-              task_base* ready_task = task_sch_queue.front();
-              std::pop_heap(task_sch_queue.begin(), task_sch_queue.end(), task_when_less());
-              task_sch_queue.pop_back();
-
+              task_base* ready_task = static_cast<task_base*>(n.data);
               ready_task->_posted_num = next_posted_num++;
               task_pqueue.push_back(ready_task);
               std::push_heap(task_pqueue.begin(), task_pqueue.end(), task_priority_less());
-            }
+            });
           }
 
            task_base* dequeue() 
@@ -304,30 +346,6 @@ namespace fc {
                 return p;
            }
 
-           bool process_canceled_tasks()
-           {
-              bool canceled_task = false;
-              for( auto task_itr = task_sch_queue.begin();
-                   task_itr != task_sch_queue.end();
-                   )
-              {
-                 if( (*task_itr)->canceled() )
-                 {
-                    (*task_itr)->run();
-                    (*task_itr)->release();
-                    task_itr = task_sch_queue.erase(task_itr);
-                    canceled_task = true;
-                    continue;
-                 }
-                 ++task_itr;
-              }
-
-              if( canceled_task )  
-                 std::make_heap( task_sch_queue.begin(), task_sch_queue.end(), task_when_less() );
-
-              return canceled_task;
-           }
-           
            /**
             * This should be before or after a context switch to
             * detect quit/cancel operations and throw an exception.
@@ -372,6 +390,7 @@ namespace fc {
               assert(std::current_exception() == std::exception_ptr());
 
               check_for_timeouts();
+              poll_io();
               if( !current ) 
                 current = new fc::context( &fc::thread::current() );
 
@@ -421,20 +440,20 @@ namespace fc {
                 // that will process posted tasks...
                 fc::context* prev = current;
 
-                fc::context* next = nullptr;
-                if( pt_head ) 
+                // size the fiber for the task it will most likely run first
+                const size_t stack_size = task_pqueue.empty() ? size_t(FC_CONTEXT_STACK_SIZE) 
+                                                              : stack_size_for( task_pqueue.front() );
+                fc::context* next = pt_pop( stack_size );
+                if( next ) 
                 { 
                   // grab cached context
-                  next = pt_head;
-                  pt_head = pt_head->next;
-                  next->next = 0;
                   next->reinitialize();
                 } 
                 else 
                 { 
                   // create new context.
                   next = new fc::context( &thread_d::start_process_tasks, stack_alloc,
-                                          &fc::thread::current() );
+                                          &fc::thread::current(), stack_size );
                 }
 
                 current = next;
@@ -498,6 +517,9 @@ namespace fc {
               assert( self != 0 );
 #else
               thread_d* self = (thread_d*)my;
+#endif
+#if defined(_WIN32) && BOOST_VERSION >= 105400
+              stack_pool::enter( self->current->stack_ctx );
 #endif
               try 
               {
@@ -532,7 +554,7 @@ namespace fc {
            bool has_next_task() 
            {
              if( task_pqueue.size() ||
-                 (task_sch_queue.size() && task_sch_queue.front()->_when <= time_point::now()) ||
+                 (!task_timers.empty() && task_timers.next_expiry() <= time_point::now()) ||
                  task_in_queue.load( boost::memory_order_relaxed ) )
                return true;
              return false;
@@ -545,6 +567,77 @@ namespace fc {
               free_list.clear();
            }
 
+           static thread_d& of( fc::thread& t ) { return *t.my; }
+
+           /** creates the thread's io_service on first use, call it from the thread itself */
+           boost::asio::io_service& enable_io_service()
+           {
+              boost::asio::io_service* reactor = io.load( boost::memory_order_relaxed );
+              if( !reactor )
+              {
+                reactor = new boost::asio::io_service(1);
+                io_work.reset( new boost::asio::io_service::work( *reactor ) );
+                io.store( reactor, boost::memory_order_release );
+              }
+              return *reactor;
+           }
+
+           /** wakes this thread up if it is waiting for something to do, called from other threads */
+           void wake()
+           {
+              if( boost::asio::io_service* reactor = io.load( boost::memory_order_acquire ) )
+              {
+                reactor->post( [](){} );
+                return;
+              }
+              boost::unique_lock<boost::mutex> lock(task_ready_mutex);
+              task_ready.notify_one();
+           }
+
+           /**
+            *  Runs the I/O completions that are ready, so they are not held up while the thread
+            *  stays busy.  Only every 64th call polls, each poll costs a system call.
+            */
+           void poll_io()
+           {
+              boost::asio::io_service* reactor = io.load( boost::memory_order_relaxed );
+              if( reactor && ( ++io_polls & 63 ) == 0 )
+              {
+                try
+                {
+                  reactor->poll();
+                }
+                catch( ... )
+                {
+                  elog( "Caught unhandled exception in the io_service of thread ${name}: ${e}", ("name", name)("e", fc::except_str()) );
+                }
+              }
+           }
+
+           /** runs I/O completions, waiting for one, or a wake(), until timeout_time at the latest */
+           void wait_for_io( boost::asio::io_service& reactor, const time_point& timeout_time )
+           {
+              if( reactor.poll() )
+                return;
+              if( timeout_time == time_point::maximum() )
+              {
+                reactor.run_one();
+                return;
+              }
+              const int64_t us = (timeout_time - time_point::now()).count();
+              if( us <= 0 )
+                return;
+#if BOOST_VERSION >= 106600
+              reactor.run_one_for( std::chrono::microseconds(us) );
+#else
+              boost::asio::deadline_timer timeout( reactor, boost::posix_time::microseconds(us) );
+              timeout.async_wait( []( const boost::system::error_code& ){} );
+              reactor.run_one();
+              timeout.cancel();
+              reactor.poll();
+#endif
+           }
+
            void process_tasks() 
            {
               while( !done || blocked ) 
@@ -554,6 +647,7 @@ namespace fc {
 
                 // move all now-ready sleeping tasks to the ready list
                 check_for_timeouts();
+                poll_io();
 
                 if (!task_pqueue.empty())
                 {
@@ -563,12 +657,20 @@ namespace fc {
                     if (task_priority_less()(task_pqueue.front(), ready_heap.front()))
                     {
                       // run the existing task first
-                      pt_push_back(current);
-                      start_next_fiber(false);
+                      if( !park_current_fiber() )
+                        return;
                       continue;
                     }
                   }
 
+                  if( stack_size_for( task_pqueue.front() ) > current->stack_size )
+                  {
+                    // the task asked for more stack than this fiber has, leave it to one that does
+                    if( !park_current_fiber() )
+                      return;
+                    continue;
+                  }
+
                   // if we made it here, either there's no ready context, or the ready context is
                   // scheduled after the ready task, so we should run the task first
                   run_next_task();
@@ -579,15 +681,41 @@ namespace fc {
                 // process tasks... do it.
                 if (!ready_heap.empty())
                 { 
-                   pt_push_back( current ); 
-                   start_next_fiber(false);  
+                   if( !park_current_fiber() )
+                     return;
                    continue;
                 }
 
-                if( process_canceled_tasks() ) 
-                  continue;
-
                 clear_free_list();
+#if BOOST_VERSION >= 105400
+                stack_alloc.release_idle();
+#endif
+
+                if( boost::asio::io_service* reactor = io.load( boost::memory_order_relaxed ) )
+                {
+                  // tasks posted from other threads wake the io_service, see wake()
+                  if( has_next_task() )
+                    continue;
+                  time_point timeout_time = check_for_timeouts();
+                  if( done )
+                    return;
+                  if( timeout_time != time_point::min() )
+                  {
+                    try
+                    {
+                      wait_for_io( *reactor, timeout_time );
+                    }
+                    catch( const canceled_exception& )
+                    {
+                      throw;
+                    }
+                    catch( ... )
+                    {
+                      elog( "Caught unhandled exception in the io_service of thread ${name}: ${e}", ("name", name)("e", fc::except_str()) );
+                    }
+                  }
+                  continue;
+                }
 
                 { // lock scope
                   boost::unique_lock<boost::mutex> lock(task_ready_mutex);
@@ -634,29 +762,25 @@ namespace fc {
      */
     time_point check_for_timeouts() 
     {
-        if( !sleep_pqueue.size() && !task_sch_queue.size() ) 
+        if( sleep_timers.empty() && task_timers.empty() ) 
         {
           // ilog( "no timeouts ready" );
           return time_point::maximum();
         }
 
-        time_point next = time_point::maximum();
-        if( !sleep_pqueue.empty() && next > sleep_pqueue.front()->resume_time )
-          next = sleep_pqueue.front()->resume_time;
-        if( !task_sch_queue.empty() && next > task_sch_queue.front()->_when )
-          next = task_sch_queue.front()->_when;
+        time_point next = sleep_timers.next_expiry();
+        const time_point next_task = task_timers.next_expiry();
+        if( next > next_task )
+          next = next_task;
 
         time_point now = time_point::now();
         if( now < next )
           return next;
 
         // move all expired sleeping tasks to the ready queue
-        while( sleep_pqueue.size() && sleep_pqueue.front()->resume_time < now ) 
+        sleep_timers.expire( now, [this]( timer_wheel::node& n )
         {
-          fc::context::ptr c = sleep_pqueue.front();
-          std::pop_heap(sleep_pqueue.begin(), sleep_pqueue.end(), sleep_priority_less() );
-          // ilog( "sleep pop back..." );
-          sleep_pqueue.pop_back();
+          fc::context::ptr c = static_cast<fc::context*>(n.data);
 
           if( c->blocking_prom.size() ) 
           {
@@ -670,7 +794,7 @@ namespace fc {
             if (c != current)
               add_context_to_ready_list(c);
           }
-        }
+        });
         return time_point::min();
     }
 
@@ -678,7 +802,7 @@ namespace fc {
         {
           if( fc::thread::current().my != this ) 
           {
-            self.async( [=](){ unblock(c); }, "thread_d::unblock" );
+            self.post( [=](){ unblock(c); }, "thread_d::unblock" );
             return;
           }
 
@@ -701,24 +825,12 @@ namespace fc {
           current->resume_time = tp;
           current->clear_blocking_promises();
 
-          sleep_pqueue.push_back(current);
-          std::push_heap( sleep_pqueue.begin(),
-                          sleep_pqueue.end(), sleep_priority_less()   );
+          sleep_timers.schedule( current->sleep_timer, tp );
           
           start_next_fiber(reschedule);
 
           // clear current context from sleep queue...
-          for( uint32_t i = 0; i < sleep_pqueue.size(); ++i ) 
-          {
-            if( sleep_pqueue[i] == current ) 
-            {
-              sleep_pqueue[i] = sleep_pqueue.back();
-              sleep_pqueue.pop_back();
-              std::make_heap( sleep_pqueue.begin(),
-                              sleep_pqueue.end(), sleep_priority_less() );
-              break;
-            }
-          }
+          sleep_timers.cancel( current->sleep_timer );
 
           current->resume_time = time_point::maximum();
           check_fiber_exceptions();
@@ -744,10 +856,7 @@ namespace fc {
           if( timeout != time_point::maximum() ) 
           {
             current->resume_time = timeout;
-            sleep_pqueue.push_back(current);
-            std::push_heap( sleep_pqueue.begin(),
-                            sleep_pqueue.end(), 
-                            sleep_priority_less()   );
+            sleep_timers.schedule( current->sleep_timer, timeout );
           }
 
           // elog( "blocking %1%", current );
@@ -775,38 +884,39 @@ namespace fc {
               iter->cleanup(iter->value);
         }
 
-        void notify_task_has_been_canceled()
+        void notify_task_has_been_canceled( task_base* t )
         {
-          for (fc::context** iter = &blocked; *iter;)
+          // a scheduled task that has not started yet completes right away
+          if (t->_timer.is_scheduled())
           {
-            if ((*iter)->canceled)
-            {
-              fc::context* next_blocked = (*iter)->next_blocked;
-              (*iter)->next_blocked = nullptr;
-              add_context_to_ready_list(*iter);
-              *iter = next_blocked;
-              continue;
-            }
-            iter = &(*iter)->next_blocked;
+            task_timers.cancel(t->_timer);
+            t->run();
+            t->release();
+            return;
           }
 
-          bool task_removed_from_sleep_pqueue = false;
-          for (auto sleep_iter = sleep_pqueue.begin(); sleep_iter != sleep_pqueue.end();)
+          fc::context* c = t->_active_context;
+          if (!c || !c->canceled)
+            return;
+
+          bool wake = false;
+          for (fc::context** iter = &blocked; *iter; iter = &(*iter)->next_blocked)
           {
-            if ((*sleep_iter)->canceled)
+            if (*iter == c)
             {
-              bool already_on_ready_list = std::find(ready_heap.begin(), ready_heap.end(), 
-                                                     *sleep_iter) != ready_heap.end();
-              if (!already_on_ready_list)
-                add_context_to_ready_list(*sleep_iter);
-              sleep_iter = sleep_pqueue.erase(sleep_iter);
-              task_removed_from_sleep_pqueue = true;
+              *iter = c->next_blocked;
+              c->next_blocked = nullptr;
+              wake = true;
+              break;
             }
-            else
-              ++sleep_iter;
           }
-          if (task_removed_from_sleep_pqueue)
-            std::make_heap(sleep_pqueue.begin(), sleep_pqueue.end(), sleep_priority_less());
+          if (c->sleep_timer.is_scheduled())
+          {
+            sleep_timers.cancel(c->sleep_timer);
+            wake = true;
+          }
+          if (wake && std::find(ready_heap.begin(), ready_heap.end(), c) == ready_heap.end())
+            add_context_to_ready_list(c);
         }
     };
 } // namespace fc
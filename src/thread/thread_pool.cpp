@@ -0,0 +1,301 @@
+#include <fc/thread/thread_pool.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/spin_lock.hpp>
+#include <fc/thread/scoped_lock.hpp>
+#include <fc/thread/wait_condition.hpp>
+#include <fc/string.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/exception/all.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <thread>
+
+namespace fc
+{
+   namespace detail
+   {
+      void pool_task::set_exception( promise_base& p )
+      {
+         try
+         {
+            throw;
+         }
+         catch ( const exception& e )
+         {
+            p.set_exception( e.dynamic_copy_exception() );
+         }
+         catch ( ... )
+         {
+            p.set_exception( std::make_shared<unhandled_exception>( FC_LOG_MESSAGE( warn, "unhandled exception: ${diagnostic}", ("diagnostic",boost::current_exception_diagnostic_information()) ) ) );
+         }
+      }
+
+      class thread_pool_impl
+      {
+         public:
+            struct worker
+            {
+               worker( size_t index, const string& name ):index(index),thread(name){}
+
+               const size_t            index;   ///< in workers, where it starts looking for tasks to steal
+               fc::thread              thread;
+               fc::spin_lock           lock;
+               std::deque<pool_task*>  tasks;   ///< the owner takes from the back, thieves from the front
+               fc::future<void>        done;
+            };
+
+            thread_pool_impl():idle("thread_pool_idle"){}
+
+            /** the worker of the calling thread if it belongs to this pool, else nullptr */
+            worker* current_worker()
+            {
+               return current_pool() == this ? current() : nullptr;
+            }
+
+            void push( pool_task* t )
+            {
+               worker* w = current_worker();
+               if( w == nullptr )
+                  w = workers[ next_worker.fetch_add( 1, std::memory_order_relaxed ) % workers.size() ].get();
+               {
+                  scoped_lock<spin_lock> lock( w->lock );
+                  w->tasks.push_back( t );
+               }
+               pending.fetch_add( 1, std::memory_order_release );
+               // a worker checks pending while holding idle_lock before it sleeps
+               { scoped_lock<spin_lock> lock( idle_lock ); }
+               idle.notify_one();
+            }
+
+            pool_task* take( worker& self )
+            {
+               {
+                  scoped_lock<spin_lock> lock( self.lock );
+                  if( !self.tasks.empty() )
+                  {
+                     pool_task* t = self.tasks.back();
+                     self.tasks.pop_back();
+                     return t;
+                  }
+               }
+               const size_t n = workers.size();
+               for( size_t i = 1; i < n; ++i )
+               {
+                  worker& victim = *workers[ (self.index + i) % n ];
+                  scoped_lock<spin_lock> lock( victim.lock );
+                  if( !victim.tasks.empty() )
+                  {
+                     pool_task* t = victim.tasks.front();
+                     victim.tasks.pop_front();
+                     return t;
+                  }
+               }
+               return nullptr;
+            }
+
+            void run( worker& self )
+            {
+               current_pool() = this;
+               current()      = &self;
+               for( ;; )
+               {
+                  if( pool_task* t = take( self ) )
+                  {
+                     pending.fetch_sub( 1, std::memory_order_relaxed );
+                     std::unique_ptr<pool_task> owned( t );
+                     owned->run();
+                     continue;
+                  }
+
+                  idle_lock.lock();
+                  if( pending.load( std::memory_order_acquire ) == 0 )
+                  {
+                     if( stopping.load( std::memory_order_acquire ) )
+                     {
+                        idle_lock.unlock();
+                        break;
+                     }
+                     idle.wait( idle_lock );
+                  }
+                  idle_lock.unlock();
+               }
+               current_pool() = nullptr;
+               current()      = nullptr;
+            }
+
+            void stop()
+            {
+               {
+                  scoped_lock<spin_lock> lock( idle_lock );
+                  stopping.store( true, std::memory_order_release );
+               }
+               idle.notify_all();
+               for( auto& w : workers )
+                  w->done.wait();
+               for( auto& w : workers )
+                  w->thread.quit();
+            }
+
+            std::vector<std::unique_ptr<worker>> workers;
+            std::atomic<uint32_t>                next_worker{0};
+            std::atomic<uint64_t>                pending{0};
+            std::atomic<bool>                    stopping{false};
+            fc::spin_lock                        idle_lock;
+            fc::wait_condition<>                 idle;
+
+         private:
+            static thread_pool_impl*& current_pool()
+            {
+               #ifdef _MSC_VER
+                  static __declspec(thread) thread_pool_impl* p = nullptr;
+               #else
+                  static __thread thread_pool_impl* p = nullptr;
+               #endif
+               return p;
+            }
+            static worker*& current()
+            {
+               #ifdef _MSC_VER
+                  static __declspec(thread) worker* w = nullptr;
+               #else
+                  static __thread worker* w = nullptr;
+               #endif
+               return w;
+            }
+      };
+
+      /** what the chunks of one parallel_for() share; kept alive by every helper task */
+      struct chunk_state
+      {
+         chunk_state( size_t count, size_t chunk, const std::function<void(size_t,size_t)>& run )
+         :count(count),chunk(chunk),chunks( (count + chunk - 1) / chunk ),run(run),
+          finished( new promise<void>( "thread_pool::parallel_for" ) ){}
+
+         /** runs chunks until none are left */
+         void work()
+         {
+            for( ;; )
+            {
+               const size_t c = next.fetch_add( 1, std::memory_order_relaxed );
+               if( c >= chunks )
+                  return;
+               if( !failed.load( std::memory_order_relaxed ) )
+               {
+                  try
+                  {
+                     const size_t first = c * chunk;
+                     run( first, std::min( count, first + chunk ) );
+                  }
+                  catch( const exception& e )
+                  {
+                     fail( e.dynamic_copy_exception() );
+                  }
+                  catch( ... )
+                  {
+                     fail( std::make_shared<unhandled_exception>( FC_LOG_MESSAGE( warn, "unhandled exception: ${diagnostic}", ("diagnostic",boost::current_exception_diagnostic_information()) ) ) );
+                  }
+               }
+               if( done.fetch_add( 1, std::memory_order_acq_rel ) + 1 == chunks )
+                  finished->set_value();
+            }
+         }
+
+         void fail( const exception_ptr& e )
+         {
+            scoped_lock<spin_lock> l( lock );
+            if( !error )
+               error = e;
+            failed.store( true, std::memory_order_relaxed );
+         }
+
+         const size_t                                count;
+         const size_t                                chunk;
+         const size_t                                chunks;
+         const std::function<void(size_t,size_t)>&   run;  ///< only called for a claimed chunk, the caller waits for those
+         std::atomic<size_t>                         next{0};
+         std::atomic<size_t>                         done{0};
+         std::atomic<bool>                           failed{false};
+         fc::spin_lock                               lock;
+         exception_ptr                               error;
+         promise<void>::ptr                          finished;
+      };
+
+      class chunk_task : public pool_task
+      {
+         public:
+            chunk_task( const std::shared_ptr<chunk_state>& s ):_state(s){}
+            virtual void run()override { _state->work(); }
+
+         private:
+            std::shared_ptr<chunk_state> _state;
+      };
+   } // namespace detail
+
+   thread_pool::thread_pool( uint32_t threads, const string& name )
+   :my( new detail::thread_pool_impl() )
+   {
+      if( threads == 0 )
+         threads = std::max( 1u, std::thread::hardware_concurrency() );
+      my->workers.reserve( threads );
+      for( uint32_t i = 0; i < threads; ++i )
+         my->workers.emplace_back( new detail::thread_pool_impl::worker( i, name + "_" + fc::to_string( i ) ) );
+      for( auto& w : my->workers )
+      {
+         detail::thread_pool_impl::worker* self = w.get();
+         detail::thread_pool_impl* impl = my.get();
+         w->done = w->thread.async( [impl,self](){ impl->run( *self ); }, "thread_pool::worker" );
+      }
+   }
+
+   thread_pool::~thread_pool()
+   {
+      try
+      {
+         my->stop();
+      }
+      catch( ... )
+      {
+         elog( "unexpected exception while stopping thread pool" );
+      }
+   }
+
+   thread_pool& thread_pool::default_pool()
+   {
+      static thread_pool& pool = *new thread_pool( 0, "pool" );
+      return pool;
+   }
+
+   uint32_t thread_pool::size()const
+   {
+      return my->workers.size();
+   }
+
+   void thread_pool::post( detail::pool_task* t )
+   {
+      std::unique_ptr<detail::pool_task> owned( t );
+      FC_ASSERT( !my->stopping.load( std::memory_order_acquire ), "thread_pool is stopping" );
+      my->push( owned.release() );
+   }
+
+   void thread_pool::parallel_chunks( size_t count, size_t grain, const std::function<void(size_t,size_t)>& run )
+   {
+      // a few chunks per worker so that stealing evens out chunks of uneven cost
+      const size_t target = size_t(size()) * 4;
+      const size_t chunk  = std::max( std::max<size_t>( grain, 1 ), (count + target - 1) / target );
+      auto state = std::make_shared<detail::chunk_state>( count, chunk, run );
+
+      const size_t helpers = std::min<size_t>( size(), state->chunks - 1 );
+      for( size_t i = 0; i < helpers; ++i )
+         post( new detail::chunk_task( state ) );
+
+      state->work();
+      if( state->done.load( std::memory_order_acquire ) != state->chunks )
+         fc::future<void>( state->finished ).wait();
+      if( state->error )
+         state->error->dynamic_rethrow_exception();
+   }
+
+} // namespace fc
@@ -0,0 +1,219 @@
+#include <fc/thread/timer_wheel.hpp>
+#include <string.h>
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+namespace fc
+{
+   namespace
+   {
+      inline int lowest_bit( uint64_t v )
+      {
+#ifdef _MSC_VER
+         unsigned long i;
+         _BitScanForward64( &i, v );
+         return int(i);
+#else
+         return __builtin_ctzll( v );
+#endif
+      }
+   }
+
+   timer_wheel::timer_wheel( const microseconds& resolution )
+   :_resolution( resolution.count() > 0 ? resolution.count() : 1 ),_size(0),_expiring(nullptr)
+   {
+      _current = tick_at( time_point::now(), false );
+      memset( _heads, 0, sizeof(_heads) );
+      memset( _occupied, 0, sizeof(_occupied) );
+   }
+
+   uint64_t timer_wheel::tick_at( const time_point& t, bool round_up )const
+   {
+      const int64_t us = t.time_since_epoch().count();
+      if( us <= 0 )
+         return 0;
+      return uint64_t(us) / _resolution + ( round_up && uint64_t(us) % _resolution ? 1 : 0 );
+   }
+
+   void timer_wheel::schedule( node& n, const time_point& when )
+   {
+      cancel( n );
+      n.tick = tick_at( when, true );
+      insert( n );
+      ++_size;
+   }
+
+   void timer_wheel::cancel( node& n )
+   {
+      if( n.is_scheduled() )
+         unlink( n );
+   }
+
+   void timer_wheel::insert( node& n )
+   {
+      const uint64_t tick  = n.tick > _current ? n.tick : _current;
+      const uint64_t delta = tick - _current;
+
+      uint32_t level = 0;
+      uint64_t slot_tick = tick;
+      while( level + 1 < levels && delta >> ( slot_bits * (level + 1) ) )
+         ++level;
+      if( level == levels - 1 && delta >> ( slot_bits * levels ) )
+         slot_tick = _current + ( uint64_t(1) << ( slot_bits * levels ) ) - 1; // beyond the horizon, n.tick keeps the real deadline
+
+      const uint32_t index = uint32_t( slot_tick >> ( slot_bits * level ) ) & (slots - 1);
+      const uint32_t slot  = level * slots + index;
+      n.slot = uint16_t(slot);
+      n.prev = nullptr;
+      n.next = _heads[slot];
+      if( n.next )
+         n.next->prev = &n;
+      _heads[slot] = &n;
+      _occupied[level][index / 64] |= uint64_t(1) << (index % 64);
+   }
+
+   void timer_wheel::unlink( node& n )
+   {
+      node** head = n.slot == expiring ? &_expiring : &_heads[n.slot];
+      if( n.prev )
+         n.prev->next = n.next;
+      else
+         *head = n.next;
+      if( n.next )
+         n.next->prev = n.prev;
+
+      if( n.slot != expiring && *head == nullptr )
+      {
+         const uint32_t level = n.slot / slots;
+         const uint32_t index = n.slot % slots;
+         _occupied[level][index / 64] &= ~( uint64_t(1) << (index % 64) );
+      }
+      n.prev = n.next = nullptr;
+      n.slot = unscheduled;
+      --_size;
+   }
+
+   int timer_wheel::next_slot( uint32_t level, uint32_t from )const
+   {
+      for( uint32_t word = from / 64; word < slots / 64; ++word )
+      {
+         uint64_t bits = _occupied[level][word];
+         if( word == from / 64 )
+            bits &= ~uint64_t(0) << (from % 64);
+         if( bits )
+            return int( word * 64 + lowest_bit( bits ) );
+      }
+      return -1;
+   }
+
+   /** moves the nodes of the level's slot for _current one level down */
+   void timer_wheel::cascade( uint32_t level )
+   {
+      const uint32_t index = uint32_t( _current >> ( slot_bits * level ) ) & (slots - 1);
+      node* n = _heads[level * slots + index];
+      _heads[level * slots + index] = nullptr;
+      _occupied[level][index / 64] &= ~( uint64_t(1) << (index % 64) );
+      while( n )
+      {
+         node* next = n->next;
+         insert( *n );
+         n = next;
+      }
+   }
+
+   void timer_wheel::advance( uint64_t now_tick )
+   {
+      node* tail = _expiring;
+      while( tail && tail->next )
+         tail = tail->next;
+
+      while( _current <= now_tick )
+      {
+         if( _size == 0 )
+         {
+            _current = now_tick + 1;
+            break;
+         }
+
+         // at the start of a rotation bring the next slot of each higher level down
+         if( (_current & (slots - 1)) == 0 )
+         {
+            uint32_t top = 1;
+            while( top + 1 < levels && ( _current & ( ( uint64_t(1) << ( slot_bits * top ) ) - 1 ) ) == 0 )
+               ++top;
+            for( uint32_t level = top; level >= 1; --level )
+            {
+               if( ( _current & ( ( uint64_t(1) << ( slot_bits * level ) ) - 1 ) ) == 0 )
+                  cascade( level );
+            }
+         }
+
+         const uint32_t index = uint32_t(_current) & (slots - 1);
+         if( node* n = _heads[index] )
+         {
+            _heads[index] = nullptr;
+            _occupied[0][index / 64] &= ~( uint64_t(1) << (index % 64) );
+            n->prev = tail;
+            if( tail )
+               tail->next = n;
+            else
+               _expiring = n;
+            for( ; n; n = n->next )
+            {
+               n->slot = expiring;
+               tail = n;
+            }
+         }
+
+         // skip ahead to the next occupied slot of this rotation, or to the next rotation
+         const uint64_t rotation = _current & ~uint64_t(slots - 1);
+         const int      next     = index + 1 < slots ? next_slot( 0, index + 1 ) : -1;
+         const uint64_t target   = next >= 0 ? rotation + next : rotation + slots;
+         _current = target <= now_tick ? target : now_tick + 1;
+      }
+   }
+
+   time_point timer_wheel::next_expiry()const
+   {
+      if( _size == 0 )
+         return time_point::maximum();
+      if( _expiring )
+         return time_point::min();
+
+      uint64_t earliest = ~uint64_t(0);
+      const uint32_t index0 = uint32_t(_current) & (slots - 1);
+      int s = next_slot( 0, index0 );
+      if( s >= 0 )
+         earliest = ( _current & ~uint64_t(slots - 1) ) + s;
+      else if( ( s = next_slot( 0, 0 ) ) >= 0 )
+         earliest = ( _current & ~uint64_t(slots - 1) ) + slots + s;
+
+      for( uint32_t level = 1; level < levels; ++level )
+      {
+         const uint32_t shift = slot_bits * level;
+         const uint32_t index = uint32_t( _current >> shift ) & (slots - 1);
+         // advance() cascades the slot at the current index when it processes _current if
+         // _current starts a rotation of this level, otherwise only a rotation later
+         const bool     pending = ( _current & ( ( uint64_t(1) << shift ) - 1 ) ) == 0;
+         const uint32_t from    = pending ? index : index + 1;
+         int next = from < slots ? next_slot( level, from ) : -1;
+         if( next < 0 )
+            next = next_slot( level, 0 );
+         if( next < 0 )
+            continue;
+         uint64_t distance = ( uint32_t(next) - index ) & (slots - 1);
+         if( distance == 0 && !pending )
+            distance = slots;
+         const uint64_t cascade_tick = ( ( _current >> shift ) + distance ) << shift;
+         if( cascade_tick < earliest )
+            earliest = cascade_tick;
+      }
+
+      if( earliest >= uint64_t( microseconds::maximum().count() ) / _resolution )
+         return time_point::maximum();
+      return time_point( microseconds( int64_t(earliest) * _resolution ) );
+   }
+
+} // namespace fc
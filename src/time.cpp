@@ -16,16 +16,134 @@ namespace fc {
      return time_point( microseconds( bch::duration_cast<bch::microseconds>( bch::system_clock::now().time_since_epoch() ).count() ) );
   }
 
+  namespace detail
+  {
+    // civil calendar <-> days since 1970-01-01, after http://howardhinnant.github.io/date_algorithms.html
+    void civil_from_days( int64_t z, int64_t& y, unsigned& m, unsigned& d )
+    {
+      z += 719468;
+      const int64_t  era = ( z >= 0 ? z : z - 146096 ) / 146097;
+      const unsigned doe = unsigned( z - era * 146097 );
+      const unsigned yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365;
+      const unsigned doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 );
+      const unsigned mp  = ( 5 * doy + 2 ) / 153;
+      d = doy - ( 153 * mp + 2 ) / 5 + 1;
+      m = mp < 10 ? mp + 3 : mp - 9;
+      y = int64_t( yoe ) + era * 400 + ( m <= 2 );
+    }
+
+    int64_t days_from_civil( int64_t y, unsigned m, unsigned d )
+    {
+      y -= m <= 2;
+      const int64_t  era = ( y >= 0 ? y : y - 399 ) / 400;
+      const unsigned yoe = unsigned( y - era * 400 );
+      const unsigned doy = ( 153 * ( m > 2 ? m - 3 : m + 9 ) + 2 ) / 5 + d - 1;
+      const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+      return era * 146097 + int64_t( doe ) - 719468;
+    }
+
+    inline char* put_digits( char* p, unsigned v, int n )
+    {
+      for( int i = n - 1; i >= 0; --i, v /= 10 )
+        p[i] = char( '0' + v % 10 );
+      return p + n;
+    }
+
+    /** writes "YYYY-MM-DDTHH:MM:SS", or "YYYYMMDDTHHMMSS" if !delimited, @return the end */
+    char* format_iso( uint32_t sec, bool delimited, char* p )
+    {
+      int64_t  y;
+      unsigned m, d;
+      civil_from_days( sec / 86400, y, m, d );
+      const unsigned t = sec % 86400;
+      p = put_digits( p, unsigned( y ), 4 );
+      if( delimited ) *p++ = '-';
+      p = put_digits( p, m, 2 );
+      if( delimited ) *p++ = '-';
+      p = put_digits( p, d, 2 );
+      *p++ = 'T';
+      p = put_digits( p, t / 3600, 2 );
+      if( delimited ) *p++ = ':';
+      p = put_digits( p, t / 60 % 60, 2 );
+      if( delimited ) *p++ = ':';
+      return put_digits( p, t % 60, 2 );
+    }
+
+    inline bool get_digits( const char* p, int n, unsigned& v )
+    {
+      v = 0;
+      for( int i = 0; i < n; ++i )
+      {
+        if( p[i] < '0' || p[i] > '9' )
+          return false;
+        v = v * 10 + unsigned( p[i] - '0' );
+      }
+      return true;
+    }
+
+    /**
+     *  Parses the canonical forms "YYYY-MM-DDTHH:MM:SS[.ffffff]" and "YYYYMMDDTHHMMSS".
+     *  @return false for anything else, which is left to boost so that unusual input
+     *  is accepted or rejected exactly as before
+     */
+    bool parse_iso( const fc::string& s, int64_t& sec )
+    {
+      const char* c = s.c_str();
+      unsigned y, mo, d, h, mi, se;
+      if( s.size() >= 19 && c[4] == '-' )
+      {
+        if( c[7] != '-' || c[10] != 'T' || c[13] != ':' || c[16] != ':' ||
+            !get_digits( c, 4, y ) || !get_digits( c + 5, 2, mo ) || !get_digits( c + 8, 2, d ) ||
+            !get_digits( c + 11, 2, h ) || !get_digits( c + 14, 2, mi ) || !get_digits( c + 17, 2, se ) )
+          return false;
+        if( s.size() > 19 )
+        {
+          unsigned frac;
+          if( c[19] != '.' || s.size() == 20 || s.size() > 26 || !get_digits( c + 20, int( s.size() ) - 20, frac ) )
+            return false;
+        }
+      }
+      else if( s.size() == 15 && c[8] == 'T' )
+      {
+        if( !get_digits( c, 4, y ) || !get_digits( c + 4, 2, mo ) || !get_digits( c + 6, 2, d ) ||
+            !get_digits( c + 9, 2, h ) || !get_digits( c + 11, 2, mi ) || !get_digits( c + 13, 2, se ) )
+          return false;
+      }
+      else
+        return false;
+
+      static const unsigned days_in_month[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+      const bool leap = ( y % 4 == 0 && y % 100 != 0 ) || y % 400 == 0;
+      if( y < 1400 || mo < 1 || mo > 12 || d < 1 || d > days_in_month[mo - 1] + ( mo == 2 && leap ) ||
+          h > 23 || mi > 59 || se > 59 )
+        return false;
+      sec = days_from_civil( y, mo, d ) * 86400 + h * 3600 + mi * 60 + se;
+      return true;
+    }
+  }
+
   fc::string time_point_sec::to_non_delimited_iso_string()const
   {
-    const auto ptime = boost::posix_time::from_time_t( time_t( sec_since_epoch() ) );
-    return boost::posix_time::to_iso_string( ptime );
+    char buf[16];
+    return fc::string( buf, detail::format_iso( sec_since_epoch(), false, buf ) );
   }
 
   fc::string time_point_sec::to_iso_string()const
   {
-    const auto ptime = boost::posix_time::from_time_t( time_t( sec_since_epoch() ) );
-    return boost::posix_time::to_iso_extended_string( ptime );
+    // log lines mostly format the same second over and over
+    #ifdef _MSC_VER
+       static __declspec(thread) uint32_t cached_sec = 0;
+       static __declspec(thread) char     cached[20] = "1970-01-01T00:00:00";
+    #else
+       static __thread uint32_t cached_sec = 0;
+       static __thread char     cached[20] = "1970-01-01T00:00:00";
+    #endif
+    if( sec_since_epoch() != cached_sec )
+    {
+      detail::format_iso( sec_since_epoch(), true, cached );
+      cached_sec = sec_since_epoch();
+    }
+    return fc::string( cached, 19 );
   }
 
   time_point_sec::operator fc::string()const
@@ -35,6 +153,9 @@ namespace fc {
 
   time_point_sec time_point_sec::from_iso_string( const fc::string& s )
   { try {
+      int64_t sec;
+      if( detail::parse_iso( s, sec ) )
+         return fc::time_point_sec( sec );
       static boost::posix_time::ptime epoch = boost::posix_time::from_time_t( 0 );
       boost::posix_time::ptime pt;
       if( s.size() >= 5 && s.at( 4 ) == '-' ) // http://en.wikipedia.org/wiki/ISO_8601
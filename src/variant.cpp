@@ -1,15 +1,21 @@
 #include <fc/variant.hpp>
 #include <fc/variant_object.hpp>
+#include <fc/variant_arena.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/io/sstream.hpp>
 #include <fc/io/json.hpp>
 #include <fc/io/stdio.hpp>
 #include <string.h>
+#include <assert.h>
 #include <fc/crypto/base64.hpp>
 #include <fc/crypto/hex.hpp>
 #include <boost/scoped_array.hpp>
 #include <fc/reflect/variant.hpp>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace fc
 {
@@ -22,6 +28,231 @@ void set_variant_type( variant* v, variant::type_id t)
    data[ sizeof(variant) -1 ] = t;
 }
 
+/**
+ *  Arrays and long strings are reference counted payloads shared by all copies of
+ *  a variant, so copying one is O(1).  Non-const access copies a shared payload
+ *  before handing out a mutable reference.  Payloads are allocated with
+ *  detail::variant_alloc() so they come from the current variant_arena, if any.
+ */
+struct array_payload
+{
+   template<typename... Args>
+   explicit array_payload( Args&&... args ):refs(1),value( fc::forward<Args>(args)... ){}
+
+   mutable std::atomic<uint32_t> refs;
+   variants                      value;
+};
+
+struct string_payload
+{
+   template<typename... Args>
+   explicit string_payload( Args&&... args ):refs(1),value( fc::forward<Args>(args)... ){}
+
+   mutable std::atomic<uint32_t> refs;
+   string                        value;
+};
+
+template<typename P>
+inline P*& payload( variant* v )
+{
+   return *reinterpret_cast<P**>(v);
+}
+
+template<typename P>
+inline const P* payload( const variant* v )
+{
+   return *reinterpret_cast<const P* const*>(v);
+}
+
+template<typename P>
+inline void retain( const variant* v )
+{
+   payload<P>( v )->refs.fetch_add( 1, std::memory_order_relaxed );
+}
+
+template<typename P>
+inline void release( variant* v )
+{
+   P* p = payload<P>( v );
+   if( p->refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+      detail::variant_delete( p );
+}
+
+/** ensures this variant holds the only reference to its array */
+inline variants& unshare_array( variant* v )
+{
+   array_payload*& p = payload<array_payload>( v );
+   if( p->refs.load( std::memory_order_acquire ) != 1 )
+   {
+      array_payload* copy = detail::variant_new<array_payload>( p->value );
+      release<array_payload>( v );
+      p = copy;
+   }
+   return p->value;
+}
+
+/**
+ *  Strings of up to max_inline_string bytes are stored in the variant itself: the
+ *  characters start at the first byte and the byte before the TypeID holds
+ *  inline_string_flag | length.  Longer strings are a string_payload and that
+ *  byte is 0.
+ *
+ *  get_string() of an inline string returns a string kept in materialized_strings
+ *  and sets materialized_flag.  That can happen while other threads read the same
+ *  variant, so the characters are never rewritten and the tag byte is only accessed
+ *  atomically.
+ */
+const size_t  max_inline_string  = sizeof(variant) - 2;
+const uint8_t inline_string_flag = 0x80;
+const uint8_t materialized_flag  = 0x40;
+const uint8_t inline_size_mask   = 0x3f;
+
+inline std::atomic<uint8_t>& string_tag( const variant* v )
+{
+   static_assert( sizeof(std::atomic<uint8_t>) == 1, "the tag has to fit the byte before the TypeID" );
+   char* data = const_cast<char*>( reinterpret_cast<const char*>(v) );
+   return *reinterpret_cast<std::atomic<uint8_t>*>( data + sizeof(variant) - 2 );
+}
+
+inline uint8_t load_tag( const variant* v )
+{
+   return string_tag( v ).load( std::memory_order_relaxed );
+}
+
+inline bool is_inline_string( const variant* v )
+{
+   return ( load_tag( v ) & inline_string_flag ) != 0;
+}
+
+inline bool is_materialized( const variant* v )
+{
+   return ( load_tag( v ) & materialized_flag ) != 0;
+}
+
+inline const char* variant_string_data( const variant* v )
+{
+   if( is_inline_string( v ) )
+      return reinterpret_cast<const char*>(v);
+   return payload<string_payload>( v )->value.data();
+}
+
+inline size_t variant_string_size( const variant* v )
+{
+   if( is_inline_string( v ) )
+      return load_tag( v ) & inline_size_mask;
+   return payload<string_payload>( v )->value.size();
+}
+
+/**
+ *  The strings handed out by get_string() for inline strings, keyed by the address
+ *  of their variant.  Moving a variant moves its entry, so the reference stays valid
+ *  as it does for long strings, and clear() drops it.
+ */
+class materialized_strings
+{
+   public:
+      /** never destroyed: variants with static storage duration may be cleared after main() */
+      static materialized_strings& instance()
+      {
+         static materialized_strings* table = new materialized_strings;
+         return *table;
+      }
+
+      const string& get( const variant* v )
+      {
+         stripe& s = stripe_for( v );
+         std::lock_guard<std::mutex> lock( s.mutex );
+         std::unique_ptr<string>& str = s.strings[v];
+         if( !str )
+         {
+            str.reset( new string( variant_string_data( v ), variant_string_size( v ) ) );
+            string_tag( v ).fetch_or( materialized_flag, std::memory_order_relaxed );
+         }
+         return *str;
+      }
+
+      /** @pre no other thread is using v */
+      void erase( const variant* v )
+      {
+         stripe& s = stripe_for( v );
+         std::lock_guard<std::mutex> lock( s.mutex );
+         s.strings.erase( v );
+      }
+
+      /** @pre no other thread is using from or to */
+      void move( const variant* from, const variant* to )
+      {
+         std::unique_ptr<string> str;
+         {
+            stripe& s = stripe_for( from );
+            std::lock_guard<std::mutex> lock( s.mutex );
+            auto itr = s.strings.find( from );
+            assert( itr != s.strings.end() );
+            str = std::move( itr->second );
+            s.strings.erase( itr );
+         }
+         stripe& s = stripe_for( to );
+         std::lock_guard<std::mutex> lock( s.mutex );
+         s.strings[to] = std::move( str );
+      }
+
+   private:
+      static const size_t stripe_count = 64;
+
+      struct stripe
+      {
+         std::mutex                                                     mutex;
+         std::unordered_map< const variant*, std::unique_ptr<string> > strings;
+      };
+
+      stripe& stripe_for( const variant* v )
+      {
+         return _stripes[ ( reinterpret_cast<uintptr_t>(v) / sizeof(variant) ) % stripe_count ];
+      }
+
+      stripe _stripes[stripe_count];
+};
+
+/** copies an inline string, the copy starts out without a materialized string */
+inline void copy_inline_string( variant* dst, const variant* src )
+{
+   memcpy( reinterpret_cast<char*>(dst), reinterpret_cast<const char*>(src), max_inline_string );
+   string_tag( dst ).store( load_tag( src ) & ~materialized_flag, std::memory_order_relaxed );
+   set_variant_type( dst, variant::string_type );
+}
+
+/** called after v has been copied bit for bit to dst and before v is reset */
+inline void moved_string( const variant* v, const variant* dst )
+{
+   if( dst->get_type() == variant::string_type && is_inline_string( dst ) && is_materialized( dst ) )
+      materialized_strings::instance().move( v, dst );
+}
+
+void set_string( variant* v, const char* str, size_t len )
+{
+   if( len <= max_inline_string )
+   {
+      memcpy( reinterpret_cast<char*>(v), str, len );
+      string_tag( v ).store( uint8_t( inline_string_flag | len ), std::memory_order_relaxed );
+   }
+   else
+   {
+      payload<string_payload>( v ) = detail::variant_new<string_payload>( str, len );
+      string_tag( v ).store( 0, std::memory_order_relaxed );
+   }
+   set_variant_type( v, variant::string_type );
+}
+
+void set_string( variant* v, string&& str )
+{
+   if( str.size() <= max_inline_string )
+      return set_string( v, str.data(), str.size() );
+   payload<string_payload>( v ) = detail::variant_new<string_payload>( fc::move(str) );
+   string_tag( v ).store( 0, std::memory_order_relaxed );
+   set_variant_type( v, variant::string_type );
+}
+
+
 variant::variant()
 {
    set_variant_type( this, null_type );
@@ -100,14 +331,12 @@ variant::variant( bool val )
 
 variant::variant( char* str )
 {
-   *reinterpret_cast<string**>(this)  = new string( str );
-   set_variant_type( this, string_type );
+   set_string( this, str, strlen( str ) );
 }
 
 variant::variant( const char* str )
 {
-   *reinterpret_cast<string**>(this)  = new string( str );
-   set_variant_type( this, string_type );
+   set_string( this, str, strlen( str ) );
 }
 
 // TODO: do a proper conversion to utf8
@@ -117,8 +346,7 @@ variant::variant( wchar_t* str )
    boost::scoped_array<char> buffer(new char[len]);
    for (unsigned i = 0; i < len; ++i)
      buffer[i] = (char)str[i];
-   *reinterpret_cast<string**>(this)  = new string(buffer.get(), len);
-   set_variant_type( this, string_type );
+   set_string( this, buffer.get(), len );
 }
 
 // TODO: do a proper conversion to utf8
@@ -128,14 +356,12 @@ variant::variant( const wchar_t* str )
    boost::scoped_array<char> buffer(new char[len]);
    for (unsigned i = 0; i < len; ++i)
      buffer[i] = (char)str[i];
-   *reinterpret_cast<string**>(this)  = new string(buffer.get(), len);
-   set_variant_type( this, string_type );
+   set_string( this, buffer.get(), len );
 }
 
 variant::variant( fc::string val )
 {
-   *reinterpret_cast<string**>(this)  = new string( fc::move(val) );
-   set_variant_type( this, string_type );
+   set_string( this, fc::move(val) );
 }
 variant::variant( blob val )
 {
@@ -145,39 +371,40 @@ variant::variant( blob val )
 
 variant::variant( variant_object obj)
 {
-   *reinterpret_cast<variant_object**>(this)  = new variant_object(fc::move(obj));
+   *reinterpret_cast<variant_object**>(this)  = detail::variant_new<variant_object>(fc::move(obj));
    set_variant_type(this,  object_type );
 }
 variant::variant( mutable_variant_object obj)
 {
-   *reinterpret_cast<variant_object**>(this)  = new variant_object(fc::move(obj));
+   *reinterpret_cast<variant_object**>(this)  = detail::variant_new<variant_object>(fc::move(obj));
    set_variant_type(this,  object_type );
 }
 
 variant::variant( variants arr )
 {
-   *reinterpret_cast<variants**>(this)  = new variants(fc::move(arr));
+   payload<array_payload>( this ) = detail::variant_new<array_payload>( fc::move(arr) );
    set_variant_type(this,  array_type );
 }
 
 
 typedef const variant_object* const_variant_object_ptr; 
-typedef const variants* const_variants_ptr; 
 typedef const blob*   const_blob_ptr; 
-typedef const string* const_string_ptr;
 
 void variant::clear()
 {
    switch( get_type() )
    {
      case object_type:
-        delete *reinterpret_cast<variant_object**>(this);
+        detail::variant_delete( *reinterpret_cast<variant_object**>(this) );
         break;
      case array_type:
-        delete *reinterpret_cast<variants**>(this);
+        release<array_payload>( this );
         break;
      case string_type:
-        delete *reinterpret_cast<string**>(this);
+        if( !is_inline_string( this ) )
+           release<string_payload>( this );
+        else if( is_materialized( this ) )
+           materialized_strings::instance().erase( this );
         break;
      default:
         break;
@@ -191,18 +418,21 @@ variant::variant( const variant& v )
    {
        case object_type:
           *reinterpret_cast<variant_object**>(this)  = 
-             new variant_object(**reinterpret_cast<const const_variant_object_ptr*>(&v));
+             detail::variant_new<variant_object>(**reinterpret_cast<const const_variant_object_ptr*>(&v));
           set_variant_type( this, object_type );
           return;
        case array_type:
-          *reinterpret_cast<variants**>(this)  = 
-             new variants(**reinterpret_cast<const const_variants_ptr*>(&v));
-          set_variant_type( this,  array_type );
+          retain<array_payload>( &v );
+          memcpy( this, &v, sizeof(v) );
           return;
        case string_type:
-          *reinterpret_cast<string**>(this)  = 
-             new string(**reinterpret_cast<const const_string_ptr*>(&v) );
-          set_variant_type( this, string_type );
+          if( is_inline_string( &v ) )
+          {
+             copy_inline_string( this, &v );
+             return;
+          }
+          retain<string_payload>( &v );
+          memcpy( this, &v, sizeof(v) );
           return;
        default:
           memcpy( this, &v, sizeof(v) );
@@ -212,6 +442,7 @@ variant::variant( const variant& v )
 variant::variant( variant&& v )
 {
    memcpy( this, &v, sizeof(v) );
+   moved_string( &v, this );
    set_variant_type( &v, null_type );
 }
 
@@ -225,6 +456,7 @@ variant& variant::operator=( variant&& v )
    if( this == &v ) return *this;
    clear();
    memcpy( (char*)this, (char*)&v, sizeof(v) );
+   moved_string( &v, this );
    set_variant_type( &v, null_type ); 
    return *this;
 }
@@ -234,26 +466,9 @@ variant& variant::operator=( const variant& v )
    if( this == &v ) 
       return *this;
 
-   clear();
-   switch( v.get_type() )
-   {
-      case object_type:
-         *reinterpret_cast<variant_object**>(this)  = 
-            new variant_object((**reinterpret_cast<const const_variant_object_ptr*>(&v)));
-         break;
-      case array_type:
-         *reinterpret_cast<variants**>(this)  = 
-            new variants((**reinterpret_cast<const const_variants_ptr*>(&v)));
-         break;
-      case string_type:
-         *reinterpret_cast<string**>(this)  = new string((**reinterpret_cast<const const_string_ptr*>(&v)) );
-         break;
-
-      default:
-         memcpy( this, &v, sizeof(v) );
-   }
-   set_variant_type( this, v.get_type() );
-   return *this;
+   // copy first: v may be owned by this variant
+   variant tmp( v );
+   return *this = fc::move( tmp );
 }
 
 void  variant::visit( const visitor& v )const
@@ -276,10 +491,13 @@ void  variant::visit( const visitor& v )const
          v.handle( *reinterpret_cast<const bool*>(this) );
          return;
       case string_type:
-         v.handle( **reinterpret_cast<const const_string_ptr*>(this) );
+         if( is_inline_string( this ) )
+            v.handle( string( variant_string_data( this ), variant_string_size( this ) ) );
+         else
+            v.handle( payload<string_payload>( this )->value );
          return;
       case array_type:
-         v.handle( **reinterpret_cast<const const_variants_ptr*>(this) );
+         v.handle( payload<array_payload>( this )->value );
          return;
       case object_type:
          v.handle( **reinterpret_cast<const const_variant_object_ptr*>(this) );
@@ -367,7 +585,7 @@ int64_t variant::as_int64()const
    switch( get_type() )
    {
       case string_type:
-          return to_int64(**reinterpret_cast<const const_string_ptr*>(this)); 
+          return to_int64( variant_string_data( this ), variant_string_size( this ) );
       case double_type:
           return int64_t(*reinterpret_cast<const double*>(this));
       case int64_type:
@@ -388,7 +606,7 @@ uint64_t variant::as_uint64()const
    switch( get_type() )
    {
       case string_type:
-          return to_uint64(**reinterpret_cast<const const_string_ptr*>(this)); 
+          return to_uint64( variant_string_data( this ), variant_string_size( this ) );
       case double_type:
           return static_cast<uint64_t>(*reinterpret_cast<const double*>(this));
       case int64_type:
@@ -410,7 +628,7 @@ double  variant::as_double()const
    switch( get_type() )
    {
       case string_type:
-          return to_double(**reinterpret_cast<const const_string_ptr*>(this)); 
+          return to_double( variant_string_data( this ), variant_string_size( this ) );
       case double_type:
           return *reinterpret_cast<const double*>(this);
       case int64_type:
@@ -432,10 +650,11 @@ bool  variant::as_bool()const
    {
       case string_type:
       {
-          const string& s = **reinterpret_cast<const const_string_ptr*>(this);
-          if( s == "true" )
+          const char*  s = variant_string_data( this );
+          const size_t n = variant_string_size( this );
+          if( n == 4 && memcmp( s, "true", 4 ) == 0 )
              return true;
-          if( s == "false" )
+          if( n == 5 && memcmp( s, "false", 5 ) == 0 )
              return false;
           FC_THROW_EXCEPTION( bad_cast_exception, "Cannot convert string to bool (only \"true\" or \"false\" can be converted)" );
       }
@@ -459,7 +678,7 @@ string    variant::as_string()const
    switch( get_type() )
    {
       case string_type:
-          return **reinterpret_cast<const const_string_ptr*>(this); 
+          return string( variant_string_data( this ), variant_string_size( this ) );
       case double_type:
           return to_string(*reinterpret_cast<const double*>(this)); 
       case int64_type:
@@ -484,7 +703,7 @@ string    variant::as_string()const
 variants&         variant::get_array()
 {
   if( get_type() == array_type )
-     return **reinterpret_cast<variants**>(this);
+     return unshare_array( this );
    
   FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from ${type} to Array", ("type",get_type()) );
 }
@@ -511,11 +730,11 @@ blob variant::as_blob()const
       case blob_type: return get_blob();
       case string_type:
       {
-         const string& str = get_string();
+         const string str = as_string();
          if( str.size() == 0 ) return blob();
          if( str.back() == '=' )
          {
-            std::string b64 = base64_decode( get_string() );
+            std::string b64 = base64_decode( str );
             return blob( { std::vector<char>( b64.begin(), b64.end() ) } );
          }
          return blob( { std::vector<char>( str.begin(), str.end() ) } );
@@ -533,7 +752,7 @@ blob variant::as_blob()const
 const variants&       variant::get_array()const
 {
   if( get_type() == array_type )
-     return **reinterpret_cast<const const_variants_ptr*>(this);
+     return payload<array_payload>( this )->value;
   FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from ${type} to Array", ("type",get_type()) );
 }
 
@@ -563,10 +782,28 @@ size_t            variant::size()const
 const string&        variant::get_string()const
 {
   if( get_type() == string_type )
-     return **reinterpret_cast<const const_string_ptr*>(this);
+  {
+     if( is_inline_string( this ) )
+        return materialized_strings::instance().get( this );
+     return payload<string_payload>( this )->value;
+  }
   FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from type '${type}' to Object", ("type",get_type()) );
 }
 
+const char*          variant::string_data()const
+{
+  if( get_type() == string_type )
+     return variant_string_data( this );
+  FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from type '${type}' to String", ("type",get_type()) );
+}
+
+size_t               variant::string_size()const
+{
+  if( get_type() == string_type )
+     return variant_string_size( this );
+  FC_THROW_EXCEPTION( bad_cast_exception, "Invalid cast from type '${type}' to String", ("type",get_type()) );
+}
+
 /// @throw if get_type() != object_type 
 const variant_object&  variant::get_object()const
 {
@@ -669,66 +906,6 @@ void from_variant( const variant& var,  std::vector<char>& vo )
 //   vo = std::vector<char>( b64.c_str(), b64.c_str() + b64.size() );
 }
 
-string      format_string( const string& format, const variant_object& args )
-{
-   stringstream ss;
-   size_t prev = 0;
-   auto next = format.find( '$' );
-   while( prev != size_t(string::npos) && prev < size_t(format.size()) ) 
-   {
-     ss << format.substr( prev, size_t(next-prev) );
-   
-     // if we got to the end, return it.
-     if( next == size_t(string::npos) ) 
-        return ss.str(); 
-   
-     // if we are not at the end, then update the start
-     prev = next + 1;
-   
-     if( format[prev] == '{' ) 
-     { 
-        // if the next char is a open, then find close
-         next = format.find( '}', prev );
-         // if we found close... 
-         if( next != size_t(string::npos) ) 
-         {
-           // the key is between prev and next
-           string key = format.substr( prev+1, (next-prev-1) );
-
-           auto val = args.find( key );
-           if( val != args.end() )
-           {
-              if( val->value().is_object() || val->value().is_array() )
-              {
-                ss << json::to_string( val->value() );
-              } 
-              else 
-              {
-                ss << val->value().as_string();
-              }
-           } 
-           else 
-           {
-              ss << "${"<<key<<"}";
-           }
-           prev = next + 1;
-           // find the next $
-           next = format.find( '$', prev );
-         } 
-         else 
-         {
-           // we didn't find it.. continue to while...
-         }
-     } 
-     else  
-     {
-        ss << format[prev];
-        ++prev;
-        next = format.find( '$', prev );
-     }
-   }
-   return ss.str();
-}
    #ifdef __APPLE__
    #elif !defined(_MSC_VER)
    void to_variant( long long int s, variant& v ) { v = variant( int64_t(s) ); }
@@ -0,0 +1,309 @@
+#include <fc/variant_arena.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/mman.h>
+#endif
+
+namespace fc
+{
+   namespace detail
+   {
+      /** arena allocations are aligned like the heap's */
+      inline size_t align_up( size_t size )
+      {
+         const size_t a = alignof(std::max_align_t);
+         return ( size + a - 1 ) / a * a;
+      }
+
+      /**
+       *  Every arena block is carved out of one reserved address range, so variant_free()
+       *  can tell arena memory from heap memory by its address and allocations need no
+       *  header.  The range is split into granules, blocks are whole granules and
+       *  _owners names the arena of each granule in use.  Pages are committed when a
+       *  block is handed out and decommitted when it is returned.  Once the range is
+       *  used up arenas fall back to the heap.
+       */
+      class block_region
+      {
+         public:
+            static const size_t granule_shift = 16;
+            static const size_t granule_size  = size_t(1) << granule_shift;
+            static const size_t region_size   = size_t(1) << ( sizeof(void*) >= 8 ? 32 : 26 );
+            static const size_t granules      = region_size >> granule_shift;
+
+            /** reserves the range on first use and never destroys it, arena memory may be freed during static destruction */
+            static block_region& instance()
+            {
+               static block_region* region = [](){
+                  block_region* r = new block_region;
+                  created().store( r, std::memory_order_release );
+                  return r;
+               }();
+               return *region;
+            }
+
+            /** @return the arena that allocated p, nullptr for heap memory */
+            static arena_state* owner( const void* p )
+            {
+               const block_region* r = created().load( std::memory_order_acquire );
+               if( r == nullptr )
+                  return nullptr;
+               const size_t offset = reinterpret_cast<uintptr_t>(p) - reinterpret_cast<uintptr_t>(r->_base);
+               if( offset >= r->_size )
+                  return nullptr;
+               return r->_owners[ offset >> granule_shift ].load( std::memory_order_relaxed );
+            }
+
+            /** @return size rounded up to whole granules, the actual size of the block */
+            static size_t block_size( size_t size )
+            {
+               return ( size + granule_size - 1 ) & ~( granule_size - 1 );
+            }
+
+            /** @return nullptr if there is no room left for a block of block_size(size) bytes */
+            char* allocate( size_t size, arena_state* owner )
+            {
+               const size_t n = block_size( size ) >> granule_shift;
+               std::lock_guard<std::mutex> lock( _mutex );
+               size_t run = 0;
+               for( size_t i = _first_free; i < _size >> granule_shift; ++i )
+               {
+                  run = _used[i] ? 0 : run + 1;
+                  if( run < n )
+                     continue;
+                  const size_t first = i + 1 - n;
+                  char* block = _base + ( first << granule_shift );
+                  if( !commit( block, n << granule_shift ) )
+                     return nullptr;
+                  for( size_t g = first; g <= i; ++g )
+                  {
+                     _used[g] = true;
+                     _owners[g].store( owner, std::memory_order_relaxed );
+                  }
+                  if( first == _first_free )
+                     _first_free = i + 1;
+                  return block;
+               }
+               return nullptr;
+            }
+
+            void free( char* block, size_t size )
+            {
+               const size_t bytes = block_size( size );
+               const size_t first = size_t( block - _base ) >> granule_shift;
+               decommit( block, bytes );
+               std::lock_guard<std::mutex> lock( _mutex );
+               for( size_t g = first; g < first + ( bytes >> granule_shift ); ++g )
+               {
+                  _used[g] = false;
+                  _owners[g].store( nullptr, std::memory_order_relaxed );
+               }
+               _first_free = std::min( _first_free, first );
+            }
+
+         private:
+            /** set once instance() has run, so processes without arenas never reserve the range */
+            static std::atomic<const block_region*>& created()
+            {
+               static std::atomic<const block_region*> region( nullptr );
+               return region;
+            }
+
+            block_region()
+            :_base( reserve( region_size ) ),_size( _base ? region_size : 0 ),
+             _owners( new std::atomic<arena_state*>[granules] ),_used( granules, false )
+            {
+               for( size_t g = 0; g < granules; ++g )
+                  _owners[g].store( nullptr, std::memory_order_relaxed );
+            }
+
+            static char* reserve( size_t size )
+            {
+#ifdef _WIN32
+               return static_cast<char*>( VirtualAlloc( nullptr, size, MEM_RESERVE, PAGE_NOACCESS ) );
+#else
+               int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+# ifdef MAP_NORESERVE
+               flags |= MAP_NORESERVE;
+# endif
+               void* base = mmap( nullptr, size, PROT_NONE, flags, -1, 0 );
+               return base == MAP_FAILED ? nullptr : static_cast<char*>( base );
+#endif
+            }
+
+            static bool commit( char* block, size_t size )
+            {
+#ifdef _WIN32
+               return VirtualAlloc( block, size, MEM_COMMIT, PAGE_READWRITE ) != nullptr;
+#else
+               return mprotect( block, size, PROT_READ | PROT_WRITE ) == 0;
+#endif
+            }
+
+            static void decommit( char* block, size_t size )
+            {
+#ifdef _WIN32
+               VirtualFree( block, size, MEM_DECOMMIT );
+#else
+               madvise( block, size, MADV_DONTNEED );
+               mprotect( block, size, PROT_NONE );
+#endif
+            }
+
+            char* const                                     _base;
+            const size_t                                    _size;
+            std::unique_ptr< std::atomic<arena_state*>[] >  _owners;
+            std::mutex                                      _mutex;
+            std::vector<bool>                               _used;
+            size_t                                          _first_free = 0;
+      };
+
+      struct arena_state
+      {
+         explicit arena_state( size_t block_size_ )
+         :block_size( block_region::block_size( block_size_ ) ),live(1){}
+
+         ~arena_state()
+         {
+            for( char* b : blocks )
+               block_region::instance().free( b, block_size );
+         }
+
+         /** @return nullptr if size should rather be allocated on the heap */
+         void* allocate( size_t size )
+         {
+            if( size > size_t(end - cursor) )
+            {
+               if( size > block_size / 4 )
+                  return nullptr;
+               char* b = block_region::instance().allocate( block_size, this );
+               if( b == nullptr )
+                  return nullptr;
+               blocks.push_back( b );
+               cursor = b;
+               end    = b + block_size;
+            }
+            void* p = cursor;
+            cursor += size;
+            used   += size;
+            live.fetch_add( 1, std::memory_order_relaxed );
+            return p;
+         }
+
+         void release()
+         {
+            if( live.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+               delete this;
+         }
+
+         const size_t        block_size;
+         std::vector<char*>  blocks;
+         char*               cursor = nullptr;
+         char*               end    = nullptr;
+         size_t              used   = 0;
+         /** allocations still in use, plus one while the variant_arena is in scope */
+         std::atomic<size_t> live;
+      };
+
+      arena_state*& current_arena()
+      {
+         #ifdef _MSC_VER
+            static __declspec(thread) arena_state* a = nullptr;
+         #else
+            static __thread arena_state* a = nullptr;
+         #endif
+         return a;
+      }
+
+      void* variant_alloc( size_t size )
+      {
+         if( arena_state* a = current_arena() )
+            if( void* p = a->allocate( align_up( size ) ) )
+               return p;
+         return ::operator new( size );
+      }
+
+      void variant_free( void* p )
+      {
+         if( p == nullptr )
+            return;
+         if( arena_state* a = block_region::owner( p ) )
+            a->release();
+         else
+            ::operator delete( p );
+      }
+
+      /** suspends the current arena so everything allocated in this scope comes from the heap */
+      struct heap_scope
+      {
+         heap_scope():_saved( current_arena() ) { current_arena() = nullptr; }
+         ~heap_scope() { current_arena() = _saved; }
+         arena_state* _saved;
+      };
+
+      variant deep_copy( const variant& v )
+      {
+         switch( v.get_type() )
+         {
+            case variant::string_type:
+               return variant( v.as_string() );
+            case variant::array_type:
+            {
+               const variants& a = v.get_array();
+               variants result;
+               result.reserve( a.size() );
+               for( const variant& e : a )
+                  result.push_back( deep_copy( e ) );
+               return variant( fc::move(result) );
+            }
+            case variant::object_type:
+            {
+               const variant_object& o = v.get_object();
+               mutable_variant_object result;
+               result.reserve( o.size() );
+               for( const variant_object::entry& e : o )
+                  result( e.key(), deep_copy( e.value() ) );
+               return variant( fc::move(result) );
+            }
+            default:
+               return v;
+         }
+      }
+   }
+
+   variant_arena::variant_arena( size_t block_size )
+   :_state( new detail::arena_state( block_size ) ),_prev( detail::current_arena() )
+   {
+      detail::current_arena() = _state;
+   }
+
+   variant_arena::~variant_arena()
+   {
+      assert( detail::current_arena() == _state );
+      detail::current_arena() = _prev;
+      _state->release();
+   }
+
+   size_t variant_arena::used()const
+   {
+      return _state->used;
+   }
+
+   variant variant_arena::copy_out( const variant& v )
+   {
+      detail::heap_scope scope;
+      return detail::deep_copy( v );
+   }
+
+} // fc
@@ -1,15 +1,212 @@
 #include <fc/variant_object.hpp>
+#include <fc/variant_arena.hpp>
 #include <fc/exception/exception.hpp>
 #include <assert.h>
+#include <cstring>
 
 
 namespace fc
 {
+   namespace detail
+   {
+      /** FNV-1a */
+      uint64_t hash_key( const char* key, size_t len )
+      {
+         uint64_t h = 14695981039346656037ull;
+         for( size_t i = 0; i < len; ++i )
+         {
+            h ^= static_cast<unsigned char>( key[i] );
+            h *= 1099511628211ull;
+         }
+         return h;
+      }
+
+      /**
+       *  Insert-only table of interned atoms.  Readers never lock; a writer claims an
+       *  empty slot with compare-and-swap.  Keys that do not fit are simply not interned.
+       */
+      class key_table
+      {
+         public:
+            const key_atom* find( const char* key, size_t len, uint64_t h )const
+            {
+               for( size_t i = 0; i < max_probe; ++i )
+               {
+                  const key_atom* a = _slots[ (h + i) & mask ].load( std::memory_order_acquire );
+                  if( a == nullptr )
+                     return nullptr;
+                  if( a->hash == h && a->str.size() == len && a->str.compare( 0, len, key, len ) == 0 )
+                     return a;
+               }
+               return nullptr;
+            }
+
+            const key_atom* intern( const char* key, size_t len, uint64_t h )
+            {
+               key_atom* created = nullptr;
+               for( size_t i = 0; i < max_probe; ++i )
+               {
+                  auto& slot = _slots[ (h + i) & mask ];
+                  const key_atom* a = slot.load( std::memory_order_acquire );
+                  if( a == nullptr )
+                  {
+                     if( created == nullptr )
+                        created = new key_atom( string( key, len ), h, true );
+                     if( slot.compare_exchange_strong( a, created, std::memory_order_acq_rel ) )
+                        return created;
+                     // another thread filled the slot first, a now holds its atom
+                  }
+                  if( a->hash == h && a->str.size() == len && a->str.compare( 0, len, key, len ) == 0 )
+                  {
+                     delete created;
+                     return a;
+                  }
+               }
+               if( created != nullptr )
+                  return created; // table is crowded, keep the atom alive without interning it
+               return new key_atom( string( key, len ), h, true );
+            }
+
+         private:
+            static const size_t capacity  = 1 << 14;
+            static const size_t mask      = capacity - 1;
+            static const size_t max_probe = 64;
+
+            std::atomic<const key_atom*> _slots[capacity] = {};
+      };
+
+      key_table& interned_keys()
+      {
+         static key_table* table = new key_table(); // never destroyed, atoms outlive static objects
+         return *table;
+      }
+
+      const key_atom* empty_key()
+      {
+         static const key_atom* a = interned_keys().intern( "", 0, hash_key( "", 0 ) );
+         return a;
+      }
+
+      const key_atom* make_key( string key )
+      {
+         uint64_t h = hash_key( key.data(), key.size() );
+         if( const key_atom* a = interned_keys().find( key.data(), key.size(), h ) )
+            return a;
+         return variant_new<key_atom>( std::move(key), h, false );
+      }
+
+      inline void retain( const key_atom* a )
+      {
+         if( !a->immortal )
+            a->refs.fetch_add( 1, std::memory_order_relaxed );
+      }
+
+      inline void release( const key_atom* a )
+      {
+         if( !a->immortal && a->refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+            variant_delete( a );
+      }
+
+      /** the entries of a variant_object, allocated in the current variant_arena if any */
+      template<typename... Args>
+      std::shared_ptr< std::vector<variant_object::entry> > make_entries( Args&&... args )
+      {
+         typedef std::vector<variant_object::entry> entries;
+         return std::allocate_shared<entries>( variant_allocator<entries>(), fc::forward<Args>(args)... );
+      }
+
+      /** open addressing table of entry positions keyed by key hash */
+      class key_index
+      {
+         public:
+            /** objects up to this size are scanned linearly */
+            static const size_t min_entries = 8;
+
+            static const size_t npos = size_t(-1);
+
+            /** indexes entries [covered(), e.size()), keeping the first position of duplicate keys */
+            void extend( const std::vector<variant_object::entry>& e )
+            {
+               if( e.size() * 2 > _slots.size() )
+               {
+                  size_t cap = 16;
+                  while( cap < e.size() * 2 ) cap <<= 1;
+                  _slots.assign( cap, 0 );
+                  _covered = 0;
+               }
+               const size_t mask = _slots.size() - 1;
+               for( ; _covered < e.size(); ++_covered )
+               {
+                  const variant_key& k = e[_covered].shared_key();
+                  for( size_t i = k.hash() & mask; ; i = (i + 1) & mask )
+                  {
+                     if( _slots[i] == 0 )
+                     {
+                        _slots[i] = uint32_t(_covered + 1);
+                        break;
+                     }
+                     if( e[_slots[i] - 1].shared_key() == k )
+                        break;
+                  }
+               }
+            }
+
+            size_t covered()const { return _covered; }
+
+            size_t find( const std::vector<variant_object::entry>& e, const char* key, size_t len, uint64_t h )const
+            {
+               const size_t mask = _slots.size() - 1;
+               for( size_t i = h & mask; _slots[i] != 0; i = (i + 1) & mask )
+               {
+                  size_t pos = _slots[i] - 1;
+                  if( e[pos].shared_key().equals( key, len, h ) )
+                     return pos;
+               }
+               return npos;
+            }
+
+         private:
+            std::vector<uint32_t> _slots;
+            size_t                _covered = 0;
+      };
+   }
+
+   // ---------------------------------------------------------------
+   // variant_key
+
+   variant_key::variant_key() : _atom( detail::empty_key() ) {}
+   variant_key::variant_key( string key ) : _atom( detail::make_key( fc::move(key) ) ) {}
+   variant_key::variant_key( const char* key ) : _atom( detail::make_key( string(key) ) ) {}
+   variant_key::variant_key( const variant_key& k ) : _atom( k._atom ) { detail::retain( _atom ); }
+   variant_key::variant_key( variant_key&& k ) : _atom( k._atom ) { detail::retain( _atom ); }
+   variant_key::~variant_key() { detail::release( _atom ); }
+
+   variant_key& variant_key::operator=( const variant_key& k )
+   {
+      detail::retain( k._atom );
+      detail::release( _atom );
+      _atom = k._atom;
+      return *this;
+   }
+
+   variant_key& variant_key::operator=( variant_key&& k )
+   {
+      std::swap( _atom, k._atom );
+      return *this;
+   }
+
+   variant_key variant_key::intern( const char* key )
+   {
+      size_t len = strlen( key );
+      return variant_key( detail::interned_keys().intern( key, len, detail::hash_key( key, len ) ) );
+   }
+
    // ---------------------------------------------------------------
    // entry
 
    variant_object::entry::entry() {}
    variant_object::entry::entry( string k, variant v ) : _key(fc::move(k)),_value(fc::move(v)) {}
+   variant_object::entry::entry( variant_key k, variant v ) : _key(fc::move(k)),_value(fc::move(v)) {}
    variant_object::entry::entry( entry&& e ) : _key(fc::move(e._key)),_value(fc::move(e._value)) {}
    variant_object::entry::entry( const entry& e ) : _key(e._key),_value(e._value) {}
    variant_object::entry& variant_object::entry::operator=( const variant_object::entry& e )
@@ -28,11 +225,6 @@ namespace fc
       return *this;
    }
    
-   const string&        variant_object::entry::key()const
-   {
-      return _key;
-   }
-
    const variant& variant_object::entry::value()const
    {
       return _value;
@@ -63,14 +255,30 @@ namespace fc
 
    variant_object::iterator variant_object::find( const string& key )const
    {
-      return find( key.c_str() );
+      return find( key.data(), key.size(), detail::hash_key( key.data(), key.size() ) );
    }
 
    variant_object::iterator variant_object::find( const char* key )const
    {
+      size_t len = strlen( key );
+      return find( key, len, detail::hash_key( key, len ) );
+   }
+
+   variant_object::iterator variant_object::find( const variant_key& key )const
+   {
+      return find( key.str().data(), key.str().size(), key.hash() );
+   }
+
+   variant_object::iterator variant_object::find( const char* key, size_t len, uint64_t hash )const
+   {
+      if( _index )
+      {
+         size_t pos = _index->find( *_key_value, key, len, hash );
+         return pos == detail::key_index::npos ? end() : begin() + pos;
+      }
       for( auto itr = begin(); itr != end(); ++itr )
       {
-         if( itr->key() == key )
+         if( itr->shared_key().equals( key, len, hash ) )
          {
             return itr;
          }
@@ -78,6 +286,18 @@ namespace fc
       return end();
    }
 
+   void variant_object::build_index()
+   {
+      if( _key_value->size() <= detail::key_index::min_entries )
+      {
+         _index.reset();
+         return;
+      }
+      auto index = std::allocate_shared<detail::key_index>( detail::variant_allocator<detail::key_index>() );
+      index->extend( *_key_value );
+      _index = std::move(index);
+   }
+
    const variant& variant_object::operator[]( const string& key )const
    {
       return (*this)[key.c_str()];
@@ -96,39 +316,42 @@ namespace fc
    }
 
    variant_object::variant_object() 
-      :_key_value(std::make_shared<std::vector<entry>>() )
+      :_key_value( detail::make_entries() )
    {
    }
 
    variant_object::variant_object( string key, variant val )
-      : _key_value(std::make_shared<std::vector<entry>>())
+      : _key_value( detail::make_entries() )
    {
        //_key_value->push_back(entry(fc::move(key), fc::move(val)));
        _key_value->emplace_back(entry(fc::move(key), fc::move(val)));
    }
 
    variant_object::variant_object( const variant_object& obj )
-   :_key_value( obj._key_value )
+   :_key_value( obj._key_value ),_index( obj._index )
    {
       assert( _key_value != nullptr );
    }
 
    variant_object::variant_object( variant_object&& obj)
-   : _key_value( fc::move(obj._key_value) )
+   : _key_value( fc::move(obj._key_value) ),_index( fc::move(obj._index) )
    {
-      obj._key_value = std::make_shared<std::vector<entry>>();
+      obj._key_value = detail::make_entries();
       assert( _key_value != nullptr );
    }
 
    variant_object::variant_object( const mutable_variant_object& obj )
-      : _key_value(std::make_shared<std::vector<entry>>(*obj._key_value))
+      : _key_value( detail::make_entries( *obj._key_value ) )
    {
+      build_index();
    }
 
    variant_object::variant_object( mutable_variant_object&& obj )
-   : _key_value(fc::move(obj._key_value))
+   : _key_value( detail::make_entries( fc::move(*obj._key_value) ) )
    {
-      assert( _key_value != nullptr );
+      obj._key_value->clear();
+      obj._index.reset();
+      build_index();
    }
 
    variant_object& variant_object::operator=( variant_object&& obj )
@@ -136,6 +359,7 @@ namespace fc
       if (this != &obj)
       {
          fc_swap(_key_value, obj._key_value );
+         fc_swap(_index, obj._index );
          assert( _key_value != nullptr );
       }
       return *this;
@@ -146,20 +370,25 @@ namespace fc
       if (this != &obj)
       {
          _key_value = obj._key_value;
+         _index = obj._index;
       }
       return *this;
    }
 
    variant_object& variant_object::operator=( mutable_variant_object&& obj )
    {
-      _key_value = fc::move(obj._key_value);
-      obj._key_value.reset( new std::vector<entry>() );
+      _key_value = detail::make_entries( fc::move(*obj._key_value) );
+      obj._key_value->clear();
+      obj._index.reset();
+      build_index();
       return *this;
    }
 
    variant_object& variant_object::operator=( const mutable_variant_object& obj )
    {
-      *_key_value = *obj._key_value;
+      // other copies may share the current entries, so never assign through _key_value
+      _key_value = detail::make_entries( *obj._key_value );
+      build_index();
       return *this;
    }
 
@@ -199,14 +428,30 @@ namespace fc
 
    mutable_variant_object::iterator mutable_variant_object::find( const string& key )const
    {
-      return find( key.c_str() );
+      return find( key.data(), key.size(), detail::hash_key( key.data(), key.size() ) );
    }
 
    mutable_variant_object::iterator mutable_variant_object::find( const char* key )const
    {
+      size_t len = strlen( key );
+      return find( key, len, detail::hash_key( key, len ) );
+   }
+
+   mutable_variant_object::iterator mutable_variant_object::find( const variant_key& key )const
+   {
+      return find( key.str().data(), key.str().size(), key.hash() );
+   }
+
+   mutable_variant_object::iterator mutable_variant_object::find( const char* key, size_t len, uint64_t hash )const
+   {
+      if( _index )
+      {
+         size_t pos = _index->find( *_key_value, key, len, hash );
+         return pos == detail::key_index::npos ? end() : begin() + pos;
+      }
       for( auto itr = begin(); itr != end(); ++itr )
       {
-         if( itr->key() == key )
+         if( itr->shared_key().equals( key, len, hash ) )
          {
             return itr;
          }
@@ -216,19 +461,12 @@ namespace fc
 
    mutable_variant_object::iterator mutable_variant_object::find( const string& key )
    {
-      return find( key.c_str() );
+      return static_cast<const mutable_variant_object*>(this)->find( key );
    }
 
    mutable_variant_object::iterator mutable_variant_object::find( const char* key )
    {
-      for( auto itr = begin(); itr != end(); ++itr )
-      {
-         if( itr->key() == key )
-         {
-            return itr;
-         }
-      }
-      return end();
+      return static_cast<const mutable_variant_object*>(this)->find( key );
    }
 
    const variant& mutable_variant_object::operator[]( const string& key )const
@@ -251,10 +489,31 @@ namespace fc
    {
       auto itr = find( key );
       if( itr != end() ) return itr->value();
-      _key_value->emplace_back(entry(key, variant()));
+      append( entry( key, variant() ) );
       return _key_value->back().value();
    }
 
+   void mutable_variant_object::append( entry e )
+   {
+      _key_value->emplace_back( fc::move(e) );
+      if( _index )
+         _index->extend( *_key_value );
+      else if( _key_value->size() > detail::key_index::min_entries )
+         build_index();
+   }
+
+   void mutable_variant_object::build_index()
+   {
+      if( _key_value->size() <= detail::key_index::min_entries )
+      {
+         _index.reset();
+         return;
+      }
+      auto index = std::make_shared<detail::key_index>();
+      index->extend( *_key_value );
+      _index = std::move(index);
+   }
+
    size_t mutable_variant_object::size() const
    {
       return _key_value->size();
@@ -274,21 +533,28 @@ namespace fc
    mutable_variant_object::mutable_variant_object( const variant_object& obj )
       : _key_value( new std::vector<entry>(*obj._key_value) )
    {
+      build_index();
    }
 
    mutable_variant_object::mutable_variant_object( const mutable_variant_object& obj )
       : _key_value( new std::vector<entry>(*obj._key_value) )
    {
+      build_index();
    }
 
    mutable_variant_object::mutable_variant_object( mutable_variant_object&& obj )
-      : _key_value(fc::move(obj._key_value))
+      : _key_value(fc::move(obj._key_value)),_index(fc::move(obj._index))
+   {
+   }
+
+   mutable_variant_object::~mutable_variant_object()
    {
    }
 
    mutable_variant_object& mutable_variant_object::operator=( const variant_object& obj )
    {
       *_key_value = *obj._key_value;
+      build_index();
       return *this;
    }
 
@@ -297,6 +563,7 @@ namespace fc
       if (this != &obj)
       {
          _key_value = fc::move(obj._key_value);
+         _index = fc::move(obj._index);
       }
       return *this;
    }
@@ -306,6 +573,7 @@ namespace fc
       if (this != &obj)
       {
          *_key_value = *obj._key_value;
+         build_index();
       }
       return *this;
    }
@@ -317,27 +585,39 @@ namespace fc
 
    void  mutable_variant_object::erase( const string& key )
    {
-      for( auto itr = begin(); itr != end(); ++itr )
+      auto itr = find( key );
+      if( itr != end() )
       {
-         if( itr->key() == key )
-         {
-            _key_value->erase(itr);
-            return;
-         }
+         _key_value->erase(itr);
+         build_index();
       }
    }
 
    /** replaces the value at \a key with \a var or insert's \a key if not found */
    mutable_variant_object& mutable_variant_object::set( string key, variant var )
    {
-      auto itr = find( key.c_str() );
+      auto itr = find( key );
+      if( itr != end() )
+      {
+         itr->set( fc::move(var) );
+      }
+      else
+      {
+         append( entry( fc::move(key), fc::move(var) ) );
+      }
+      return *this;
+   }
+
+   mutable_variant_object& mutable_variant_object::set( variant_key key, variant var )
+   {
+      auto itr = find( key );
       if( itr != end() )
       {
          itr->set( fc::move(var) );
       }
       else
       {
-         _key_value->push_back( entry( fc::move(key), fc::move(var) ) );
+         append( entry( fc::move(key), fc::move(var) ) );
       }
       return *this;
    }
@@ -347,7 +627,7 @@ namespace fc
     */
    mutable_variant_object& mutable_variant_object::operator()( string key, variant var )
    {
-      _key_value->push_back( entry( fc::move(key), fc::move(var) ) );
+      append( entry( fc::move(key), fc::move(var) ) );
       return *this;
    }
 
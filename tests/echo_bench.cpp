@@ -0,0 +1,99 @@
+#include <fc/asio.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/network/ip.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/time.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+   struct echo_result
+   {
+      uint64_t           round_trips = 0;
+      fc::microseconds   elapsed;
+   };
+
+   /** echoes one connection from a server and a client fiber of the current thread */
+   echo_result run_echo( size_t message_size, const fc::microseconds& duration )
+   {
+      fc::tcp_server server;
+      server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+      const uint16_t port = server.get_port();
+
+      fc::future<void> echo = fc::async( [&]()
+      {
+         fc::tcp_socket sock;
+         server.accept( sock );
+         std::vector<char> buf( message_size );
+         try
+         {
+            for( ;; )
+            {
+               size_t n = sock.readsome( buf.data(), buf.size() );
+               sock.write( buf.data(), n );
+            }
+         }
+         catch( const fc::eof_exception& ) {}
+      }, "echo server" );
+
+      fc::tcp_socket client;
+      client.connect_to( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), port ) );
+      std::vector<char> out( message_size, 'x' );
+      std::vector<char> in( message_size );
+
+      echo_result r;
+      const fc::time_point start = fc::time_point::now();
+      const fc::time_point end   = start + duration;
+      while( fc::time_point::now() < end )
+      {
+         client.write( out.data(), out.size() );
+         client.read( in.data(), in.size() );
+         ++r.round_trips;
+      }
+      r.elapsed = fc::time_point::now() - start;
+      client.close();
+      try { echo.wait(); } catch( ... ) {}
+      return r;
+   }
+}
+
+/**
+ *  Measures loopback echo throughput of fc::tcp_socket with the sockets on the shared
+ *  default_io_service() ("shared") or on an io_service run by the fc::thread of the
+ *  fibers using them ("thread", see fc::asio::enable_thread_io_service()).
+ *
+ *  echo_bench [shared|thread|both] [message size] [seconds]
+ */
+int main( int argc, char** argv )
+{
+   const std::string mode    = argc > 1 ? argv[1] : "both";
+   const size_t message_size = argc > 2 ? std::stoull( argv[2] ) : 4096;
+   const int64_t seconds     = argc > 3 ? std::stoll( argv[3] ) : 5;
+
+   std::vector<bool> own_io;
+   if( mode != "thread" )
+      own_io.push_back( false );
+   if( mode != "shared" )
+      own_io.push_back( true );
+
+   for( bool own : own_io )
+   {
+      fc::thread bench( own ? "echo_thread_io" : "echo_shared_io" );
+      echo_result r = bench.async( [&]()
+      {
+         if( own )
+            fc::asio::enable_thread_io_service();
+         return run_echo( message_size, fc::seconds( seconds ) );
+      }, "echo bench" ).wait();
+      bench.quit();
+
+      const double secs = double( r.elapsed.count() ) / 1000000;
+      std::cout << ( own ? "thread io_service: " : "shared io_service: " )
+                << uint64_t( r.round_trips / secs ) << " round trips/s, "
+                << ( 2.0 * r.round_trips * message_size / secs / (1024*1024) ) << " MiB/s, "
+                << ( r.elapsed.count() * 1000.0 / r.round_trips ) << " ns per round trip\n";
+   }
+   return 0;
+}
@@ -0,0 +1,34 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/format_template.hpp>
+
+#include <string.h>
+
+using namespace fc;
+
+BOOST_AUTO_TEST_SUITE(format_template_tests)
+
+BOOST_AUTO_TEST_CASE(cache_is_keyed_by_text)
+{
+   const variant_object args = mutable_variant_object( "a", 1 )( "b", "two" );
+
+   char first[32];
+   char second[32];
+   strcpy( first, "${a} and ${b}" );
+   strcpy( second, "${a} and ${b}" );
+   const format_template* t = format_template::for_literal( first );
+   BOOST_REQUIRE( t != nullptr );
+   BOOST_CHECK( format_template::for_literal( second ) == t );
+   BOOST_CHECK( format_template::for_literal( "${a} and ${b}" ) == t );
+   BOOST_CHECK_EQUAL( t->format( args ), "1 and two" );
+
+   // the same buffer holding different text gets its own template
+   strcpy( first, "${b}/${a}" );
+   const format_template* other = format_template::for_literal( first );
+   BOOST_REQUIRE( other != nullptr );
+   BOOST_CHECK( other != t );
+   BOOST_CHECK_EQUAL( other->format( args ), "two/1" );
+   BOOST_CHECK_EQUAL( t->format( args ), "1 and two" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
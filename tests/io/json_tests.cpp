@@ -0,0 +1,378 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/io/json_document.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/rpc/state.hpp>
+#include <fc/variant_object.hpp>
+
+#include <string>
+
+namespace {
+   /** the escaping of the byte at a time writer that escape_string replaced */
+   std::string reference_escape( const std::string& str )
+   {
+      static const char hex[] = "0123456789abcdef";
+      std::string out = "\"";
+      for( char c : str )
+      {
+         switch( c )
+         {
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\\': out += "\\\\"; break;
+            case '"':  out += "\\\""; break;
+            default:
+               if( static_cast<unsigned char>(c) < 0x20 )
+                  out += std::string( "\\u00" ) + hex[c >> 4] + hex[c & 0xf];
+               else
+                  out += c;
+         }
+      }
+      return out + '"';
+   }
+
+   /** the pretty printer that re-scanned the output of json::to_string(), before the single pass writer */
+   std::string reference_pretty_print( const std::string& v, uint8_t indent )
+   {
+      int level = 0;
+      std::string ss;
+      bool first = false;
+      bool quote = false;
+      bool escape = false;
+      for( uint32_t i = 0; i < v.size(); ++i ) {
+         switch( v[i] ) {
+            case '\\':
+              if( !escape ) {
+                if( quote )
+                  escape = true;
+              } else { escape = false; }
+              ss += v[i];
+              break;
+            case ':':
+              ss += quote ? ":" : ": ";
+              break;
+            case '"':
+              if( first ) {
+                 ss += '\n' + std::string( level * indent, ' ' );
+                 first = false;
+              }
+              if( !escape )
+                quote = !quote;
+              escape = false;
+              ss += '"';
+              break;
+            case '{':
+            case '[':
+              ss += v[i];
+              if( !quote ) {
+                ++level;
+                first = true;
+              } else {
+                escape = false;
+              }
+              break;
+            case '}':
+            case ']':
+              if( !quote ) {
+                if( v[i-1] != '[' && v[i-1] != '{' )
+                  ss += '\n';
+                --level;
+                if( !first )
+                  ss += std::string( level * indent, ' ' );
+                first = false;
+              } else {
+                escape = false;
+              }
+              ss += v[i];
+              break;
+            case ',':
+              if( quote )
+                escape = false;
+              else
+                first = true;
+              ss += ',';
+              break;
+            case 'n':
+              if( quote && escape )
+                escape = false;
+              // fall through
+            default:
+              if( first ) {
+                 ss += '\n' + std::string( level * indent, ' ' );
+                 first = false;
+              }
+              ss += v[i];
+         }
+      }
+      return ss;
+   }
+
+   std::string nested_arrays( uint32_t depth, const std::string& inner = "1" )
+   {
+      return std::string( depth, '[' ) + inner + std::string( depth, ']' );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(json_tests)
+
+BOOST_AUTO_TEST_CASE(json_document_depth_matches_from_string)
+{
+   const uint32_t max_depth = fc::json::default_limits().effective_max_depth();
+   for( uint32_t depth : { 1u, max_depth / 2 + 1, max_depth - 1 } )
+   {
+      // strict input is indexed directly, lenient input after normalization
+      for( const std::string& inner : { std::string("1"), std::string("nothing") } )
+      {
+         const std::string text = nested_arrays( depth, inner );
+         fc::json::from_string( text );
+         fc::json_document doc = fc::json_document::from_string( text );
+         fc::json_value v = doc.root();
+         for( uint32_t i = 0; i < depth; ++i )
+         {
+            BOOST_REQUIRE( v.is_array() );
+            v = v[0];
+         }
+         BOOST_CHECK_EQUAL( v.as_string(), inner );
+      }
+   }
+   BOOST_CHECK_THROW( fc::json::from_string( nested_arrays( max_depth ) ), fc::parse_error_exception );
+   BOOST_CHECK_THROW( fc::json_document::from_string( nested_arrays( max_depth ) ), fc::parse_error_exception );
+   BOOST_CHECK_THROW( fc::json_document::from_string( nested_arrays( max_depth, "nothing" ) ), fc::exception );
+}
+
+BOOST_AUTO_TEST_CASE(lazy_method_called_with_variants)
+{
+   fc::rpc::state rpc;
+   rpc.add_lazy_method( "echo", []( const fc::json_value& args ) -> fc::variant
+   {
+      BOOST_REQUIRE( args.is_array() );
+      BOOST_REQUIRE_EQUAL( args.size(), 2u );
+      BOOST_CHECK( args[0].is_string() );
+      BOOST_CHECK( args[1].is_object() );
+      BOOST_CHECK( args[1].contains( "b" ) );
+      BOOST_CHECK( !args[1].contains( "c" ) );
+      BOOST_CHECK_EQUAL( args[1]["b"].as_uint64(), 2u );
+      BOOST_CHECK_EQUAL( args[1].raw(), "{\"b\":2}" );
+      return args[0].as_string();
+   });
+
+   fc::variants params;
+   params.emplace_back( "hello" );
+   params.emplace_back( fc::mutable_variant_object( "b", 2 ) );
+   BOOST_CHECK_EQUAL( rpc.local_call( "echo", params ).as_string(), "hello" );
+
+   // the same method through the document path
+   fc::json_document doc = fc::json_document::from_string( "[\"hello\",{\"b\":2}]" );
+   BOOST_CHECK_EQUAL( rpc.local_call( "echo", doc.root() ).as_string(), "hello" );
+}
+
+namespace {
+   /** parses with the relaxed parser when the text is not strict JSON */
+   bool accepted( const std::string& text, const fc::json::limits& l )
+   {
+      try
+      {
+         fc::json::from_string( text, fc::json::relaxed_parser, l );
+         BOOST_CHECK( fc::json::is_valid( text, fc::json::relaxed_parser, l ) );
+         return true;
+      }
+      catch( const fc::parse_error_exception& )
+      {
+         BOOST_CHECK( !fc::json::is_valid( text, fc::json::relaxed_parser, l ) );
+         return false;
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(default_depth_limit)
+{
+   BOOST_CHECK( accepted( nested_arrays( 99 ), fc::json::default_limits() ) );
+   BOOST_CHECK( !accepted( nested_arrays( 100 ), fc::json::default_limits() ) );
+   BOOST_CHECK( accepted( nested_arrays( 99, "x" ), fc::json::default_limits() ) );
+   BOOST_CHECK( !accepted( nested_arrays( 100, "x" ), fc::json::default_limits() ) );
+}
+
+BOOST_AUTO_TEST_CASE(depth_limit)
+{
+   fc::json::limits l;
+   l.max_depth = 4;
+   BOOST_CHECK( accepted( "[[[1]]]", l ) );
+   BOOST_CHECK( !accepted( "[[[[1]]]]", l ) );
+   BOOST_CHECK( accepted( "[{\"a\":[1]}]", l ) );
+   BOOST_CHECK( !accepted( "[{\"a\":[[1]]}]", l ) );
+   // not strict JSON
+   BOOST_CHECK( accepted( "[[[x]]]", l ) );
+   BOOST_CHECK( !accepted( "[[[[x]]]]", l ) );
+   // closing brackets inside a string do not hide nesting
+   BOOST_CHECK( accepted( "[\"]]]]\",[[x]]]", l ) );
+   BOOST_CHECK( !accepted( "[\"]]]]\",[[[x]]]]", l ) );
+}
+
+BOOST_AUTO_TEST_CASE(string_length_limit)
+{
+   fc::json::limits l;
+   l.max_string_length = 5;
+   BOOST_CHECK( accepted( "[\"abcde\"]", l ) );
+   BOOST_CHECK( !accepted( "[\"abcdef\"]", l ) );
+   BOOST_CHECK( !accepted( "{\"abcdef\":1}", l ) );
+   // not strict JSON
+   BOOST_CHECK( accepted( "[abcde]", l ) );
+   BOOST_CHECK( !accepted( "[abcdef]", l ) );
+   BOOST_CHECK( accepted( "[\"abcde\",x]", l ) );
+   BOOST_CHECK( !accepted( "[\"abcdef\",x]", l ) );
+   BOOST_CHECK( !accepted( "{\"abcdef\":x}", l ) );
+}
+
+BOOST_AUTO_TEST_CASE(element_limit)
+{
+   fc::json::limits l;
+   l.max_elements = 3;
+   BOOST_CHECK( accepted( "[1,2]", l ) );
+   BOOST_CHECK( !accepted( "[1,2,3]", l ) );
+   BOOST_CHECK( accepted( "{\"a\":1,\"b\":2}", l ) ); // keys are not counted
+   BOOST_CHECK( !accepted( "{\"a\":1,\"b\":[2]}", l ) );
+   // not strict JSON
+   BOOST_CHECK( accepted( "[1,x]", l ) );
+   BOOST_CHECK( !accepted( "[1,x,y]", l ) );
+   BOOST_CHECK( accepted( "{\"a\":x,\"b\":y}", l ) );
+   BOOST_CHECK( !accepted( "{\"a\":x,\"b\":[y]}", l ) );
+}
+
+BOOST_AUTO_TEST_CASE(size_limit)
+{
+   fc::json::limits l;
+   l.max_bytes = 7;
+   BOOST_CHECK( accepted( "[1,2,3]", l ) );
+   BOOST_CHECK( !accepted( "[1,2,3,4]", l ) );
+   // not strict JSON
+   BOOST_CHECK( accepted( "[a,b,c]", l ) );
+   BOOST_CHECK( !accepted( "[a,b,c,d]", l ) );
+}
+
+BOOST_AUTO_TEST_CASE(parallel_parse)
+{
+   // large enough to be split over the thread pool
+   std::string array = "[";
+   std::string lines;
+   for( uint64_t i = 0; array.size() < 3*1024*1024; ++i )
+   {
+      const std::string value = "{\"i\":" + std::to_string( i ) + ",\"s\":\"a, [b]\"}";
+      array += ( i ? "," : "" ) + value;
+      lines += value + "\n";
+   }
+   array += "]";
+
+   const fc::variants expected = fc::json::from_string( array ).get_array();
+   for( uint32_t threads : { 1u, 0u, 3u } )
+   {
+      const fc::variants from_array = fc::json::parallel_variants_from_string( array, fc::json::top_level_array,
+                                                                               fc::json::legacy_parser, threads );
+      const fc::variants from_lines = fc::json::parallel_variants_from_string( lines, fc::json::newline_delimited,
+                                                                               fc::json::legacy_parser, threads );
+      BOOST_REQUIRE_EQUAL( from_array.size(), expected.size() );
+      BOOST_REQUIRE_EQUAL( from_lines.size(), expected.size() );
+      for( size_t i = 0; i < expected.size(); i += 997 )
+      {
+         BOOST_CHECK_EQUAL( from_array[i]["i"].as_uint64(), i );
+         BOOST_CHECK_EQUAL( from_lines[i]["i"].as_uint64(), i );
+      }
+   }
+
+   BOOST_CHECK_EQUAL( fc::json::parallel_variants_from_string( "[1,2]  \n", fc::json::top_level_array ).size(), 2u );
+   BOOST_CHECK_THROW( fc::json::parallel_variants_from_string( "[1,2] x", fc::json::top_level_array ), fc::parse_error_exception );
+   BOOST_CHECK_THROW( fc::json::parallel_variants_from_string( "[1,2]]", fc::json::top_level_array ), fc::parse_error_exception );
+   BOOST_CHECK_THROW( fc::json::parallel_variants_from_string( array + "[]", fc::json::top_level_array ), fc::parse_error_exception );
+   BOOST_CHECK_THROW( fc::json::parallel_variants_from_string( "[1,2", fc::json::top_level_array ), fc::parse_error_exception );
+}
+
+BOOST_AUTO_TEST_CASE(parallel_parse_honors_the_parser)
+{
+   // a single quoted key is only accepted by the relaxed parser, in either layout
+   const std::string lines = "{\"a\":1}\n\n{'b':2}\n";
+   const std::string array = "[{\"a\":1},{'b':2}]";
+   BOOST_CHECK_THROW( fc::json::parallel_variants_from_string( lines, fc::json::newline_delimited, fc::json::strict_parser ),
+                      fc::parse_error_exception );
+   BOOST_CHECK_THROW( fc::json::parallel_variants_from_string( array, fc::json::top_level_array, fc::json::strict_parser ),
+                      fc::parse_error_exception );
+
+   const fc::variants from_lines = fc::json::parallel_variants_from_string( lines, fc::json::newline_delimited,
+                                                                            fc::json::relaxed_parser );
+   const fc::variants from_array = fc::json::parallel_variants_from_string( array, fc::json::top_level_array,
+                                                                            fc::json::relaxed_parser );
+   BOOST_REQUIRE_EQUAL( from_lines.size(), 2u );
+   BOOST_REQUIRE_EQUAL( from_array.size(), 2u );
+   BOOST_CHECK_EQUAL( from_lines[1]["b"].as_int64(), 2 );
+   BOOST_CHECK_EQUAL( from_array[1]["b"].as_int64(), 2 );
+
+   const std::string strict = "{\"a\":1}\r\n[true]\n";
+   BOOST_CHECK_EQUAL( fc::json::parallel_variants_from_string( strict, fc::json::newline_delimited, fc::json::strict_parser ).size(), 2u );
+}
+
+BOOST_AUTO_TEST_CASE(escape_string)
+{
+   // every byte alone, and at every offset of a string long enough for the vectorized scan
+   for( int c = 0; c < 256; ++c )
+   {
+      const std::string one( 1, char(c) );
+      BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( one ) ), reference_escape( one ) );
+   }
+   const std::string specials( "\0\x01\x07\b\t\n\x0b\f\r\x1f\"\\\x7f\x80\xff", 15 );
+   for( size_t offset = 0; offset < 40; ++offset )
+      for( char c : specials )
+      {
+         std::string s( 48, 'a' );
+         s[offset] = c;
+         s[47 - offset / 2] = c;
+         BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( s ) ), reference_escape( s ) );
+      }
+
+   BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( std::string( "say \"hi\"\\\n\x01" ) ) ),
+                      "\"say \\\"hi\\\"\\\\\\n\\u0001\"" );
+   // invalid UTF-8 is written through as is
+   const std::string invalid( "\xc3\x28 \xa0\xa1 \xf0\x28\x8c\xbc \xc3\xa9" );
+   BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( invalid ) ), '"' + invalid + '"' );
+   // keys are escaped too
+   fc::mutable_variant_object o;
+   o( "a\"b\tc", 1 );
+   BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( o ) ), "{\"a\\\"b\\tc\":1}" );
+}
+
+BOOST_AUTO_TEST_CASE(pretty_string)
+{
+   fc::mutable_variant_object inner;
+   inner( "empty_object", fc::variant_object() )
+        ( "empty_array", fc::variants() )
+        ( "list", fc::variants{ fc::variant( 1 ), fc::variant( "two" ), fc::variants{ fc::variant( 3 ), fc::variants() } } )
+        ( "text", "with: {brackets}, [commas] and \"quotes\\\"" );
+   fc::mutable_variant_object outer;
+   outer( "inner", inner )
+        ( "null", fc::variant() )
+        ( "flag", true )
+        ( "big", uint64_t(1) << 40 )
+        ( "objects", fc::variants{ fc::variant( inner ), fc::variant( fc::variant_object() ) } );
+
+   BOOST_CHECK_EQUAL( fc::json::to_pretty_string( fc::variant( inner ) ),
+      "{\n"
+      "  \"empty_object\": {},\n"
+      "  \"empty_array\": [],\n"
+      "  \"list\": [\n"
+      "    1,\n"
+      "    \"two\",[\n"
+      "      3,[]\n"
+      "    ]\n"
+      "  ],\n"
+      "  \"text\": \"with: {brackets}, [commas] and \\\"quotes\\\\\\\"\"\n"
+      "}" );
+
+   const fc::variant values[] = { fc::variant( outer ), fc::variant( inner ), fc::variant( fc::variants() ),
+                                  fc::variant( fc::variant_object() ), fc::variant( 42 ), fc::variant( "plain" ),
+                                  fc::variant( fc::variants{ fc::variant( outer ), fc::variant( fc::variants{} ) } ) };
+   for( const fc::variant& v : values )
+      BOOST_CHECK_EQUAL( fc::json::to_pretty_string( v ), reference_pretty_print( fc::json::to_string( v ), 2 ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
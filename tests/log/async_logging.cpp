@@ -0,0 +1,114 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/log/logger_config.hpp>
+#include <fc/log/appender.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace {
+   class counting_appender : public fc::appender
+   {
+      public:
+         virtual void log( const fc::log_message& m ) { ++count; }
+         std::atomic<uint64_t> count{0};
+   };
+}
+
+BOOST_AUTO_TEST_SUITE(async_logging_tests)
+
+BOOST_AUTO_TEST_CASE(flush_on_error_is_opt_in)
+{
+   BOOST_CHECK( !fc::async_logging_config().flush_on_error );
+}
+
+BOOST_AUTO_TEST_CASE(no_message_lost_while_reconfiguring)
+{
+   fc::shared_ptr<counting_appender> counter( new counting_appender() );
+   fc::logger lgr = fc::logger::get( "async_logging_test" );
+   lgr.set_log_level( fc::log_level::all );
+   lgr.add_appender( counter );
+
+   fc::logging_config cfg;
+   cfg.async.enabled    = true;
+   cfg.async.queue_size = 64;
+   cfg.async.overflow   = fc::async_logging_config::overflow_policy::block;
+   fc::configure_logging( cfg );
+
+   const int per_thread = 2000;
+   std::vector<fc::thread*> threads;
+   std::vector< fc::future<void> > done;
+   for( int t = 0; t < 3; ++t )
+   {
+      threads.push_back( new fc::thread( "async_logging_test" ) );
+      done.push_back( threads.back()->async( [lgr, per_thread]() mutable {
+         for( int i = 0; i < per_thread; ++i )
+            lgr.log( FC_LOG_MESSAGE( info, "message ${i}", ("i",i) ) );
+      }));
+   }
+   // every reconfiguration stops the writer the producers are pushing to
+   for( int i = 0; i < 10; ++i )
+   {
+      fc::usleep( fc::milliseconds(2) );
+      fc::configure_logging( cfg );
+   }
+   for( auto& d : done )
+      d.wait();
+   fc::flush_logging();
+   BOOST_CHECK_EQUAL( counter->count.load(), uint64_t( 3 * per_thread ) );
+
+   for( auto* t : threads )
+   {
+      t->quit();
+      delete t;
+   }
+   fc::configure_logging( fc::logging_config() );
+}
+
+BOOST_AUTO_TEST_CASE(cached_logger_survives_reconfiguration)
+{
+   fc::logging_config cfg;
+   fc::logger_config lc( "cached_logger_test" );
+   lc.level = fc::log_level::all;
+   cfg.loggers.push_back( lc );
+   fc::configure_logging( cfg );
+
+   static fc::cached_logger& cached = *new fc::cached_logger( "cached_logger_test" );
+   std::vector<fc::thread*> threads;
+   std::vector< fc::future<uint64_t> > done;
+   for( int t = 0; t < 3; ++t )
+   {
+      threads.push_back( new fc::thread( "cached_logger_test" ) );
+      done.push_back( threads.back()->async( []() {
+         uint64_t enabled = 0;
+         for( int i = 0; i < 20000; ++i )
+            if( cached.is_enabled( fc::log_level::debug ) )
+            {
+               fc::logger lgr = cached.get();
+               lgr.log( FC_LOG_MESSAGE( debug, "message ${i}", ("i",i) ) );
+               ++enabled;
+            }
+         return enabled;
+      }));
+   }
+   // every reconfiguration releases the loggers the call sites have cached
+   for( int i = 0; i < 20; ++i )
+   {
+      fc::usleep( fc::milliseconds(1) );
+      fc::configure_logging( cfg );
+   }
+   for( auto& d : done )
+      BOOST_CHECK_EQUAL( d.wait(), uint64_t(20000) );
+
+   for( auto* t : threads )
+   {
+      t->quit();
+      delete t;
+   }
+   fc::configure_logging( fc::logging_config() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/log/file_appender.hpp>
+#include <fc/log/logger_config.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/reflect/variant.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/variant.hpp>
+
+#include <fstream>
+#include <string>
+
+BOOST_AUTO_TEST_SUITE(file_appender_tests)
+
+BOOST_AUTO_TEST_CASE(buffered_messages_are_flushed_periodically)
+{
+   fc::temp_directory dir;
+   fc::file_appender::config cfg( dir.path() / "buffered.log" );
+   cfg.format         = "${message}";
+   cfg.flush          = false;
+   cfg.flush_interval = fc::milliseconds( 20 );
+
+   fc::shared_ptr<fc::file_appender> appender( new fc::file_appender( fc::variant( cfg ) ) );
+   appender->log( FC_LOG_MESSAGE( info, "first" ) );
+
+   std::string contents;
+   for( int i = 0; i < 200 && contents.find( "first" ) == std::string::npos; ++i )
+   {
+      fc::usleep( fc::milliseconds( 20 ) );
+      fc::read_file_contents( cfg.filename, contents );
+   }
+   BOOST_CHECK( contents.find( "first" ) != std::string::npos );
+
+   // still flushing after the first round
+   appender->log( FC_LOG_MESSAGE( info, "second" ) );
+   for( int i = 0; i < 200 && contents.find( "second" ) == std::string::npos; ++i )
+   {
+      fc::usleep( fc::milliseconds( 20 ) );
+      fc::read_file_contents( cfg.filename, contents );
+   }
+   BOOST_CHECK( contents.find( "second" ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE(destroy_while_flushing)
+{
+   fc::temp_directory dir;
+   fc::file_appender::config cfg( dir.path() / "short_lived.log" );
+   cfg.format         = "${message}";
+   cfg.flush          = false;
+   cfg.flush_interval = fc::milliseconds( 15 );
+
+   // the flush task must be gone before the appender it writes for
+   for( int i = 0; i < 40; ++i )
+   {
+      fc::shared_ptr<fc::file_appender> appender( new fc::file_appender( fc::variant( cfg ) ) );
+      appender->log( FC_LOG_MESSAGE( info, "message ${i}", ("i",i) ) );
+      if( i % 2 )
+         fc::usleep( fc::milliseconds( 20 ) );
+   }
+
+   std::string contents;
+   fc::read_file_contents( cfg.filename, contents );
+   BOOST_CHECK( contents.find( "message 39" ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE(flush_logging_writes_out_buffered_messages)
+{
+   fc::temp_directory dir;
+   for( bool async : { false, true } )
+   {
+      fc::file_appender::config cfg( dir.path() / ( async ? "async.log" : "sync.log" ) );
+      cfg.format         = "${message}";
+      cfg.flush          = false;
+      cfg.flush_interval = fc::microseconds();  // nothing writes the buffer out on its own
+
+      fc::logging_config lc;
+      lc.appenders.push_back( fc::appender_config( "buffered", "file", fc::variant( cfg ) ) );
+      lc.async.enabled = async;
+      fc::configure_logging( lc );
+      fc::appender::ptr appender = fc::appender::get( "buffered" );
+      BOOST_REQUIRE( appender );
+
+      appender->log( FC_LOG_MESSAGE( info, "buffered" ) );
+      appender->flush();
+      std::string contents;
+      fc::read_file_contents( cfg.filename, contents );
+      BOOST_CHECK( contents.empty() );
+
+      fc::flush_logging();
+      fc::read_file_contents( cfg.filename, contents );
+      BOOST_CHECK( contents.find( "buffered" ) != std::string::npos );
+   }
+   fc::configure_logging( fc::logging_config() );
+}
+
+BOOST_AUTO_TEST_CASE(rotated_files_are_compressed)
+{
+   fc::temp_directory dir;
+   fc::file_appender::config cfg( dir.path() / "rotating.log" );
+   cfg.format            = "${message}";
+   cfg.rotate            = true;
+   cfg.rotation_interval = fc::hours( 1 );
+   cfg.rotation_limit    = fc::hours( 24 );
+   cfg.compress          = true;
+
+   // a file left by the previous interval
+   const fc::time_point_sec previous( fc::time_point::now() - fc::hours( 2 ) );
+   const fc::path old_file = dir.path() / ( "rotating.log." + previous.to_non_delimited_iso_string() );
+   {
+      std::ofstream out( old_file.string() );
+      out << "an old message\n";
+   }
+
+   fc::shared_ptr<fc::file_appender> appender( new fc::file_appender( fc::variant( cfg ) ) );
+   const fc::path compressed = old_file.string() + ".zlib";
+   for( int i = 0; i < 250 && fc::exists( old_file ); ++i )
+      fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !fc::exists( old_file ) );
+   BOOST_CHECK( fc::exists( compressed ) );
+
+   appender->log( FC_LOG_MESSAGE( info, "current" ) );
+   std::string contents;
+   fc::read_file_contents( cfg.filename, contents );
+   BOOST_CHECK( contents.find( "current" ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
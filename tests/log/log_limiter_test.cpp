@@ -0,0 +1,161 @@
+#include <boost/test/unit_test.hpp>
+
+#define DEFAULT_LOGGER "log_limiter_test"
+#include <fc/log/logger.hpp>
+#include <fc/log/appender.hpp>
+#include <fc/thread/scoped_lock.hpp>
+#include <fc/thread/spin_lock.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+   /** keeps the formatted messages, the limiters report from the log maintenance thread */
+   class recording_appender : public fc::appender
+   {
+      public:
+         virtual void log( const fc::log_message& m )
+         {
+            fc::scoped_lock<fc::spin_lock> lock( _lock );
+            _messages.push_back( m.get_message() );
+         }
+
+         std::vector<std::string> take()
+         {
+            fc::scoped_lock<fc::spin_lock> lock( _lock );
+            std::vector<std::string> taken;
+            taken.swap( _messages );
+            return taken;
+         }
+
+      private:
+         fc::spin_lock            _lock;
+         std::vector<std::string> _messages;
+   };
+
+   fc::shared_ptr<recording_appender> recorder()
+   {
+      static fc::shared_ptr<recording_appender> r = [](){
+         fc::shared_ptr<recording_appender> a( new recording_appender() );
+         fc::logger lgr = fc::logger::get( DEFAULT_LOGGER );
+         lgr.set_log_level( fc::log_level::all );
+         lgr.add_appender( a );
+         return a;
+      }();
+      return r;
+   }
+
+   /** the total of the "suppressed ${n} more messages" reports among messages */
+   uint64_t suppressed_in( const std::vector<std::string>& messages, const std::string& format )
+   {
+      const std::string prefix = "suppressed ";
+      const std::string suffix = " more messages like \"" + format + "\"";
+      uint64_t total = 0;
+      for( const std::string& m : messages )
+         if( m.compare( 0, prefix.size(), prefix ) == 0 && m.size() > suffix.size() &&
+             m.compare( m.size() - suffix.size(), suffix.size(), suffix ) == 0 )
+            total += std::stoull( m.substr( prefix.size() ) );
+      return total;
+   }
+
+   /**
+    *  Starts a fresh rate() window and runs calls in it, again if the once a second tick
+    *  on the log maintenance thread started another window part way through.
+    */
+   template<typename Calls>
+   void in_one_window( Calls&& calls )
+   {
+      for( int attempt = 0; attempt < 10; ++attempt )
+      {
+         fc::detail::tick_log_limiters();
+         recorder()->take();
+         const uint32_t tick = fc::detail::log_limiter_tick.load();
+         calls();
+         if( fc::detail::log_limiter_tick.load() == tick )
+            return;
+      }
+      BOOST_FAIL( "the log limiters kept ticking during the calls" );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(log_limiter_tests)
+
+BOOST_AUTO_TEST_CASE(every_n)
+{
+   FC_LOG_SITE( info );
+   fc::cached_logger& cached = *new fc::cached_logger( DEFAULT_LOGGER );
+   fc::log_limiter& limiter = *new fc::log_limiter( cached, fc_log_site, "every_n" );
+   int passed = 0;
+   for( int i = 0; i < 100; ++i )
+      if( limiter.every_n( 7 ) )
+      {
+         BOOST_CHECK_EQUAL( i % 7, 0 );
+         ++passed;
+      }
+   BOOST_CHECK_EQUAL( passed, 15 );
+   // 0 and 1 both let every call through
+   BOOST_CHECK( limiter.every_n( 1 ) && limiter.every_n( 1 ) );
+   BOOST_CHECK( limiter.every_n( 0 ) && limiter.every_n( 0 ) );
+
+   recorder()->take();
+   for( int i = 0; i < 100; ++i )
+      wlog_every_n( 10, "every tenth ${i}", ("i",i) );
+   const std::vector<std::string> messages = recorder()->take();
+   BOOST_REQUIRE_EQUAL( messages.size(), 10u );
+   for( size_t i = 0; i < messages.size(); ++i )
+      BOOST_CHECK_EQUAL( messages[i], "every tenth " + std::to_string( i * 10 ) );
+}
+
+BOOST_AUTO_TEST_CASE(rate)
+{
+   FC_LOG_SITE( info );
+   fc::cached_logger& cached = *new fc::cached_logger( DEFAULT_LOGGER );
+   fc::log_limiter& limiter = *new fc::log_limiter( cached, fc_log_site, "rate" );
+
+   int passed = 0;
+   in_one_window( [&]() {
+      passed = 0;
+      for( int i = 0; i < 10; ++i )
+         passed += limiter.rate( 3 );
+   });
+   BOOST_CHECK_EQUAL( passed, 3 );
+   BOOST_CHECK( !limiter.rate( 3 ) );
+
+   // the tick reports what was held back and opens the next window
+   fc::detail::tick_log_limiters();
+   BOOST_CHECK_EQUAL( suppressed_in( recorder()->take(), "rate" ), 8u );
+   BOOST_CHECK( limiter.rate( 3 ) );
+
+   // nothing held back, nothing reported
+   fc::detail::tick_log_limiters();
+   BOOST_CHECK_EQUAL( suppressed_in( recorder()->take(), "rate" ), 0u );
+}
+
+BOOST_AUTO_TEST_CASE(log_limited)
+{
+   std::vector<std::string> messages;
+   in_one_window( [&]() {
+      for( int i = 0; i < 10; ++i )
+         wlog_rate( 2, "rated ${i}", ("i",i) );
+      messages = recorder()->take();
+   });
+   BOOST_REQUIRE_EQUAL( messages.size(), 2u );
+   BOOST_CHECK_EQUAL( messages[0], "rated 0" );
+   BOOST_CHECK_EQUAL( messages[1], "rated 1" );
+
+   fc::detail::tick_log_limiters();
+   messages = recorder()->take();
+   BOOST_CHECK_EQUAL( suppressed_in( messages, "rated ${i}" ), 8u );
+
+   // a disabled level is neither logged nor counted
+   fc::logger::get( DEFAULT_LOGGER ).set_log_level( fc::log_level::error );
+   in_one_window( [&]() {
+      for( int i = 0; i < 10; ++i )
+         wlog_rate( 2, "disabled ${i}", ("i",i) );
+   });
+   fc::detail::tick_log_limiters();
+   fc::logger::get( DEFAULT_LOGGER ).set_log_level( fc::log_level::all );
+   BOOST_CHECK( recorder()->take().empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
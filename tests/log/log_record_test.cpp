@@ -0,0 +1,126 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/log/log_record.hpp>
+#include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/variant_object.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+   /** compares a decoded record with the message FC_LOG_MESSAGE builds for the same statement */
+   void check_same( const fc::log_message& decoded, const fc::log_message& expected )
+   {
+      const fc::log_context dc = decoded.get_context();
+      const fc::log_context ec = expected.get_context();
+      BOOST_CHECK( dc.get_log_level() == ec.get_log_level() );
+      BOOST_CHECK_EQUAL( dc.get_file(), ec.get_file() );
+      BOOST_CHECK_EQUAL( dc.get_line_number(), ec.get_line_number() );
+      BOOST_CHECK_EQUAL( dc.get_method(), ec.get_method() );
+      BOOST_CHECK_EQUAL( dc.get_thread_name(), ec.get_thread_name() );
+      BOOST_CHECK_EQUAL( dc.get_task_name(), ec.get_task_name() );
+      BOOST_CHECK( dc.get_timestamp() <= ec.get_timestamp() );
+      BOOST_CHECK( ec.get_timestamp() - dc.get_timestamp() < fc::seconds( 1 ) );
+
+      BOOST_CHECK_EQUAL( decoded.get_format(), expected.get_format() );
+      const fc::variant_object dd = decoded.get_data();
+      const fc::variant_object ed = expected.get_data();
+      BOOST_REQUIRE_EQUAL( dd.size(), ed.size() );
+      for( auto d = dd.begin(), e = ed.begin(); d != dd.end(); ++d, ++e )
+      {
+         BOOST_CHECK_EQUAL( d->key(), e->key() );
+         BOOST_CHECK_EQUAL( d->value().get_type(), e->value().get_type() );
+      }
+      BOOST_CHECK_EQUAL( fc::json::to_string( dd ), fc::json::to_string( ed ) );
+      BOOST_CHECK_EQUAL( decoded.get_message(), expected.get_message() );
+   }
+}
+
+/** the record and the message of one statement, on one line so both see the same __LINE__ */
+#define RECORD_AND_MESSAGE( LEVEL, FORMAT, ARGS ) \
+   FC_LOG_SITE( LEVEL ); const fc::log_record record = FC_LOG_RECORD( FORMAT, ARGS ); const fc::log_message message = FC_LOG_MESSAGE( LEVEL, FORMAT, ARGS )
+
+BOOST_AUTO_TEST_SUITE(log_record_tests)
+
+BOOST_AUTO_TEST_CASE(scalars)
+{
+   const int8_t   i8  = -8;
+   const int16_t  i16 = -1600;
+   const int32_t  i32 = -320000;
+   const int64_t  i64 = -6400000000ll;
+   const uint8_t  u8  = 8;
+   const uint16_t u16 = 1600;
+   const uint32_t u32 = 4000000000u;
+   const uint64_t u64 = 18446744073709551615ull;
+   RECORD_AND_MESSAGE( warn, "${i8} ${i16} ${i32} ${i64} ${u8} ${u16} ${u32} ${u64} ${b} ${f} ${d}",
+                       ("i8",i8)("i16",i16)("i32",i32)("i64",i64)("u8",u8)("u16",u16)("u32",u32)("u64",u64)
+                       ("b",true)("f",1.5f)("d",-0.25) );
+   BOOST_CHECK( record.get_log_level() == fc::log_level::warn );
+   check_same( record.to_log_message(), message );
+}
+
+BOOST_AUTO_TEST_CASE(strings_and_variants)
+{
+   const std::string s( "a \"quoted\" string" );
+   const std::vector<int> numbers{ 1, 2, 3 };
+   fc::mutable_variant_object obj;
+   obj( "x", 1 )( "y", "two" );
+   RECORD_AND_MESSAGE( error, "${c} ${s} ${empty} ${v} ${n} ${o} ${null} ${missing}",
+                       ("c","literal")("s",s)("empty",std::string())("v",fc::variant( 42 ))("n",numbers)
+                       ("o",fc::variant_object( obj ))("null",fc::variant()) );
+   check_same( record.to_log_message(), message );
+}
+
+BOOST_AUTO_TEST_CASE(formats)
+{
+   {
+      // a format that is not a literal is not compiled
+      const std::string format = "runtime ${x}";
+      RECORD_AND_MESSAGE( info, format, ("x",1) );
+      check_same( record.to_log_message(), message );
+   }
+   {
+      RECORD_AND_MESSAGE( debug, "no arguments", );
+      check_same( record.to_log_message(), message );
+   }
+   {
+      // a char array is cut at its null, not at its size
+      const char format[32] = "short ${x}";
+      FC_LOG_SITE( info );
+      const fc::log_message decoded = fc::log_record( fc_log_site, format )( "x", 3 ).to_log_message();
+      BOOST_CHECK_EQUAL( decoded.get_format(), "short ${x}" );
+      BOOST_CHECK_EQUAL( decoded.get_message(), "short 3" );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(arguments_beyond_the_inline_buffer)
+{
+   // the record moves from its inline buffer to the heap part way through the arguments
+   const std::string big( 150, 'b' );
+   fc::mutable_variant_object args;
+   for( int i = 0; i < 20; ++i )
+      args( "k" + std::to_string( i ), i % 2 ? fc::variant( big ) : fc::variant( i ) );
+   RECORD_AND_MESSAGE( warn, "${k0} ${k1} ${k19}", ("first",big)("second",big)(fc::variant_object( args )) );
+   check_same( record.to_log_message(), message );
+
+   // copies are independent of the original
+   fc::log_record copy( record );
+   fc::log_record assigned;
+   assigned = record;
+   check_same( copy.to_log_message(), message );
+   check_same( assigned.to_log_message(), message );
+}
+
+BOOST_AUTO_TEST_CASE(thread_and_task)
+{
+   fc::thread other( "log_record_thread" );
+   other.async( [](){
+      RECORD_AND_MESSAGE( info, "on ${t}", ("t","another thread") );
+      BOOST_CHECK_EQUAL( record.to_log_message().get_context().get_thread_name(), "log_record_thread" );
+      check_same( record.to_log_message(), message );
+   }, "log_record_task" ).wait();
+   other.quit();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
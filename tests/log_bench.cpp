@@ -0,0 +1,36 @@
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+#include <iostream>
+
+/**
+ *  Measures what a logging statement costs when its level is disabled, which is what
+ *  most dlog and ilog calls cost in production.
+ */
+int main( int argc, char** argv )
+{
+   const int64_t n = argc > 1 ? std::stoll( argv[1] ) : 10000000;
+   fc::logger::get().set_log_level( fc::log_level::error );
+
+   int64_t sum = 0;
+   auto start = fc::time_point::now();
+   for( int64_t i = 0; i < n; ++i )
+   {
+      dlog( "disabled ${i} ${sum}", ("i",i)("sum",sum) );
+      sum += i;
+   }
+   auto cached = fc::time_point::now() - start;
+
+   start = fc::time_point::now();
+   for( int64_t i = 0; i < n; ++i )
+   {
+      if( fc::logger::get( "default" ).is_enabled( fc::log_level::debug ) )
+         fc::logger::get( "default" ).log( FC_LOG_MESSAGE( debug, "disabled ${i} ${sum}", ("i",i)("sum",sum) ) );
+      sum += i;
+   }
+   auto lookup = fc::time_point::now() - start;
+
+   std::cout << "disabled dlog with cached logger:    " << double(cached.count()) * 1000 / n << " ns/call\n";
+   std::cout << "disabled dlog with logger::get(name): " << double(lookup.count()) * 1000 / n << " ns/call\n";
+   std::cout << "(checksum " << sum << ")\n";
+   return 0;
+}
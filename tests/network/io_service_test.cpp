@@ -0,0 +1,103 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/asio.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+
+// Runs in its own executable: the default io_service is configured once per process,
+// before anything uses it, and the test cases below run in order.
+
+namespace {
+   const uint32_t shards = 3;
+
+   /** @return the name of the thread that ran a handler posted to io */
+   std::string thread_of( boost::asio::io_service& io )
+   {
+      fc::promise<std::string>::ptr p( new fc::promise<std::string>( "io_service_test" ) );
+      io.post( [p]() { p->set_value( fc::thread::current().name() ); } );
+      return fc::future<std::string>( p ).wait( fc::seconds( 5 ) );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(io_service_tests)
+
+BOOST_AUTO_TEST_CASE(configure_before_first_use)
+{
+   BOOST_CHECK( fc::asio::get_default_io_service_stats().empty() );
+
+   fc::asio::io_service_config config;
+   config.threads = 1;
+   fc::asio::configure_default_io_service( config );
+   // the last configuration before the first use wins
+   config.threads    = shards;
+   config.per_thread = true;
+   fc::asio::configure_default_io_service( config );
+   BOOST_CHECK( fc::asio::get_default_io_service_stats().empty() );
+}
+
+BOOST_AUTO_TEST_CASE(default_io_service_is_stable)
+{
+   boost::asio::io_service& first = fc::asio::default_io_service();
+   for( int i = 0; i < 10; ++i )
+      BOOST_CHECK( &fc::asio::default_io_service() == &first );
+   BOOST_CHECK_EQUAL( thread_of( first ), "asio_0" );
+}
+
+BOOST_AUTO_TEST_CASE(next_io_service_round_robins)
+{
+   const std::vector<fc::asio::io_service_stats> before = fc::asio::get_default_io_service_stats();
+   BOOST_REQUIRE_EQUAL( before.size(), shards );
+
+   std::vector<boost::asio::io_service*> handed_out;
+   for( uint32_t i = 0; i < 4 * shards; ++i )
+      handed_out.push_back( &fc::asio::next_io_service() );
+   std::set<boost::asio::io_service*> distinct( handed_out.begin(), handed_out.end() );
+   BOOST_CHECK_EQUAL( distinct.size(), shards );
+   BOOST_CHECK( distinct.count( &fc::asio::default_io_service() ) );
+   for( uint32_t i = shards; i < handed_out.size(); ++i )
+      BOOST_CHECK( handed_out[i] == handed_out[i - shards] );
+
+   // each shard runs on a thread of its own
+   std::set<std::string> threads;
+   for( uint32_t i = 0; i < shards; ++i )
+      threads.insert( thread_of( *handed_out[i] ) );
+   BOOST_CHECK_EQUAL( threads.size(), shards );
+
+   const std::vector<fc::asio::io_service_stats> after = fc::asio::get_default_io_service_stats();
+   BOOST_REQUIRE_EQUAL( after.size(), shards );
+   for( uint32_t i = 0; i < shards; ++i )
+   {
+      BOOST_CHECK_EQUAL( after[i].assigned - before[i].assigned, 4u );
+      BOOST_CHECK( after[i].handlers > before[i].handlers );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(stats_follow_the_configuration)
+{
+   const std::vector<fc::asio::io_service_stats> stats = fc::asio::get_default_io_service_stats();
+   BOOST_REQUIRE_EQUAL( stats.size(), shards );
+   uint32_t threads = 0;
+   for( const auto& s : stats )
+   {
+      BOOST_CHECK_EQUAL( s.threads, 1u );
+      BOOST_CHECK( s.max_queue_depth >= s.queue_depth );
+      BOOST_CHECK( s.busy_time >= fc::microseconds() );
+      threads += s.threads;
+   }
+   BOOST_CHECK_EQUAL( threads, shards );
+}
+
+BOOST_AUTO_TEST_CASE(configure_after_first_use_is_rejected)
+{
+   fc::asio::io_service_config config;
+   config.threads = 2;
+   BOOST_CHECK_THROW( fc::asio::configure_default_io_service( config ), fc::assert_exception );
+   BOOST_CHECK_EQUAL( fc::asio::get_default_io_service_stats().size(), shards );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,217 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/thread/channel.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(channel_tests)
+
+BOOST_AUTO_TEST_CASE(ring_stress)
+{
+   const int      threads = 4;
+   const uint64_t per_producer = 100000;
+   fc::detail::mpmc_ring<uint64_t> ring( 64 );
+
+   std::atomic<uint64_t> received_sum( 0 );
+   std::atomic<uint64_t> received_count( 0 );
+   std::vector<std::thread> workers;
+   for( int p = 0; p < threads; ++p )
+      workers.emplace_back( [&ring,p]() {
+         for( uint64_t i = 1; i <= per_producer; ++i )
+         {
+            uint64_t v = uint64_t(p) * per_producer + i;
+            while( !ring.try_push( v ) )
+               std::this_thread::yield();
+         }
+      });
+   for( int c = 0; c < threads; ++c )
+      workers.emplace_back( [&]() {
+         uint64_t v;
+         while( received_count.load() < threads * per_producer )
+         {
+            if( ring.try_pop( v ) )
+            {
+               received_sum += v;
+               ++received_count;
+            }
+            else
+               std::this_thread::yield();
+         }
+      });
+   for( auto& w : workers )
+      w.join();
+
+   const uint64_t n = threads * per_producer;
+   BOOST_CHECK_EQUAL( received_count.load(), n );
+   BOOST_CHECK_EQUAL( received_sum.load(), n * ( n + 1 ) / 2 );
+   BOOST_CHECK_EQUAL( ring.size(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE(send_waits_for_room)
+{
+   fc::channel<int> ch( 2 );
+   fc::thread producer( "channel_tests" );
+   fc::future<void> sent = producer.async( [&ch]() {
+      for( int i = 0; i < 100; ++i )
+         ch.send( i );
+   });
+
+   fc::usleep( fc::milliseconds( 20 ) );
+   // the producer fills the channel, then waits
+   BOOST_CHECK_EQUAL( ch.size(), ch.capacity() );
+   BOOST_CHECK( !sent.ready() );
+
+   for( int i = 0; i < 100; ++i )
+   {
+      int v = -1;
+      BOOST_REQUIRE( ch.receive( v, fc::seconds( 5 ) ) );
+      BOOST_CHECK_EQUAL( v, i );
+      BOOST_CHECK( ch.size() <= ch.capacity() );
+   }
+   sent.wait();
+   BOOST_CHECK( ch.empty() );
+   producer.quit();
+}
+
+BOOST_AUTO_TEST_CASE(timeouts)
+{
+   fc::channel<int> ch( 2 );
+   int v = 0;
+   BOOST_CHECK( !ch.try_receive( v ) );
+   BOOST_CHECK( !ch.receive( v, fc::milliseconds( 20 ) ) );
+
+   BOOST_CHECK( ch.send( 1, fc::milliseconds( 20 ) ) );
+   BOOST_CHECK( ch.send( 2, fc::milliseconds( 20 ) ) );
+   BOOST_CHECK( !ch.try_send( 3 ) );
+   BOOST_CHECK( !ch.send( 3, fc::milliseconds( 20 ) ) );
+
+   // a receive from another thread wakes the waiting sender
+   fc::thread consumer( "channel_tests" );
+   fc::future<int> first = consumer.schedule( [&ch]() { int r = 0; ch.receive( r ); return r; },
+                                              fc::time_point::now() + fc::milliseconds( 20 ) );
+   BOOST_CHECK( ch.send( 3, fc::seconds( 5 ) ) );
+   BOOST_CHECK_EQUAL( first.wait(), 1 );
+   BOOST_CHECK( ch.receive( v ) && v == 2 );
+   BOOST_CHECK( ch.receive( v ) && v == 3 );
+   consumer.quit();
+}
+
+BOOST_AUTO_TEST_CASE(close_wakes_waiters)
+{
+   fc::thread other( "channel_tests" );
+
+   fc::channel<int> empty( 2 );
+   fc::future<bool> receiving = other.async( [&empty]() { int v; return empty.receive( v ); } );
+   fc::channel<int> full( 2 );
+   full.send( 1 );
+   full.send( 2 );
+   fc::future<void> sending = other.async( [&full]() { full.send( 3 ); } );
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !receiving.ready() );
+   BOOST_CHECK( !sending.ready() );
+
+   empty.close();
+   BOOST_CHECK( !receiving.wait( fc::seconds( 5 ) ) );
+   full.close();
+   BOOST_CHECK_THROW( sending.wait( fc::seconds( 5 ) ), fc::eof_exception );
+
+   // what was sent before the close is still received, then the end is reported
+   BOOST_CHECK_THROW( full.send( 4 ), fc::eof_exception );
+   BOOST_CHECK( full.receivable() );
+   std::vector<int> items;
+   BOOST_CHECK_EQUAL( full.receive( items, 10 ), 2u );
+   BOOST_CHECK_EQUAL( full.receive( items, 10 ), 0u );
+   int v = 0;
+   BOOST_CHECK( !full.receive( v ) );
+   other.quit();
+}
+
+BOOST_AUTO_TEST_CASE(batches)
+{
+   fc::channel<int> ch( 8 );
+   std::vector<int> items;
+   BOOST_CHECK_THROW( ch.receive( items, 0 ), fc::assert_exception );
+
+   fc::thread producer( "channel_tests" );
+   std::vector<int> values;
+   for( int i = 0; i < 20; ++i )
+      values.push_back( i );
+   // more than fits, so the batch send waits for the receives
+   fc::future<void> sent = producer.async( [&]() { ch.send( values.begin(), values.end() ); } );
+
+   while( items.size() < values.size() )
+   {
+      const size_t before = items.size();
+      const size_t n = ch.receive( items, 3 );
+      BOOST_REQUIRE( n >= 1 && n <= 3 );
+      BOOST_REQUIRE_EQUAL( items.size(), before + n );
+   }
+   sent.wait();
+   BOOST_CHECK( items == values );
+   producer.quit();
+}
+
+BOOST_AUTO_TEST_CASE(select_channels)
+{
+   fc::channel<int> a( 2 );
+   fc::channel<int> b( 2 );
+   const std::vector<fc::detail::channel_base*> both{ &a, &b };
+   BOOST_CHECK_EQUAL( fc::select( both, fc::milliseconds( 20 ) ), -1 );
+
+   fc::thread other( "channel_tests" );
+   other.schedule( [&b]() { b.send( 7 ); }, fc::time_point::now() + fc::milliseconds( 20 ) );
+   BOOST_CHECK_EQUAL( fc::select( both, fc::seconds( 5 ) ), 1 );
+   int v = 0;
+   BOOST_CHECK( b.try_receive( v ) && v == 7 );
+
+   // a closed channel is receivable too
+   other.schedule( [&a]() { a.close(); }, fc::time_point::now() + fc::milliseconds( 20 ) );
+   BOOST_CHECK_EQUAL( fc::select( both, fc::seconds( 5 ) ), 0 );
+   BOOST_CHECK( a.closed() );
+   other.quit();
+}
+
+BOOST_AUTO_TEST_CASE(fibers_on_several_threads)
+{
+   // a small channel, so senders and receivers on every thread keep waiting for each other
+   fc::channel<uint64_t> ch( 4 );
+   const uint64_t per_sender = 2000;
+   std::vector< std::unique_ptr<fc::thread> > threads;
+   std::vector< fc::future<void> > senders;
+   std::vector< fc::future<uint64_t> > receivers;
+   for( int t = 0; t < 2; ++t )
+   {
+      threads.emplace_back( new fc::thread( "channel_tests" ) );
+      for( int f = 0; f < 2; ++f )
+      {
+         const uint64_t first = uint64_t( t * 2 + f ) * per_sender + 1;
+         senders.push_back( threads.back()->async( [&ch,first,per_sender]() {
+            for( uint64_t i = first; i < first + per_sender; ++i )
+               ch.send( i );
+         }));
+         receivers.push_back( threads.back()->async( [&ch]() {
+            uint64_t sum = 0, v;
+            while( ch.receive( v ) )
+               sum += v;
+            return sum;
+         }));
+      }
+   }
+
+   for( auto& s : senders )
+      s.wait();
+   ch.close();
+   uint64_t sum = 0;
+   for( auto& r : receivers )
+      sum += r.wait();
+   const uint64_t n = 4 * per_sender;
+   BOOST_CHECK_EQUAL( sum, n * ( n + 1 ) / 2 );
+   for( auto& t : threads )
+      t->quit();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
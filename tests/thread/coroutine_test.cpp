@@ -0,0 +1,136 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/thread/coroutine.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <string>
+
+#ifndef FC_HAS_COROUTINES
+# error coroutine_test must be built with coroutine support
+#endif
+
+namespace {
+   fc::task_co<int> add_one( fc::promise<int>::ptr p )
+   {
+      co_return co_await p + 1;
+   }
+
+   fc::task_co<fc::thread*> on_other_thread( fc::thread& other )
+   {
+      fc::thread* there = co_await other.async( [](){ return &fc::thread::current(); } );
+      BOOST_CHECK( there == &other );
+      // resumed where it suspended
+      co_return &fc::thread::current();
+   }
+
+   fc::task_co<> sum( fc::promise<int>::ptr a, fc::promise<int>::ptr b, int& result )
+   {
+      result = co_await add_one( a ) + co_await add_one( b );
+   }
+
+   fc::task_co<std::string> catch_error( fc::promise<int>::ptr p )
+   {
+      try
+      {
+         co_await p;
+      }
+      catch( const fc::assert_exception& e )
+      {
+         co_return std::string( "caught" );
+      }
+      co_return std::string( "missed" );
+   }
+
+   fc::task_co<> fail()
+   {
+      FC_ASSERT( false, "fails in the coroutine" );
+      co_return;
+   }
+
+   fc::task_co<> wait_forever( fc::promise<void>::ptr never, bool& resumed )
+   {
+      co_await never;
+      resumed = true;
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(coroutine_tests)
+
+BOOST_AUTO_TEST_CASE(co_await_a_promise)
+{
+   fc::promise<int>::ptr p( new fc::promise<int>( "value" ) );
+   fc::task_co<int> t = add_one( p );
+   // started from the ready queue, then suspended on p
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !t.ready() );
+   p->set_value( 41 );
+   BOOST_CHECK_EQUAL( t.wait(), 42 );
+
+   // a promise that is ready already does not suspend
+   fc::promise<int>::ptr ready( new fc::promise<int>( "ready" ) );
+   ready->set_value( 1 );
+   BOOST_CHECK_EQUAL( add_one( ready ).get_future().wait(), 2 );
+}
+
+BOOST_AUTO_TEST_CASE(co_await_a_future_from_another_thread)
+{
+   fc::thread other( "coroutine_tests" );
+   BOOST_CHECK( on_other_thread( other ).wait() == &fc::thread::current() );
+   other.quit();
+}
+
+BOOST_AUTO_TEST_CASE(task_co_void_awaits_other_tasks)
+{
+   fc::promise<int>::ptr a( new fc::promise<int>( "a" ) );
+   fc::promise<int>::ptr b( new fc::promise<int>( "b" ) );
+   int result = 0;
+   fc::task_co<> t = sum( a, b, result );
+   fc::usleep( fc::milliseconds( 20 ) );
+   b->set_value( 20 );
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !t.ready() );
+   a->set_value( 10 );
+   t.wait();
+   BOOST_CHECK_EQUAL( result, 32 );
+}
+
+BOOST_AUTO_TEST_CASE(exceptions)
+{
+   fc::promise<int>::ptr p( new fc::promise<int>( "error" ) );
+   fc::task_co<std::string> t = catch_error( p );
+   p->set_exception( std::make_shared<fc::assert_exception>( FC_LOG_MESSAGE( error, "set by the test" ) ) );
+   BOOST_CHECK_EQUAL( t.wait(), "caught" );
+
+   BOOST_CHECK_THROW( fail().wait(), fc::assert_exception );
+}
+
+BOOST_AUTO_TEST_CASE(cancel_before_start)
+{
+   fc::promise<void>::ptr never( new fc::promise<void>( "never" ) );
+   bool resumed = false;
+   fc::task_co<> t = wait_forever( never, resumed );
+   t.cancel( "canceled by the test" );
+   BOOST_CHECK_THROW( t.wait(), fc::canceled_exception );
+   BOOST_CHECK( !resumed );
+}
+
+BOOST_AUTO_TEST_CASE(cancel_wakes_a_suspended_task)
+{
+   fc::promise<void>::ptr never( new fc::promise<void>( "never" ) );
+   bool resumed = false;
+   fc::task_co<> t = wait_forever( never, resumed );
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !t.ready() );
+
+   t.cancel( "canceled by the test" );
+   BOOST_CHECK_THROW( t.get_future().wait( fc::seconds( 5 ) ), fc::canceled_exception );
+   BOOST_CHECK( !resumed );
+
+   // completing the promise afterwards must not resume the finished coroutine
+   never->set_value();
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !resumed );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
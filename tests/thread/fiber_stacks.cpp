@@ -0,0 +1,120 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+
+#include <vector>
+
+namespace {
+   /** uses about bytes of stack, running it on a smaller stack hits the guard page */
+   size_t touch_stack( size_t bytes )
+   {
+      volatile char buffer[16 * 1024];
+      for( size_t i = 0; i < sizeof(buffer); i += 256 )
+         buffer[i] = char(i);
+      size_t touched = sizeof(buffer);
+      if( bytes > sizeof(buffer) )
+         touched += touch_stack( bytes - sizeof(buffer) );
+      // keeps the frame alive across the call
+      buffer[0] = char(touched);
+      return touched;
+   }
+
+   /** polls until pred() holds, for up to a second */
+   template<typename Pred>
+   bool eventually( Pred&& pred )
+   {
+      for( int i = 0; i < 50 && !pred(); ++i )
+         fc::usleep( fc::milliseconds( 20 ) );
+      return pred();
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(fiber_stacks)
+
+BOOST_AUTO_TEST_CASE(per_task_stack_size)
+{
+   fc::thread t( "fiber_stacks" );
+   BOOST_CHECK( t.async( [](){ return touch_stack( 32 * 1024 ); }, "small", fc::priority(), 64 * 1024 ).wait() >= 32 * 1024 );
+   // more than the default FC_CONTEXT_STACK_SIZE
+   BOOST_CHECK( t.async( [](){ return touch_stack( 3 * 1024 * 1024 ); }, "big", fc::priority(), 4 * 1024 * 1024 ).wait()
+                >= 3 * 1024 * 1024 );
+   BOOST_CHECK( t.async( [](){ return touch_stack( 1024 * 1024 ); }, "default" ).wait() >= 1024 * 1024 );
+   t.quit();
+}
+
+BOOST_AUTO_TEST_CASE(small_fiber_leaves_a_big_task_to_a_bigger_one)
+{
+   fc::thread t( "fiber_stacks" );
+   for( int i = 0; i < 10; ++i )
+   {
+      // the fiber created for the small task finds the big one next in the queue
+      fc::future<size_t> small = t.async( [](){ return touch_stack( 16 * 1024 ); }, "small", fc::priority(), 64 * 1024 );
+      fc::future<size_t> big = t.async( [](){
+         return fc::get_fiber_stack_stats().live_bytes >= 1024 * 1024 ? touch_stack( 768 * 1024 ) : 0;
+      }, "big", fc::priority(), 1024 * 1024 );
+      BOOST_CHECK( small.wait() >= 16 * 1024 );
+      BOOST_CHECK( big.wait() >= 768 * 1024 );
+   }
+   t.quit();
+}
+
+BOOST_AUTO_TEST_CASE(idle_fibers_beyond_the_limit_exit)
+{
+   fc::thread t( "fiber_stacks" );
+   t.async( [](){} ).wait();
+   const uint64_t before = fc::get_fiber_stack_stats().live_stacks;
+
+   // every blocked task holds a fiber of its own
+   const int blocked = FC_MAX_IDLE_CONTEXTS + 40;
+   std::vector< fc::promise<void>::ptr > releases;
+   std::vector< fc::future<void> > tasks;
+   for( int i = 0; i < blocked; ++i )
+   {
+      releases.emplace_back( new fc::promise<void>( "release" ) );
+      fc::future<void> release( releases.back() );
+      tasks.push_back( t.async( [release]() mutable { release.wait(); }, "blocked", fc::priority(), 64 * 1024 ) );
+   }
+   t.async( [](){} ).wait();
+   BOOST_CHECK( fc::get_fiber_stack_stats().live_stacks >= before + blocked );
+
+   for( auto& r : releases )
+      r->set_value();
+   for( auto& task : tasks )
+      task.wait();
+   t.async( [](){} ).wait();
+   // at most FC_MAX_IDLE_CONTEXTS stay parked, plus the one processing tasks
+   BOOST_CHECK( eventually( [&](){
+      return fc::get_fiber_stack_stats().live_stacks <= before + FC_MAX_IDLE_CONTEXTS + 1;
+   }));
+   t.quit();
+}
+
+BOOST_AUTO_TEST_CASE(stack_stats)
+{
+   const fc::fiber_stack_stats before = fc::get_fiber_stack_stats();
+   {
+      fc::thread t( "fiber_stacks" );
+      std::vector< fc::future<void> > tasks;
+      for( int i = 0; i < 8; ++i )
+         tasks.push_back( t.async( [](){ fc::usleep( fc::milliseconds( 50 ) ); }, "sleeping", fc::priority(), 64 * 1024 ) );
+      t.async( [](){} ).wait();
+
+      const fc::fiber_stack_stats running = fc::get_fiber_stack_stats();
+      BOOST_CHECK( running.live_stacks >= before.live_stacks + 8 );
+      BOOST_CHECK( running.live_bytes >= before.live_bytes + 8 * 64 * 1024 );
+      BOOST_CHECK( running.live_bytes >= running.live_stacks * FC_CONTEXT_MIN_STACK_SIZE );
+      BOOST_CHECK( running.pooled_bytes >= running.pooled_stacks * FC_CONTEXT_MIN_STACK_SIZE );
+
+      for( auto& task : tasks )
+         task.wait();
+      t.quit();
+   }
+   // the exited thread's fibers and pooled stacks are gone
+   BOOST_CHECK( eventually( [&](){
+      const fc::fiber_stack_stats after = fc::get_fiber_stack_stats();
+      return after.live_stacks <= before.live_stacks && after.pooled_stacks <= before.pooled_stacks;
+   }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
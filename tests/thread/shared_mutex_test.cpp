@@ -0,0 +1,158 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/thread/shared_mutex.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(shared_mutex_tests)
+
+BOOST_AUTO_TEST_CASE(shared_and_exclusive)
+{
+   fc::shared_mutex m;
+   BOOST_CHECK( m.try_lock_shared() );
+   BOOST_CHECK( m.try_lock_shared() );
+   BOOST_CHECK( !m.try_lock() );
+   m.unlock_shared();
+   BOOST_CHECK( !m.try_lock() );
+   m.unlock_shared();
+
+   BOOST_CHECK( m.try_lock() );
+   BOOST_CHECK( !m.try_lock() );
+   BOOST_CHECK( !m.try_lock_shared() );
+   m.unlock();
+   BOOST_CHECK( m.try_lock() );
+   m.unlock();
+}
+
+BOOST_AUTO_TEST_CASE(writer_preference)
+{
+   fc::shared_mutex m;
+   fc::thread other( "shared_mutex_tests" );
+   std::string order;
+
+   m.lock_shared();
+   fc::future<void> writer = other.async( [&]() {
+      m.lock();
+      order += 'W';
+      fc::usleep( fc::milliseconds( 20 ) );
+      m.unlock();
+   });
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !writer.ready() );
+   // new readers queue behind the waiting writer
+   BOOST_CHECK( !m.try_lock_shared() );
+   fc::future<void> reader = other.async( [&]() {
+      m.lock_shared();
+      order += 'R';
+      m.unlock_shared();
+   });
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !reader.ready() );
+
+   m.unlock_shared();
+   writer.wait();
+   reader.wait();
+   BOOST_CHECK_EQUAL( order, "WR" );
+}
+
+BOOST_AUTO_TEST_CASE(hand_off)
+{
+   fc::shared_mutex m;
+   bool writer_got_it = false;
+
+   m.lock();
+   // on this thread, so the waiter cannot run before the try_lock below
+   fc::future<void> writer = fc::async( [&]() {
+      m.lock();
+      writer_got_it = true;
+      m.unlock();
+   });
+   fc::usleep( fc::milliseconds( 20 ) );
+   m.unlock();
+   BOOST_CHECK( !m.try_lock() );
+   BOOST_CHECK( !m.try_lock_shared() );
+   writer.wait();
+   BOOST_CHECK( writer_got_it );
+
+   // all readers waiting behind a writer are let in together
+   int inside = 0, most_inside = 0;
+   m.lock();
+   std::vector< fc::future<void> > readers;
+   for( int i = 0; i < 3; ++i )
+      readers.push_back( fc::async( [&]() {
+         m.lock_shared();
+         most_inside = std::max( most_inside, ++inside );
+         fc::usleep( fc::milliseconds( 20 ) );
+         --inside;
+         m.unlock_shared();
+      }));
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK_EQUAL( most_inside, 0 );
+   m.unlock();
+   BOOST_CHECK( !m.try_lock() );
+   for( auto& r : readers )
+      r.wait();
+   BOOST_CHECK_EQUAL( most_inside, 3 );
+   BOOST_CHECK( m.try_lock() );
+   m.unlock();
+}
+
+BOOST_AUTO_TEST_CASE(cancel_a_waiting_writer)
+{
+   fc::shared_mutex m;
+   bool reader_got_it = false;
+
+   m.lock_shared();
+   fc::future<void> writer = fc::async( [&]() {
+      m.lock();
+      BOOST_ERROR( "the canceled writer got the lock" );
+      m.unlock();
+   });
+   fc::future<void> reader = fc::async( [&]() {
+      m.lock_shared();
+      reader_got_it = true;
+      m.unlock_shared();
+   });
+   fc::usleep( fc::milliseconds( 20 ) );
+   BOOST_CHECK( !reader_got_it );
+
+   // the reader only waited for the writer, so it goes in once the writer leaves the queue
+   writer.cancel();
+   BOOST_CHECK_THROW( writer.wait(), fc::canceled_exception );
+   reader.wait( fc::seconds( 5 ) );
+   BOOST_CHECK( reader_got_it );
+
+   m.unlock_shared();
+   BOOST_CHECK( m.try_lock() );
+   m.unlock();
+}
+
+BOOST_AUTO_TEST_CASE(cancel_a_granted_waiter)
+{
+   fc::shared_mutex m;
+
+   m.lock();
+   fc::future<void> writer = fc::async( [&]() {
+      m.lock();
+      m.unlock();
+   });
+   fc::usleep( fc::milliseconds( 20 ) );
+   // granted but not yet running when canceled, the lock must not stay taken either way
+   m.unlock();
+   writer.cancel();
+   try
+   {
+      writer.wait();
+   }
+   catch( const fc::canceled_exception& )
+   {
+   }
+   BOOST_CHECK( m.try_lock() );
+   m.unlock();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
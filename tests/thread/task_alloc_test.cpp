@@ -0,0 +1,147 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/shared_ptr.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+   struct counted : public fc::retainable
+   {
+      explicit counted( std::atomic<int>& destroyed ):_destroyed(destroyed){}
+      ~counted() { ++_destroyed; }
+      std::atomic<int>& _destroyed;
+   };
+}
+
+BOOST_AUTO_TEST_SUITE(task_alloc_tests)
+
+BOOST_AUTO_TEST_CASE(post_runs_in_order_on_the_target_thread)
+{
+   fc::thread t( "task_alloc_tests" );
+   std::vector<int> order;
+   std::vector<std::string> names;
+   for( int i = 0; i < 100; ++i )
+      t.post( [&order,&names,i]() {
+         order.push_back( i );
+         names.push_back( fc::thread::current().name() );
+      }, "post_test" );
+   // a posted task that throws is logged and does not stop the ones after it
+   t.post( []() { FC_THROW_EXCEPTION( fc::eof_exception, "posted and thrown" ); }, "post_test" );
+   t.post( [&order]() { order.push_back( 100 ); }, "post_test" );
+   // queued behind the posts
+   t.async( [](){}, "post_test" ).wait();
+
+   BOOST_REQUIRE_EQUAL( order.size(), 101u );
+   for( int i = 0; i <= 100; ++i )
+      BOOST_CHECK_EQUAL( order[i], i );
+   for( const std::string& n : names )
+      BOOST_CHECK_EQUAL( n, "task_alloc_tests" );
+
+   // fc::post() queues on the calling thread
+   const std::string posted_on = t.async( []() {
+      fc::promise<std::string>::ptr ran( new fc::promise<std::string>( "post_test" ) );
+      fc::post( [ran]() { ran->set_value( fc::thread::current().name() ); }, "post_test" );
+      return fc::future<std::string>( ran ).wait( fc::seconds( 5 ) );
+   }, "post_test" ).wait();
+   BOOST_CHECK_EQUAL( posted_on, "task_alloc_tests" );
+   t.quit();
+}
+
+BOOST_AUTO_TEST_CASE(freed_blocks_are_reused)
+{
+   fc::thread t( "task_alloc_tests" );
+   t.async( []() {
+      // the free list hands back the block freed last
+      fc::promise<int>* p = new fc::promise<int>( "freelist_test" );
+      const void* block = p;
+      fc::promise<int>::ptr( p, false ).reset();
+      fc::promise<int>::ptr again( new fc::promise<int>( "freelist_test" ) );
+      BOOST_CHECK( again.get() == block );
+   }, "freelist_test" ).wait();
+   t.quit();
+}
+
+BOOST_AUTO_TEST_CASE(free_lists_are_bounded)
+{
+   fc::thread t( "task_alloc_tests" );
+   t.async( []() {
+      std::vector<fc::promise<int>::ptr> promises;
+      for( int i = 0; i < 300; ++i )
+         promises.push_back( fc::promise<int>::ptr( new fc::promise<int>( "freelist_test" ) ) );
+      // every block of this size class is in use
+      const fc::promise_freelist_stats in_use = fc::get_promise_freelist_stats();
+      promises.clear();
+      const fc::promise_freelist_stats freed = fc::get_promise_freelist_stats();
+      BOOST_CHECK_EQUAL( freed.cached_blocks - in_use.cached_blocks, 256u );
+      BOOST_CHECK( freed.cached_bytes > in_use.cached_bytes );
+   }, "freelist_test" ).wait();
+   t.quit();
+}
+
+BOOST_AUTO_TEST_CASE(freed_on_another_thread)
+{
+   fc::thread a( "task_alloc_tests_a" );
+   fc::thread b( "task_alloc_tests_b" );
+   fc::promise<int>::ptr p = a.async( []() {
+      return fc::promise<int>::ptr( new fc::promise<int>( "freelist_test" ) );
+   }, "freelist_test" ).wait();
+   const void* block = p.get();
+
+   // the block moves to the list of the thread that frees it
+   b.async( [&p,block]() {
+      const uint64_t before = fc::get_promise_freelist_stats().cached_blocks;
+      p.reset();
+      BOOST_CHECK_EQUAL( fc::get_promise_freelist_stats().cached_blocks, before + 1 );
+      fc::promise<int>::ptr reused( new fc::promise<int>( "freelist_test" ) );
+      BOOST_CHECK( reused.get() == block );
+   }, "freelist_test" ).wait();
+
+   // and a's own allocations carry on
+   BOOST_CHECK( a.async( []() { return fc::promise<int>::ptr( new fc::promise<int>( "freelist_test" ) ); },
+                         "freelist_test" ).wait() );
+   a.quit();
+   b.quit();
+}
+
+BOOST_AUTO_TEST_CASE(last_release_with_concurrent_owners)
+{
+   // whichever thread drops the last reference, and with whatever fast path, the object goes exactly once
+   std::atomic<int> destroyed( 0 );
+   const int rounds = 200;
+   for( int r = 0; r < rounds; ++r )
+   {
+      fc::shared_ptr<counted> shared( new counted( destroyed ), false );
+      std::vector<std::thread> owners;
+      for( int i = 0; i < 3; ++i )
+         owners.emplace_back( [shared]() mutable {
+            for( int j = 0; j < 200; ++j )
+            {
+               fc::shared_ptr<counted> copy( shared );
+               fc::shared_ptr<counted> another;
+               another = copy;
+               copy.reset();
+            }
+            shared.reset();
+         });
+      shared.reset();
+      for( auto& o : owners )
+         o.join();
+      BOOST_REQUIRE_EQUAL( destroyed.load(), r + 1 );
+   }
+
+   // a single owner releases through the fast path
+   counted* alone = new counted( destroyed );
+   BOOST_CHECK_EQUAL( alone->retain_count(), 1 );
+   alone->retain();
+   alone->release();
+   BOOST_CHECK_EQUAL( destroyed.load(), rounds );
+   alone->release();
+   BOOST_CHECK_EQUAL( destroyed.load(), rounds + 1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
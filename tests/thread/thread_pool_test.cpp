@@ -0,0 +1,128 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/thread/thread_pool.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(thread_pool_tests)
+
+BOOST_AUTO_TEST_CASE(results_and_exceptions)
+{
+   fc::thread_pool pool( 2, "pool_tests" );
+   BOOST_CHECK_EQUAL( pool.size(), 2u );
+
+   BOOST_CHECK_EQUAL( pool.async( []() { return 42; } ).wait(), 42 );
+   BOOST_CHECK_EQUAL( pool.async( []() { return std::string( "on a worker" ); } ).wait(), "on a worker" );
+   bool ran = false;
+   pool.async( [&ran]() { ran = true; } ).wait();
+   BOOST_CHECK( ran );
+
+   // exceptions keep their type
+   BOOST_CHECK_THROW( pool.async( []() -> int { FC_THROW_EXCEPTION( fc::eof_exception, "eof" ); } ).wait(),
+                      fc::eof_exception );
+   BOOST_CHECK_THROW( pool.async( []() { throw std::runtime_error( "not an fc exception" ); } ).wait(),
+                      std::runtime_error );
+
+   // a fiber on another thread waits on a pool future
+   fc::thread other( "pool_tests_caller" );
+   BOOST_CHECK_EQUAL( other.async( [&pool]() { return pool.async( []() { return 7; } ).wait() * 6; } ).wait(), 42 );
+   other.quit();
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_from_a_worker)
+{
+   fc::thread_pool pool( 2, "pool_tests" );
+   const size_t n = 1000;
+   const uint64_t expected = uint64_t( n ) * ( n - 1 ) / 2;
+
+   // the worker takes chunks of its own parallel_for, so it finishes even with every other worker busy
+   std::vector< fc::future<uint64_t> > sums;
+   for( uint32_t i = 0; i < pool.size() + 1; ++i )
+      sums.push_back( pool.async( [&pool,n]() {
+         std::atomic<uint64_t> sum( 0 );
+         pool.parallel_for( 0, n, [&sum]( size_t i ) { sum += i; } );
+         return sum.load();
+      }));
+   for( auto& s : sums )
+      BOOST_CHECK_EQUAL( s.wait( fc::seconds( 30 ) ), expected );
+
+   // nested all the way down
+   const uint64_t nested = pool.async( [&pool]() {
+      std::atomic<uint64_t> sum( 0 );
+      pool.parallel_for( 0, 10, [&]( size_t i ) {
+         pool.parallel_for( 0, 10, [&]( size_t j ) { sum += i * 10 + j; } );
+      });
+      return sum.load();
+   }).wait( fc::seconds( 30 ) );
+   BOOST_CHECK_EQUAL( nested, 99u * 100 / 2 );
+
+   // the first exception reaches the caller once the chunks are done
+   BOOST_CHECK_THROW( pool.async( [&pool]() {
+      pool.parallel_for( 0, 100, []( size_t i ) {
+         if( i == 50 )
+            FC_THROW_EXCEPTION( fc::out_of_range_exception, "50" );
+      });
+   }).wait( fc::seconds( 30 ) ), fc::out_of_range_exception );
+
+   std::vector<int> in( 100 );
+   for( size_t i = 0; i < in.size(); ++i )
+      in[i] = int( i );
+   const std::vector<int> squares = pool.parallel_map( in, []( int v ) { return v * v; }, 8 );
+   BOOST_REQUIRE_EQUAL( squares.size(), in.size() );
+   for( size_t i = 0; i < in.size(); ++i )
+      BOOST_CHECK_EQUAL( squares[i], in[i] * in[i] );
+}
+
+BOOST_AUTO_TEST_CASE(idle_workers_steal)
+{
+   fc::thread_pool pool( 3, "pool_tests" );
+   const int tasks = 30;
+
+   // tasks posted from a worker queue on that worker, which then blocks until they are done
+   std::vector<std::string> ran_on( tasks );
+   const std::string poster = pool.async( [&]() {
+      std::vector< fc::future<void> > posted;
+      for( int i = 0; i < tasks; ++i )
+         posted.push_back( pool.async( [&ran_on,i]() { ran_on[i] = fc::thread::current().name(); } ) );
+      for( auto& p : posted )
+         p.wait();
+      return fc::thread::current().name();
+   }).wait( fc::seconds( 30 ) );
+
+   // every task was stolen, the poster never got back to its own queue
+   for( int i = 0; i < tasks; ++i )
+   {
+      BOOST_CHECK( !ran_on[i].empty() );
+      BOOST_CHECK_NE( ran_on[i], poster );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(destroy_with_queued_tasks)
+{
+   std::atomic<bool> open( false );
+   std::atomic<int>  ran( 0 );
+   std::vector< fc::future<void> > queued;
+   {
+      fc::thread_pool pool( 1, "pool_tests" );
+      // holds the only worker while the rest queue up behind it
+      queued.push_back( pool.async( [&open]() {
+         while( !open.load() )
+            fc::usleep( fc::milliseconds( 20 ) );
+      }));
+      for( int i = 0; i < 50; ++i )
+         queued.push_back( pool.async( [&ran]() { ++ran; } ) );
+      BOOST_CHECK_EQUAL( ran.load(), 0 );
+      open.store( true );
+   }
+   // the destructor ran everything that was queued
+   BOOST_CHECK_EQUAL( ran.load(), 50 );
+   for( auto& q : queued )
+      BOOST_CHECK( q.ready() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/thread/timer_wheel.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+   /**
+    *  A time in the near future at the start of a rotation of the second level, so offsets
+    *  from it in milliseconds are ticks of the default resolution with the same rotations.
+    */
+   fc::time_point origin()
+   {
+      const int64_t now_ms = fc::time_point::now().time_since_epoch().count() / 1000;
+      return fc::time_point( fc::milliseconds( ( ( now_ms >> 16 ) + 1 ) << 16 ) );
+   }
+
+   fc::time_point at( const fc::time_point& base, int64_t ms )
+   {
+      return base + fc::milliseconds( ms );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(timer_wheel_tests)
+
+BOOST_AUTO_TEST_CASE(next_expiry_at_a_rotation_boundary)
+{
+   const fc::time_point base = origin();
+   fc::timer_wheel wheel;
+   wheel.expire( base, []( fc::timer_wheel::node& ){} );
+
+   fc::timer_wheel::node n;
+   wheel.schedule( n, at( base, 300 ) );
+   // leaves the wheel at the start of the next rotation, before the level 1 slot holding n moves down
+   bool expired = false;
+   wheel.expire( at( base, 255 ), [&]( fc::timer_wheel::node& ){ expired = true; } );
+   BOOST_CHECK( !expired );
+   BOOST_CHECK( wheel.next_expiry() <= at( base, 300 ) );
+
+   wheel.expire( at( base, 300 ), [&]( fc::timer_wheel::node& e ){ expired = &e == &n; } );
+   BOOST_CHECK( expired );
+   BOOST_CHECK( wheel.empty() );
+}
+
+BOOST_AUTO_TEST_CASE(matches_a_sorted_reference)
+{
+   const fc::time_point base = origin();
+   fc::timer_wheel wheel;
+   wheel.expire( base, []( fc::timer_wheel::node& ){} );
+
+   const size_t count = 2000;
+   std::vector<fc::timer_wheel::node> nodes( count );
+   std::vector<int64_t> deadline( count, -1 ); // -1 when not scheduled
+   std::multimap<int64_t, size_t> reference;
+
+   std::mt19937_64 rng( 45 );
+   int64_t now = 0;
+   auto cancel_reference = [&]( size_t i ) {
+      auto range = reference.equal_range( deadline[i] );
+      for( auto it = range.first; it != range.second; ++it )
+         if( it->second == i ) { reference.erase( it ); break; }
+      deadline[i] = -1;
+   };
+
+   for( int step = 0; step < 20000; ++step )
+   {
+      const int op = int( rng() % 10 );
+      const size_t i = size_t( rng() % count );
+      if( op < 5 )
+      {
+         // spread the deadlines over the first three levels
+         static const int64_t ranges[] = { 300, 70000, 20000000 };
+         const int64_t when = now + int64_t( rng() % ranges[rng() % 3] );
+         if( deadline[i] >= 0 )
+            cancel_reference( i );
+         wheel.schedule( nodes[i], at( base, when ) );
+         // the wheel is done with the tick of the last expire(), so a deadline there is one tick late
+         deadline[i] = std::max( when, now + 1 );
+         reference.emplace( deadline[i], i );
+      }
+      else if( op < 7 )
+      {
+         wheel.cancel( nodes[i] );
+         if( deadline[i] >= 0 )
+            cancel_reference( i );
+      }
+      else
+      {
+         // small steps, jumps to the next deadline, and stops just before rotation boundaries
+         const int64_t choice = int64_t( rng() % 4 );
+         if( choice == 0 || reference.empty() )
+            now += int64_t( rng() % 50 );
+         else if( choice == 1 )
+            now = std::max( now, reference.begin()->first );
+         else if( choice == 2 )
+            now = ( now | 255 ) + ( rng() % 2 ? 256 : 0 );
+         else
+            now = ( now | 65535 );
+
+         std::set<size_t> expired;
+         wheel.expire( at( base, now ), [&]( fc::timer_wheel::node& n ) {
+            expired.insert( size_t( &n - &nodes[0] ) );
+         });
+         std::set<size_t> due;
+         while( !reference.empty() && reference.begin()->first <= now )
+         {
+            due.insert( reference.begin()->second );
+            deadline[reference.begin()->second] = -1;
+            reference.erase( reference.begin() );
+         }
+         BOOST_REQUIRE( expired == due );
+      }
+
+      BOOST_REQUIRE_EQUAL( wheel.size(), reference.size() );
+      if( reference.empty() )
+         BOOST_REQUIRE( wheel.next_expiry() == fc::time_point::maximum() );
+      else
+         BOOST_REQUIRE( wheel.next_expiry() <= at( base, reference.begin()->first ) );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
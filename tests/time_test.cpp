@@ -0,0 +1,138 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/time.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+   // what time_point_sec formatted and parsed with before it stopped going through boost::posix_time
+   std::string boost_iso_string( uint32_t sec )
+   {
+      return boost::posix_time::to_iso_extended_string( boost::posix_time::from_time_t( time_t( sec ) ) );
+   }
+
+   std::string boost_non_delimited_iso_string( uint32_t sec )
+   {
+      return boost::posix_time::to_iso_string( boost::posix_time::from_time_t( time_t( sec ) ) );
+   }
+
+   /** @return false where boost rejects s */
+   bool boost_from_iso_string( const std::string& s, fc::time_point_sec& t )
+   {
+      try
+      {
+         static const boost::posix_time::ptime epoch = boost::posix_time::from_time_t( 0 );
+         boost::posix_time::ptime pt;
+         if( s.size() >= 5 && s.at( 4 ) == '-' )
+            pt = boost::date_time::parse_delimited_time<boost::posix_time::ptime>( s, 'T' );
+         else
+            pt = boost::posix_time::from_iso_string( s );
+         t = fc::time_point_sec( (pt - epoch).total_seconds() );
+         return true;
+      }
+      catch( ... )
+      {
+         return false;
+      }
+   }
+
+   /** checks that fc parses s to what boost does, or rejects it as boost does */
+   void check_parse( const std::string& s )
+   {
+      BOOST_TEST_CONTEXT( "parsing \"" << s << "\"" )
+      {
+         fc::time_point_sec expected;
+         if( boost_from_iso_string( s, expected ) )
+            BOOST_CHECK_EQUAL( fc::time_point_sec::from_iso_string( s ).sec_since_epoch(), expected.sec_since_epoch() );
+         else
+            BOOST_CHECK_THROW( fc::time_point_sec::from_iso_string( s ), fc::exception );
+      }
+   }
+
+   void check_round_trip( uint32_t sec )
+   {
+      const fc::time_point_sec t( sec );
+      const std::string delimited = t.to_iso_string();
+      const std::string non_delimited = t.to_non_delimited_iso_string();
+      BOOST_CHECK_EQUAL( delimited, boost_iso_string( sec ) );
+      BOOST_CHECK_EQUAL( non_delimited, boost_non_delimited_iso_string( sec ) );
+      BOOST_CHECK_EQUAL( fc::time_point_sec::from_iso_string( delimited ).sec_since_epoch(), sec );
+      BOOST_CHECK_EQUAL( fc::time_point_sec::from_iso_string( non_delimited ).sec_since_epoch(), sec );
+      check_parse( delimited );
+      check_parse( non_delimited );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(time_tests)
+
+BOOST_AUTO_TEST_CASE(format_and_parse_like_boost)
+{
+   const uint32_t day = 86400;
+   const std::vector<uint32_t> secs = {
+      0, 1, 59, 60, 3599, 3600, day - 1, day,
+      951782400 - 1, 951782400, 951782400 + day,      // 2000-02-29, a leap day of a year divisible by 400
+      1078012800, 1709164800 + day - 1,               // 2004-02-29 and the end of 2024-02-29
+      1709251200 - 1, 1709251200,                     // around 2024-03-01
+      4107456000, 4107542400 - 1, 4107542400,         // 2100-02-28 to 2100-03-01, 2100 is not a leap year
+      946684799, 946684800,                           // around 2000-01-01
+      0x7fffffff, 0x80000000u,
+      0xffffffffu                                     // the last time_point_sec, 2106-02-07T06:28:15
+   };
+   for( uint32_t sec : secs )
+      check_round_trip( sec );
+
+   // and a spread over the whole range
+   uint32_t x = 12345;
+   for( int i = 0; i < 20000; ++i )
+   {
+      x = x * 1664525u + 1013904223u;
+      check_round_trip( x );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(repeated_and_alternating_seconds)
+{
+   // to_iso_string() keeps the last second it formatted on each thread
+   const fc::time_point_sec a( 1500000000 ), b( 1500000001 );
+   for( int i = 0; i < 3; ++i )
+   {
+      BOOST_CHECK_EQUAL( a.to_iso_string(), boost_iso_string( a.sec_since_epoch() ) );
+      BOOST_CHECK_EQUAL( a.to_iso_string(), boost_iso_string( a.sec_since_epoch() ) );
+      BOOST_CHECK_EQUAL( b.to_iso_string(), boost_iso_string( b.sec_since_epoch() ) );
+   }
+   BOOST_CHECK_EQUAL( fc::time_point_sec().to_iso_string(), "1970-01-01T00:00:00" );
+   BOOST_CHECK_EQUAL( std::string( fc::time_point( fc::time_point_sec( 86400 ) ) ), "1970-01-02T00:00:00" );
+}
+
+BOOST_AUTO_TEST_CASE(fractional_seconds)
+{
+   for( const char* s : { "2020-02-29T12:34:56.5", "2020-02-29T12:34:56.999999", "2020-02-29T12:34:56.000001",
+                          "2020-02-29T12:34:56.123", "1970-01-01T00:00:00.0" } )
+   {
+      check_parse( s );
+      // the fraction is dropped
+      BOOST_CHECK_EQUAL( fc::time_point_sec::from_iso_string( s ).to_iso_string(), std::string( s, 19 ) );
+   }
+   BOOST_CHECK( fc::time_point::from_iso_string( "2020-02-29T12:34:56.5" ) ==
+                fc::time_point( fc::time_point_sec::from_iso_string( "2020-02-29T12:34:56" ) ) );
+}
+
+BOOST_AUTO_TEST_CASE(non_canonical_input)
+{
+   // none of these take the fast path, they are accepted or rejected as boost does
+   for( const char* s : {
+           "2020-2-29T12:34:56", "2020-02-29T1:2:3", "2020-02-29T12:34:56Z", "2020-02-29T12:34:56.",
+           "2020-02-29T12:34:56.1234567", "2020-02-29T12:34:56,5", "2020-02-29 12:34:56",
+           "2020-02-30T00:00:00", "2019-02-29T00:00:00", "2100-02-29T00:00:00", "2020-13-01T00:00:00",
+           "2020-00-01T00:00:00", "2020-01-00T00:00:00", "2020-02-29T24:00:00", "2020-02-29T23:60:00",
+           "2020-02-29T23:59:60", "1399-12-31T00:00:00",
+           "20200229T123456.5", "20200229T123456,5", "20200229T12345", "20200230T000000", "2020022T9123456",
+           "2020-02-29", "20200229", "T", "", "not a time", "2020-02-29T12:34:5x" } )
+      check_parse( s );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+#include <fc/thread/timer_wheel.hpp>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+   struct heap_timer
+   {
+      int64_t when;
+      size_t  id;
+   };
+   struct heap_timer_later
+   {
+      bool operator()( const heap_timer& a, const heap_timer& b )const { return a.when > b.when; }
+   };
+
+   double ns_per_op( const fc::microseconds& elapsed, size_t ops )
+   {
+      return double(elapsed.count()) * 1000 / ops;
+   }
+}
+
+/**
+ *  Compares the timer_wheel that fc threads use for sleeps and scheduled tasks with the
+ *  binary heap they used before, at n outstanding timers: scheduling, cancelling (as
+ *  done for every timeout that does not fire) and expiring everything.
+ */
+int main( int argc, char** argv )
+{
+   const size_t n       = argc > 1 ? std::stoull( argv[1] ) : 100000;
+   const size_t cancels = std::min<size_t>( n, 1000 );
+   const fc::time_point base = fc::time_point::now();
+
+   std::mt19937_64 rng( 42 );
+   std::vector<int64_t> deadlines( n );
+   for( auto& d : deadlines )
+      d = base.time_since_epoch().count() + int64_t( rng() % 60000000 ); // within a minute
+
+   // timer wheel
+   fc::timer_wheel wheel;
+   std::vector<fc::timer_wheel::node> nodes( n );
+   auto start = fc::time_point::now();
+   for( size_t i = 0; i < n; ++i )
+      wheel.schedule( nodes[i], fc::time_point( fc::microseconds( deadlines[i] ) ) );
+   const auto wheel_schedule = fc::time_point::now() - start;
+
+   start = fc::time_point::now();
+   for( size_t i = 0; i < cancels; ++i )
+   {
+      wheel.cancel( nodes[i] );
+      wheel.schedule( nodes[i], fc::time_point( fc::microseconds( deadlines[i] ) ) );
+   }
+   const auto wheel_cancel = fc::time_point::now() - start;
+
+   size_t fired = 0;
+   start = fc::time_point::now();
+   for( int64_t t = 0; t <= 60000000; t += 10000 )
+      wheel.expire( base + fc::microseconds( t + 1000 ), [&]( fc::timer_wheel::node& ){ ++fired; } );
+   const auto wheel_expire = fc::time_point::now() - start;
+
+   // binary heap with a linear search to cancel, as thread_d did
+   std::vector<heap_timer> heap;
+   start = fc::time_point::now();
+   for( size_t i = 0; i < n; ++i )
+   {
+      heap.push_back( heap_timer{ deadlines[i], i } );
+      std::push_heap( heap.begin(), heap.end(), heap_timer_later() );
+   }
+   const auto heap_schedule = fc::time_point::now() - start;
+
+   start = fc::time_point::now();
+   for( size_t i = 0; i < cancels; ++i )
+   {
+      for( size_t j = 0; j < heap.size(); ++j )
+      {
+         if( heap[j].id == i )
+         {
+            heap[j] = heap.back();
+            heap.pop_back();
+            std::make_heap( heap.begin(), heap.end(), heap_timer_later() );
+            break;
+         }
+      }
+      heap.push_back( heap_timer{ deadlines[i], i } );
+      std::push_heap( heap.begin(), heap.end(), heap_timer_later() );
+   }
+   const auto heap_cancel = fc::time_point::now() - start;
+
+   size_t heap_fired = 0;
+   start = fc::time_point::now();
+   for( int64_t t = 0; t <= 60000000; t += 10000 )
+   {
+      const int64_t now = base.time_since_epoch().count() + t + 1000;
+      while( !heap.empty() && heap.front().when <= now )
+      {
+         std::pop_heap( heap.begin(), heap.end(), heap_timer_later() );
+         heap.pop_back();
+         ++heap_fired;
+      }
+   }
+   const auto heap_expire = fc::time_point::now() - start;
+
+   std::cout << n << " outstanding timers, ns per timer:\n";
+   std::cout << "                 wheel      heap\n";
+   std::cout << "schedule    " << ns_per_op( wheel_schedule, n )       << "   " << ns_per_op( heap_schedule, n ) << "\n";
+   std::cout << "cancel      " << ns_per_op( wheel_cancel, cancels )   << "   " << ns_per_op( heap_cancel, cancels ) << "\n";
+   std::cout << "expire      " << ns_per_op( wheel_expire, n )         << "   " << ns_per_op( heap_expire, n ) << "\n";
+   std::cout << "(fired " << fired << " / " << heap_fired << ")\n";
+   return 0;
+}
@@ -0,0 +1,63 @@
+#include <fc/io/json.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+#include <fc/time.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+static size_t allocations = 0;
+
+void* operator new( size_t n )
+{
+   ++allocations;
+   if( void* p = malloc( n ) )
+      return p;
+   throw std::bad_alloc();
+}
+void operator delete( void* p ) noexcept { free( p ); }
+void operator delete( void* p, size_t ) noexcept { free( p ); }
+
+/**
+ *  Counts the heap allocations json::from_string needs for typical RPC requests,
+ *  which are dominated by short strings such as account names, symbols and ids.
+ */
+int main( int argc, char** argv )
+{
+   const int n = argc > 1 ? std::stoi( argv[1] ) : 10000;
+   const std::string requests[] = {
+      R"({"id":17,"method":"call","params":["database_api","get_accounts",[["alice","bob","carol","initminer","steemit","temp"]]]})",
+      R"({"jsonrpc":"2.0","id":3,"method":"call","params":["condenser_api","get_ops_in_block",[1234567,false]],"symbol":"STEEM","owner":"STM6LLegbAgLAy28EHrffBVuANFWcFgmqRMW13wBmTExqFE9SCkg4"})",
+      R"({"jsonrpc":"2.0","id":4,"method":"get_block","params":{"block_num":8675309,"id":"0084600d4a3b5a47ef0b8c1e","witness":"gtg"}})"
+   };
+
+   for( const std::string& request : requests )
+   {
+      fc::variant warm = fc::json::from_string( request );
+
+      allocations = 0;
+      auto start = fc::time_point::now();
+      for( int i = 0; i < n; ++i )
+         fc::variant v = fc::json::from_string( request );
+      auto parse = fc::time_point::now() - start;
+      const double per_parse = double(allocations) / n;
+
+      allocations = 0;
+      size_t chars = 0;
+      for( int i = 0; i < n; ++i )
+      {
+         fc::variant v = fc::json::from_string( request );
+         for( const auto& e : v.get_object() )
+            if( e.value().is_string() )
+               chars += e.value().get_string().size();
+      }
+      const double per_get_string = double(allocations) / n;
+
+      std::cout << request.size() << " byte request: " << per_parse << " allocations per parse, "
+                << per_get_string << " with get_string() on every top level string, "
+                << double(parse.count()) * 1000 / n << " ns per parse\n";
+      std::cout << "(checksum " << chars << ")\n";
+   }
+   return 0;
+}
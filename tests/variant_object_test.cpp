@@ -0,0 +1,73 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/variant_object.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace fc;
+
+BOOST_AUTO_TEST_SUITE(variant_object_tests)
+
+static string key( int i ) { return "key" + std::to_string(i); }
+
+BOOST_AUTO_TEST_CASE(mutable_lookup_follows_mutations)
+{
+   mutable_variant_object mvo;
+   for( int i = 0; i < 40; ++i )
+   {
+      mvo( key(i), i );
+      for( int j = 0; j <= i; ++j )
+         BOOST_CHECK_EQUAL( mvo[key(j)].as_int64(), j );
+      BOOST_CHECK( mvo.find( key(i + 1) ) == mvo.end() );
+   }
+
+   mvo.set( key(5), 500 );
+   mvo["key41"] = 41;
+   mvo.erase( key(3) );
+   BOOST_CHECK( mvo.find( key(3) ) == mvo.end() );
+   BOOST_CHECK_EQUAL( mvo[key(5)].as_int64(), 500 );
+   BOOST_CHECK_EQUAL( mvo[key(39)].as_int64(), 39 );
+   BOOST_CHECK_EQUAL( mvo["key41"].as_int64(), 41 );
+
+   const mutable_variant_object copy( mvo );
+   BOOST_CHECK_EQUAL( copy[key(20)].as_int64(), 20 );
+
+   mutable_variant_object assigned;
+   assigned = variant_object( mvo );
+   BOOST_CHECK_EQUAL( assigned[key(30)].as_int64(), 30 );
+   BOOST_CHECK( assigned.find( key(3) ) == assigned.end() );
+}
+
+BOOST_AUTO_TEST_CASE(const_lookup_from_many_threads)
+{
+   mutable_variant_object mvo;
+   for( int i = 0; i < 64; ++i )
+      mvo( key(i), i );
+   const mutable_variant_object& shared = mvo;
+
+   std::vector<fc::thread*> threads;
+   std::vector< fc::future<bool> > results;
+   for( int t = 0; t < 4; ++t )
+   {
+      threads.push_back( new fc::thread( "lookup" ) );
+      results.push_back( threads.back()->async( [&shared]() {
+         bool ok = true;
+         for( int round = 0; round < 100; ++round )
+            for( int i = 0; i < 64; ++i )
+               ok = ok && shared[key(i)].as_int64() == i;
+         return ok;
+      }));
+   }
+   for( auto& r : results )
+      BOOST_CHECK( r.wait() );
+   for( auto* t : threads )
+   {
+      t->quit();
+      delete t;
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/variant.hpp>
+#include <fc/variant_arena.hpp>
+#include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace fc;
+
+BOOST_AUTO_TEST_SUITE(variant_tests)
+
+BOOST_AUTO_TEST_CASE(string_accessors)
+{
+   for( size_t len = 0; len < 40; ++len )
+   {
+      std::string s;
+      for( size_t i = 0; i < len; ++i )
+         s.push_back( char('a' + i % 26) );
+
+      variant v( s );
+      BOOST_REQUIRE( v.is_string() );
+      BOOST_CHECK_EQUAL( v.string_size(), len );
+      BOOST_CHECK_EQUAL( std::string( v.string_data(), v.string_size() ), s );
+      BOOST_CHECK_EQUAL( v.as_string(), s );
+
+      const string& ref = v.get_string();
+      BOOST_CHECK_EQUAL( ref, s );
+      BOOST_CHECK( &v.get_string() == &ref );
+
+      variant copy( v );
+      BOOST_CHECK_EQUAL( copy.get_string(), s );
+
+      // a reference stays valid while the variant is moved around, like it does for a heap string
+      variant moved( std::move(v) );
+      BOOST_CHECK( v.is_null() );
+      BOOST_CHECK_EQUAL( ref, s );
+      BOOST_CHECK( &moved.get_string() == &ref );
+      variant assigned;
+      assigned = std::move(moved);
+      BOOST_CHECK_EQUAL( ref, s );
+
+      assigned = variant( 5 );
+      BOOST_CHECK_EQUAL( assigned.as_int64(), 5 );
+      BOOST_CHECK_EQUAL( copy.get_string(), s );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(numbers_from_strings)
+{
+   // inline and heap strings
+   for( const std::string& zeros : { std::string(), std::string( 40, '0' ) } )
+   {
+      BOOST_CHECK_EQUAL( variant( zeros + "42" ).as_int64(), 42 );
+      BOOST_CHECK_EQUAL( variant( "-" + zeros + "7" ).as_int64(), -7 );
+      BOOST_CHECK_EQUAL( variant( zeros + "18446744073709551615" ).as_uint64(), 18446744073709551615ull );
+      BOOST_CHECK_EQUAL( variant( zeros + "1.5" ).as_double(), 1.5 );
+      BOOST_CHECK_THROW( variant( zeros + "12x" ).as_int64(), fc::exception );
+      BOOST_CHECK_THROW( variant( zeros + "-" ).as_uint64(), fc::exception );
+      BOOST_CHECK_THROW( variant( zeros + "1.5.1" ).as_double(), fc::exception );
+   }
+   BOOST_CHECK_THROW( variant( "" ).as_int64(), fc::exception );
+   // the conversion stops at the end of the string, not at a null
+   BOOST_CHECK_THROW( variant( std::string( "12\0" "3", 4 ) ).as_int64(), fc::exception );
+}
+
+BOOST_AUTO_TEST_CASE(get_string_from_many_threads)
+{
+   std::vector<variant> values;
+   for( int i = 0; i < 256; ++i )
+      values.push_back( variant( "v" + std::to_string(i) ) );
+   const std::vector<variant>& shared = values;
+
+   std::vector<fc::thread*> threads;
+   std::vector< fc::future<bool> > results;
+   for( int t = 0; t < 4; ++t )
+   {
+      threads.push_back( new fc::thread( "get_string" ) );
+      results.push_back( threads.back()->async( [&shared]() {
+         bool ok = true;
+         for( int i = 0; i < 256; ++i )
+         {
+            const std::string expected = "v" + std::to_string(i);
+            ok = ok && std::string( shared[i].string_data(), shared[i].string_size() ) == expected;
+            ok = ok && shared[i].get_string() == expected;
+         }
+         return ok;
+      }));
+   }
+   for( auto& r : results )
+      BOOST_CHECK( r.wait() );
+   for( auto* t : threads )
+   {
+      t->quit();
+      delete t;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(arena_values)
+{
+   const std::string text = R"({"name":"a string that is not stored inline","list":[1,2,"x"],"big":")"
+                            + std::string( 40000, 'b' ) + "\"}";
+   variant kept, copied, freed_elsewhere;
+   {
+      variant_arena arena( 4096 );
+      variant v = json::from_string( text );
+      BOOST_CHECK( arena.used() > 0 );
+      kept = v;
+      copied = variant_arena::copy_out( v );
+      freed_elsewhere = json::from_string( text );
+   }
+   BOOST_CHECK_EQUAL( json::to_string( kept ), text );
+   BOOST_CHECK_EQUAL( json::to_string( copied ), text );
+
+   fc::thread other( "arena_free" );
+   other.async( [&freed_elsewhere]() { freed_elsewhere = variant(); } ).wait();
+   other.quit();
+   kept = variant();
+   BOOST_CHECK_EQUAL( json::to_string( copied ), text );
+}
+
+BOOST_AUTO_TEST_SUITE_END()